@@ -0,0 +1,398 @@
+#include "JTCP/JTCP.h"
+#include "jbench.h"
+#include <future>
+#include <mutex>
+#include <thread>
+#include <sys/socket.h>
+#include <unordered_map>
+
+using namespace JTCP;
+
+namespace {
+
+constexpr Types::PortType BENCH_PORT = 19990;
+
+/**
+ * @brief 回显服务，首次使用时启动，供所有走回环网络的用例共享
+ *
+ */
+class EchoServer
+{
+public:
+    static EchoServer& instance()
+    {
+        static EchoServer server;
+        return server;
+    }
+
+    bool isRunning() const { return m_running; }
+
+    Metrics::ReactorMetricsSnapshot getMetrics() const { return m_server.getMetrics().total(); }
+
+private:
+    EchoServer()
+    {
+        m_server.setOnNewClient([](Server::TCPPeerClientPtr client) {
+            client->setOnRecvDataCB([](Server::TCPPeerClient* ptr) {
+                char buff[65536];
+                while (true) {
+                    auto ret = ptr->readData(buff, sizeof(buff));
+                    if (ret.isFailure()) {
+                        return;
+                    }
+                    size_t len = *(ret.getSuccessPtr()), sended = 0;
+                    while (sended < len) {
+                        auto send_ret = ptr->sendData(buff + sended, len - sended);
+                        if (send_ret.isFailure()) {
+                            return;
+                        }
+                        sended += *(send_ret.getSuccessPtr());
+                    }
+                }
+            });
+        });
+        m_running = m_server.start("127.0.0.1", BENCH_PORT).isFailure() == false;
+    }
+    ~EchoServer()
+    {
+        if (m_running) {
+            m_server.stop();
+        }
+    }
+
+private:
+    Server::TCPServer m_server;
+    bool              m_running{false};
+};
+
+/**
+ * @brief 从TCPClient读满len字节
+ *
+ */
+bool recvAll(Client::TCPClient* client, char* data, size_t len)
+{
+    size_t received = 0;
+    while (received < len) {
+        size_t buff_len = len - received;
+        if (client->recvData(data + received, buff_len).isFailure() || buff_len == 0) {
+            return false;
+        }
+        received += buff_len;
+    }
+    return true;
+}
+
+/**
+ * @brief 从原始fd读满len字节
+ *
+ */
+bool readAll(int fd, char* data, size_t len)
+{
+    size_t received = 0;
+    while (received < len) {
+        auto ret = read(fd, data + received, len - received);
+        if (ret <= 0) {
+            return false;
+        }
+        received += ret;
+    }
+    return true;
+}
+
+}   // namespace
+
+/**
+ * @brief 数据回调的调用开销（std::function间接调用）
+ *
+ */
+void BM_CallbackInvoke(JBench::State& state)
+{
+    Server::TCPServer     server;
+    Server::TCPReactor    reactor(&server, 0, nullptr);
+    Server::TCPPeerClient peer_client(&reactor);
+    uint64_t              counter = 0;
+    peer_client.setOnRecvDataCB([&counter](Server::TCPPeerClient*) { ++counter; });
+
+    for (auto _ : state) {
+        peer_client.onRecvData();
+    }
+    JBench::doNotOptimize(counter);
+    state.setItemsProcessed(state.iterations());
+}
+JBENCH(BM_CallbackInvoke);
+
+/**
+ * @brief 分发时按fd查找客户端的开销，与TCPReactor::handleClientMsg中的加锁查找方式一致
+ *
+ */
+void BM_ClientMapLookup(JBench::State& state)
+{
+    Server::TCPServer  server;
+    Server::TCPReactor reactor(&server, 0, nullptr);
+    std::unordered_map<FileDescribe::FDType, Server::TCPPeerClientPtr> client_mgr;
+    std::mutex                                                         client_mgr_mutex;
+
+    auto client_num = static_cast<FileDescribe::FDType>(state.range(0));
+    for (FileDescribe::FDType fd = 0; fd < client_num; ++fd) {
+        client_mgr[fd] = std::make_shared<Server::TCPPeerClient>(&reactor);
+    }
+
+    FileDescribe::FDType fd = 0;
+    for (auto _ : state) {
+        Server::TCPPeerClientPtr peer_client{nullptr};
+        {
+            std::lock_guard<std::mutex> lock_guard(client_mgr_mutex);
+            peer_client = client_mgr.at(fd);
+        }
+        JBench::doNotOptimize(peer_client);
+        fd = (fd + 7) % client_num;
+    }
+    state.setItemsProcessed(state.iterations());
+}
+JBENCH(BM_ClientMapLookup)->Arg(16)->Arg(1024)->Arg(65536);
+
+/**
+ * @brief socketpair上原始read/write往返，作为系统调用开销的基线
+ *
+ */
+void BM_SocketpairRawRoundTrip(JBench::State& state)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        state.skipWithError("socketpair failed");
+        return;
+    }
+
+    std::vector<char> buff(state.range(0), 'x');
+    for (auto _ : state) {
+        if (write(fds[0], buff.data(), buff.size()) < 0 ||
+            false == readAll(fds[1], buff.data(), buff.size()) ||
+            write(fds[1], buff.data(), buff.size()) < 0 ||
+            false == readAll(fds[0], buff.data(), buff.size())) {
+            state.skipWithError("socketpair io failed");
+            break;
+        }
+    }
+    close(fds[0]);
+    close(fds[1]);
+    state.setBytesProcessed(state.iterations() * buff.size() * 2);
+}
+JBENCH(BM_SocketpairRawRoundTrip)->Arg(64)->Arg(4096);
+
+/**
+ * @brief TCPPeerClient::sendData/readData在socketpair上的往返
+ *
+ */
+void BM_PeerSocketpairRoundTrip(JBench::State& state)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        state.skipWithError("socketpair failed");
+        return;
+    }
+
+    Server::TCPServer     server;
+    Server::TCPReactor    reactor(&server, 0, nullptr);
+    Server::TCPPeerClient peer_client(&reactor);
+    peer_client.setFileDescribe(std::make_shared<FileDescribe>(fds[0]));
+
+    std::vector<char> buff(state.range(0), 'x');
+    for (auto _ : state) {
+        auto send_ret = peer_client.sendData(buff.data(), buff.size());
+        if (send_ret.isFailure() || false == readAll(fds[1], buff.data(), buff.size()) ||
+            write(fds[1], buff.data(), buff.size()) < 0) {
+            state.skipWithError("socketpair io failed");
+            break;
+        }
+        size_t received = 0;
+        while (received < buff.size()) {
+            auto read_ret = peer_client.readData(buff.data() + received, buff.size() - received);
+            if (read_ret.isFailure()) {
+                break;
+            }
+            received += *(read_ret.getSuccessPtr());
+        }
+        if (received != buff.size()) {
+            state.skipWithError("peer read failed");
+            break;
+        }
+    }
+    close(fds[1]);
+    state.setBytesProcessed(state.iterations() * buff.size() * 2);
+}
+JBENCH(BM_PeerSocketpairRoundTrip)->Arg(64)->Arg(4096);
+
+/**
+ * @brief 共享内存通道往返，另一线程回显，与BM_PeerSocketpairRoundTrip对比省去的系统调用开销
+ *
+ * 两个线程需要各自占用一个CPU，单核机器上忙等只会让出时间片，结果主要反映futex唤醒的开销。
+ */
+void BM_ShmChannelRoundTrip(JBench::State& state)
+{
+    std::promise<ShmChannelPtr> server_channel_promise;
+    Server::TCPServer           server;
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        client->setOnRecvDataCB([&](Server::TCPPeerClient* ptr) {
+            if (auto ret = ShmChannel::accept(ptr->getFileDescribe()); ret.isSuccess()) {
+                server_channel_promise.set_value(*ret.getSuccessPtr());
+            }
+        });
+    });
+    if (server.start("unix:@jtcp_bench_shm", 0).isFailure()) {
+        state.skipWithError("start server failed");
+        return;
+    }
+    auto client_ret = ShmChannel::connect("unix:@jtcp_bench_shm");
+    if (client_ret.isFailure()) {
+        state.skipWithError("connect failed");
+        server.stop();
+        return;
+    }
+    auto client         = *client_ret.getSuccessPtr();
+    auto server_channel = server_channel_promise.get_future().get();
+
+    std::thread echo_thread([server_channel, len = state.range(0)]() {
+        std::vector<char> buff(len);
+        while (server_channel->waitData(std::chrono::seconds(1))) {
+            auto ret = server_channel->readData(buff.data(), buff.size());
+            if (ret.isFailure() || server_channel->sendData(buff.data(), *ret.getSuccessPtr())
+                                       .isFailure()) {
+                break;
+            }
+        }
+    });
+
+    std::vector<char> buff(state.range(0), 'x');
+    for (auto _ : state) {
+        if (client->sendData(buff.data(), buff.size()).isFailure() ||
+            false == client->waitData(std::chrono::seconds(1)) ||
+            client->readData(buff.data(), buff.size()).isFailure()) {
+            state.skipWithError("shm channel io failed");
+            break;
+        }
+    }
+    client->close();
+    echo_thread.join();
+    server.stop();
+    state.setBytesProcessed(state.iterations() * buff.size() * 2);
+}
+JBENCH(BM_ShmChannelRoundTrip)->Arg(64)->Arg(4096);
+
+/**
+ * @brief TCPClient经回环网络与回显服务往返，覆盖epoll唤醒、handleClientMsg分发、readData和sendData
+ *
+ */
+void BM_LoopbackRoundTrip(JBench::State& state)
+{
+    auto& echo_server = EchoServer::instance();
+    if (false == echo_server.isRunning()) {
+        state.skipWithError("start echo server failed");
+        return;
+    }
+    auto client_ret = Client::TCPClient::createNew("127.0.0.1", BENCH_PORT);
+    if (client_ret.isFailure()) {
+        state.skipWithError("connect failed");
+        return;
+    }
+    auto client = client_ret.getSuccessPtr()->get();
+
+    auto              metrics_before = echo_server.getMetrics();
+    std::vector<char> buff(state.range(0), 'x');
+    for (auto _ : state) {
+        if (client->sendData(buff.data(), buff.size()).isFailure() ||
+            false == recvAll(client, buff.data(), buff.size())) {
+            state.skipWithError("round trip failed");
+            break;
+        }
+    }
+    state.setBytesProcessed(state.iterations() * buff.size() * 2);
+
+    // 服务端视角的分发延迟与回调耗时
+    auto metrics_after = echo_server.getMetrics();
+    state.counters["server_wakeups_per_iter"] =
+        static_cast<double>(metrics_after.epoll_wakeups - metrics_before.epoll_wakeups) /
+        state.iterations();
+    state.counters["dispatch_delay_p50_ns"] = metrics_after.dispatch_delay_ns.percentile(50);
+    state.counters["callback_p50_ns"]       = metrics_after.callback_duration_ns.percentile(50);
+}
+JBENCH(BM_LoopbackRoundTrip)->Arg(64)->Arg(4096);
+
+/**
+ * @brief 连续发送64个32字节的小消息后读回全部回显
+ *
+ * 参数为0时每个消息调用一次sendData，为1时通过bufferData合并后flush为一次系统调用
+ */
+void BM_ClientSmallMessages(JBench::State& state)
+{
+    auto& echo_server = EchoServer::instance();
+    if (false == echo_server.isRunning()) {
+        state.skipWithError("start echo server failed");
+        return;
+    }
+    auto client_ret = Client::TCPClient::createNew("127.0.0.1", BENCH_PORT);
+    if (client_ret.isFailure()) {
+        state.skipWithError("connect failed");
+        return;
+    }
+    auto client = client_ret.getSuccessPtr()->get();
+
+    constexpr size_t  MSG_NUM = 64, MSG_LEN = 32;
+    bool              buffered = state.range(0) != 0;
+    std::vector<char> msg(MSG_LEN, 'x'), echo(MSG_NUM * MSG_LEN);
+    for (auto _ : state) {
+        bool send_ok = true;
+        for (size_t i = 0; i < MSG_NUM && send_ok; ++i) {
+            auto ret = buffered ? client->bufferData(msg.data(), msg.size())
+                                : client->sendData(msg.data(), msg.size());
+            send_ok  = ret.isFailure() == false;
+        }
+        if (buffered && send_ok) {
+            send_ok = client->flush().isFailure() == false;
+        }
+        if (false == send_ok || client->recvExact(echo.data(), echo.size()).isFailure()) {
+            state.skipWithError("small message round trip failed");
+            break;
+        }
+    }
+    state.setItemsProcessed(state.iterations() * MSG_NUM);
+    state.setBytesProcessed(state.iterations() * MSG_NUM * MSG_LEN);
+}
+JBENCH(BM_ClientSmallMessages)->Arg(0)->Arg(1);
+
+/**
+ * @brief 建立连接、完成首个字节往返后关闭，覆盖服务端accept路径
+ *
+ * 等待首个字节的回包保证服务端已经accept，避免客户端连接速度超过服务端而溢出监听队列；
+ * 每次迭代都会占用一个本地端口，因此固定迭代次数
+ */
+void BM_ConnectAccept(JBench::State& state)
+{
+    auto& echo_server = EchoServer::instance();
+    if (false == echo_server.isRunning()) {
+        state.skipWithError("start echo server failed");
+        return;
+    }
+
+    auto metrics_before = echo_server.getMetrics();
+    for (auto _ : state) {
+        auto client_ret = Client::TCPClient::createNew("127.0.0.1", BENCH_PORT);
+        if (client_ret.isFailure()) {
+            state.skipWithError("connect failed");
+            break;
+        }
+        auto client = client_ret.getSuccessPtr()->get();
+        char data   = 'x';
+        if (client->sendData(&data, 1).isFailure() || false == recvAll(client, &data, 1)) {
+            state.skipWithError("first round trip failed");
+            break;
+        }
+    }
+    state.setItemsProcessed(state.iterations());
+
+    auto metrics_after = echo_server.getMetrics();
+    state.counters["accepts_per_iter"] =
+        static_cast<double>(metrics_after.accepts - metrics_before.accepts) / state.iterations();
+}
+JBENCH(BM_ConnectAccept)->Iterations(5000);
+
+JBENCH_MAIN();
@@ -0,0 +1,474 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 仿google benchmark接口的轻量微基准测试框架
+ *
+ * 用法与google benchmark一致：
+ *
+ *     void BM_Foo(JBench::State& state)
+ *     {
+ *         for (auto _ : state) {
+ *             JBench::doNotOptimize(foo(state.range(0)));
+ *         }
+ *     }
+ *     JBENCH(BM_Foo)->Arg(64)->Arg(1024);
+ *     JBENCH_MAIN();
+ *
+ * 支持的命令行参数：
+ *   --benchmark_filter=<子串>      只运行名称包含该子串的用例
+ *   --benchmark_min_time=<秒>      每个用例的最短计时时间，默认0.5
+ *   --benchmark_format=console|json 标准输出格式
+ *   --benchmark_out=<文件>         额外把结果以json格式写入文件
+ *
+ * json输出与google benchmark的字段保持一致，可以直接使用其compare.py等工具比较不同版本的结果。
+ */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace JBench {
+
+/**
+ * @brief 阻止编译器优化掉对value的计算
+ *
+ */
+template <typename T>
+inline void doNotOptimize(T const& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @brief 编译器内存屏障
+ *
+ */
+inline void clobberMemory()
+{
+    asm volatile("" : : : "memory");
+}
+
+/**
+ * @brief 单次运行的状态，用例通过range-for驱动迭代
+ *
+ */
+class State
+{
+public:
+    State(uint64_t max_iterations, std::vector<int64_t> args)
+        : m_max_iterations(max_iterations)
+        , m_args(std::move(args))
+    {}
+
+    /// 迭代变量只用于计数，标记为maybe_unused后for (auto _ : state)不会产生未使用变量的警告
+    struct [[maybe_unused]] Value
+    {};
+    struct Iterator
+    {
+        uint64_t remaining;
+        State*   state;
+
+        bool operator!=(const Iterator&)
+        {
+            if (remaining != 0) {
+                return true;
+            }
+            state->stopTiming();
+            return false;
+        }
+        void  operator++() { --remaining; }
+        Value operator*() const { return Value{}; }
+    };
+
+    Iterator begin()
+    {
+        startTiming();
+        return Iterator{m_max_iterations, this};
+    }
+    Iterator end() { return Iterator{0, this}; }
+
+public:
+    int64_t  range(size_t index = 0) const { return index < m_args.size() ? m_args[index] : 0; }
+    uint64_t iterations() const { return m_max_iterations; }
+
+    /**
+     * @brief 暂停计时，用于排除每次迭代中的准备工作
+     *
+     */
+    void pauseTiming()
+    {
+        m_real_ns += nowNS() - m_real_begin;
+        m_cpu_ns += cpuNS() - m_cpu_begin;
+    }
+    void resumeTiming()
+    {
+        m_real_begin = nowNS();
+        m_cpu_begin  = cpuNS();
+    }
+
+    void setBytesProcessed(int64_t bytes) { m_bytes_processed = bytes; }
+    void setItemsProcessed(int64_t items) { m_items_processed = items; }
+    void setLabel(const std::string& label) { m_label = label; }
+    void skipWithError(const std::string& error) { m_error = error; }
+
+    /**
+     * @brief 自定义计数器，会原样输出到结果中
+     *
+     */
+    std::map<std::string, double> counters;
+
+private:
+    friend class Runner;
+
+    static uint64_t nowNS()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+    }
+    static uint64_t cpuNS()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+    }
+    void startTiming()
+    {
+        m_real_ns = 0;
+        m_cpu_ns  = 0;
+        resumeTiming();
+    }
+    void stopTiming() { pauseTiming(); }
+
+private:
+    uint64_t             m_max_iterations{0};
+    std::vector<int64_t> m_args;
+    uint64_t             m_real_begin{0};
+    uint64_t             m_cpu_begin{0};
+    uint64_t             m_real_ns{0};
+    uint64_t             m_cpu_ns{0};
+    int64_t              m_bytes_processed{0};
+    int64_t              m_items_processed{0};
+    std::string          m_label;
+    std::string          m_error;
+};
+
+/**
+ * @brief 已注册的用例
+ *
+ */
+class Benchmark
+{
+public:
+    using FuncType = std::function<void(State&)>;
+
+    Benchmark(std::string name, FuncType func)
+        : m_name(std::move(name))
+        , m_func(std::move(func))
+    {}
+
+    /**
+     * @brief 添加一组参数，每组参数单独运行一次
+     *
+     */
+    Benchmark* Arg(int64_t arg)
+    {
+        m_args.push_back({arg});
+        return this;
+    }
+    /**
+     * @brief 固定迭代次数，适用于会消耗系统资源（如端口）的用例
+     *
+     */
+    Benchmark* Iterations(uint64_t iterations)
+    {
+        m_fixed_iterations = iterations;
+        return this;
+    }
+
+private:
+    friend class Runner;
+
+    std::string                       m_name;
+    FuncType                          m_func;
+    std::vector<std::vector<int64_t>> m_args;
+    uint64_t                          m_fixed_iterations{0};
+};
+
+inline std::vector<std::unique_ptr<Benchmark>>& registry()
+{
+    static std::vector<std::unique_ptr<Benchmark>> instance;
+    return instance;
+}
+
+inline Benchmark* registerBenchmark(const char* name, Benchmark::FuncType func)
+{
+    registry().emplace_back(std::make_unique<Benchmark>(name, std::move(func)));
+    return registry().back().get();
+}
+
+/**
+ * @brief 运行所有用例并输出结果
+ *
+ */
+class Runner
+{
+public:
+    struct Result
+    {
+        std::string                   name;
+        uint64_t                      iterations{0};
+        double                        real_time_ns{0};
+        double                        cpu_time_ns{0};
+        double                        bytes_per_second{0};
+        double                        items_per_second{0};
+        std::string                   label;
+        std::string                   error;
+        std::map<std::string, double> counters;
+    };
+
+    int run(int argc, char** argv)
+    {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg(argv[i]);
+            if (parseArg(arg, "--benchmark_filter=", m_filter) ||
+                parseArg(arg, "--benchmark_format=", m_format) ||
+                parseArg(arg, "--benchmark_out=", m_out)) {
+                continue;
+            }
+            std::string min_time;
+            if (parseArg(arg, "--benchmark_min_time=", min_time)) {
+                m_min_time_s = std::stod(min_time);
+                continue;
+            }
+            fprintf(stderr, "unknown argument: %s\n", arg.c_str());
+            return -1;
+        }
+
+        if (m_format == "console") {
+            printf("%-48s %15s %15s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+            printf("%s\n", std::string(93, '-').c_str());
+        }
+
+        for (auto& benchmark : registry()) {
+            auto args_list = benchmark->m_args;
+            if (args_list.empty()) {
+                args_list.push_back({});
+            }
+            for (auto& args : args_list) {
+                std::string name = benchmark->m_name;
+                for (auto arg : args) {
+                    name += "/" + std::to_string(arg);
+                }
+                if (false == m_filter.empty() && name.find(m_filter) == std::string::npos) {
+                    continue;
+                }
+                auto result = runOne(*benchmark, name, args);
+                if (m_format == "console") {
+                    printConsole(result);
+                }
+                m_results.push_back(std::move(result));
+            }
+        }
+
+        if (m_format == "json") {
+            writeJson(stdout);
+        }
+        if (false == m_out.empty()) {
+            FILE* file = fopen(m_out.c_str(), "w");
+            if (nullptr == file) {
+                perror("open benchmark output failed");
+                return -1;
+            }
+            writeJson(file);
+            fclose(file);
+        }
+        return 0;
+    }
+
+private:
+    static bool parseArg(const std::string& arg, const char* prefix, std::string& value)
+    {
+        size_t prefix_len = strlen(prefix);
+        if (arg.compare(0, prefix_len, prefix) != 0) {
+            return false;
+        }
+        value = arg.substr(prefix_len);
+        return true;
+    }
+
+    Result runOne(Benchmark& benchmark, const std::string& name, const std::vector<int64_t>& args)
+    {
+        // 与google benchmark相同：逐步放大迭代次数，直到单次运行时间超过最短计时时间
+        uint64_t iterations = benchmark.m_fixed_iterations ? benchmark.m_fixed_iterations : 1;
+        while (true) {
+            State state(iterations, args);
+            benchmark.m_func(state);
+
+            double elapsed_s = state.m_real_ns / 1e9;
+            if (false == state.m_error.empty() || benchmark.m_fixed_iterations != 0 ||
+                elapsed_s >= m_min_time_s || iterations >= 1000000000) {
+                return makeResult(name, state);
+            }
+
+            double multiplier =
+                elapsed_s <= m_min_time_s / 10 ? 10.0 : m_min_time_s * 1.4 / elapsed_s;
+            iterations = std::max<uint64_t>(iterations + 1, iterations * multiplier);
+            iterations = std::min<uint64_t>(iterations, 1000000000);
+        }
+    }
+
+    static Result makeResult(const std::string& name, const State& state)
+    {
+        Result result;
+        result.name         = name;
+        result.iterations   = state.m_max_iterations;
+        result.real_time_ns = static_cast<double>(state.m_real_ns) / state.m_max_iterations;
+        result.cpu_time_ns  = static_cast<double>(state.m_cpu_ns) / state.m_max_iterations;
+        double elapsed_s    = state.m_real_ns / 1e9;
+        if (elapsed_s > 0) {
+            result.bytes_per_second = state.m_bytes_processed / elapsed_s;
+            result.items_per_second = state.m_items_processed / elapsed_s;
+        }
+        result.label    = state.m_label;
+        result.error    = state.m_error;
+        result.counters = state.counters;
+        return result;
+    }
+
+    static void printConsole(const Result& result)
+    {
+        if (false == result.error.empty()) {
+            printf("%-48s ERROR OCCURRED: '%s'\n", result.name.c_str(), result.error.c_str());
+            return;
+        }
+        printf("%-48s %12.1f ns %12.1f ns %12lu",
+               result.name.c_str(),
+               result.real_time_ns,
+               result.cpu_time_ns,
+               static_cast<unsigned long>(result.iterations));
+        if (result.bytes_per_second > 0) {
+            printf(" bytes_per_second=%.3gM/s", result.bytes_per_second / 1048576);
+        }
+        if (result.items_per_second > 0) {
+            printf(" items_per_second=%.3gk/s", result.items_per_second / 1000);
+        }
+        for (auto& counter : result.counters) {
+            printf(" %s=%g", counter.first.c_str(), counter.second);
+        }
+        if (false == result.label.empty()) {
+            printf(" %s", result.label.c_str());
+        }
+        printf("\n");
+    }
+
+    static std::string escape(const std::string& str)
+    {
+        std::string result;
+        for (char c : str) {
+            if (c == '"' || c == '\\') {
+                result.push_back('\\');
+            }
+            result.push_back(c);
+        }
+        return result;
+    }
+
+    void writeJson(FILE* file) const
+    {
+        char host_name[256]{0};
+        gethostname(host_name, sizeof(host_name) - 1);
+        char      date[64]{0};
+        time_t    now = time(nullptr);
+        struct tm local_time;
+        localtime_r(&now, &local_time);
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", &local_time);
+
+        fprintf(file, "{\n  \"context\": {\n");
+        fprintf(file, "    \"date\": \"%s\",\n", date);
+        fprintf(file, "    \"host_name\": \"%s\",\n", escape(host_name).c_str());
+        fprintf(file, "    \"executable\": \"jbench\",\n");
+        fprintf(file, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+#ifdef NDEBUG
+        fprintf(file, "    \"library_build_type\": \"release\"\n");
+#else
+        fprintf(file, "    \"library_build_type\": \"debug\"\n");
+#endif
+        fprintf(file, "  },\n  \"benchmarks\": [\n");
+        for (size_t i = 0; i < m_results.size(); ++i) {
+            auto& result = m_results[i];
+            fprintf(file, "    {\n");
+            fprintf(file, "      \"name\": \"%s\",\n", escape(result.name).c_str());
+            fprintf(file, "      \"run_name\": \"%s\",\n", escape(result.name).c_str());
+            fprintf(file, "      \"run_type\": \"iteration\",\n");
+            if (false == result.error.empty()) {
+                fprintf(file, "      \"error_occurred\": true,\n");
+                fprintf(file, "      \"error_message\": \"%s\",\n", escape(result.error).c_str());
+            }
+            fprintf(file,
+                    "      \"iterations\": %lu,\n",
+                    static_cast<unsigned long>(result.iterations));
+            fprintf(file, "      \"real_time\": %.6e,\n", result.real_time_ns);
+            fprintf(file, "      \"cpu_time\": %.6e,\n", result.cpu_time_ns);
+            fprintf(file, "      \"time_unit\": \"ns\"");
+            if (result.bytes_per_second > 0) {
+                fprintf(file, ",\n      \"bytes_per_second\": %.6e", result.bytes_per_second);
+            }
+            if (result.items_per_second > 0) {
+                fprintf(file, ",\n      \"items_per_second\": %.6e", result.items_per_second);
+            }
+            for (auto& counter : result.counters) {
+                fprintf(file,
+                        ",\n      \"%s\": %.6e",
+                        escape(counter.first).c_str(),
+                        counter.second);
+            }
+            if (false == result.label.empty()) {
+                fprintf(file, ",\n      \"label\": \"%s\"", escape(result.label).c_str());
+            }
+            fprintf(file, "\n    }%s\n", i + 1 == m_results.size() ? "" : ",");
+        }
+        fprintf(file, "  ]\n}\n");
+    }
+
+private:
+    std::string         m_filter;
+    std::string         m_format{"console"};
+    std::string         m_out;
+    double              m_min_time_s{0.5};
+    std::vector<Result> m_results;
+};
+
+}   // namespace JBench
+
+#define JBENCH_CONCAT_IMPL(a, b) a##b
+#define JBENCH_CONCAT(a, b) JBENCH_CONCAT_IMPL(a, b)
+
+/**
+ * @brief 注册用例
+ *
+ */
+#define JBENCH(func)                                                                          \
+    static ::JBench::Benchmark* JBENCH_CONCAT(jbench_registered_, __LINE__) [[maybe_unused]] = \
+        ::JBench::registerBenchmark(#func, func)
+
+/**
+ * @brief 生成main函数
+ *
+ */
+#define JBENCH_MAIN()                                                                         \
+    int main(int argc, char** argv)                                                           \
+    {                                                                                         \
+        return ::JBench::Runner().run(argc, argv);                                            \
+    }
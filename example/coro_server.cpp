@@ -0,0 +1,44 @@
+#include "JTCP/JTCP.h"
+#include <iostream>
+#include <thread>
+
+using namespace JTCP;
+
+/**
+ * @brief 以协程处理连接：按长度前缀帧读取请求，原样回包
+ *
+ */
+Server::CoTask echoFrames(Server::CoConnection& conn)
+{
+    std::string request;
+    while ((co_await conn.readFrame(request)).isSuccess()) {
+        if ((co_await conn.writeFrame(request.data(), request.size())).isFailure()) {
+            co_return;
+        }
+    }
+    std::cout << "client disconnect" << std::endl;
+}
+
+int main(int argc, char const* argv[])
+{
+    // 解析参数，获取监听的IP和端口
+    Types::IPStrType listen_ip{argv[1]};
+    Types::PortType  listen_port = static_cast<Types::PortType>(atoi(argv[2]));
+
+    Server::TCPServer server;
+    server.setOnNewClient([](Server::TCPPeerClientPtr client) {
+        std::cout << "new client connected" << std::endl;
+        Server::CoConnection::spawn(client, echoFrames);
+    });
+
+    auto ret = server.start(listen_ip, listen_port);
+    if (ret.isFailure()) {
+        perror(ret.getFailurePtr()->c_str());
+        return -1;
+    }
+
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    return 0;
+}
@@ -0,0 +1,457 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 回环压测工具：建立大量TCPClient连接压测回显服务，输出吞吐与延迟分布
+ *
+ * 用法：
+ *   loadgen [--host=127.0.0.1] [--port=0] [--connections=100] [--threads=1]
+ *           [--duration=10] [--warmup=1] [--rate=0] [--size=64]
+ *           [--mode=rr|stream] [--pipeline=16] [--server-spin-us=0]
+ *
+ *   --port=0        在进程内启动一个TCPServer回显服务，否则压测外部的回显服务（如example/server）
+ *   --rate=0        闭环模式，每个连接收到回复后立即发送下一个请求；
+ *                   大于0时为开环模式，按固定速率（所有线程合计，单位：请求/秒）发送请求
+ *   --mode=rr       请求-响应模式，每个连接同时只有一个请求
+ *   --mode=stream   流式模式，每个连接一次连续发送pipeline个消息再读取全部回显
+ *   --server-spin-us  进程内回显服务的自旋时长（ServerOptions::spin_duration），0表示不自旋
+ *
+ * 开环模式下延迟从请求“应当发送”的时刻开始计算，而不是实际发送的时刻，
+ * 因此服务端卡顿期间积压的请求会如实体现在尾延迟中（coordinated omission修正），
+ * 同时也给出未修正的延迟以便对比。
+ */
+#include "JTCP/JTCP.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace JTCP;
+
+namespace {
+
+using ClockType = std::chrono::steady_clock;
+
+constexpr Types::PortType EMBEDDED_PORT    = 19991;
+constexpr size_t          MAX_INFLIGHT_LEN = 65536;   ///< 单个连接一次在途的最大字节数
+
+/**
+ * @brief 命令行参数
+ *
+ */
+struct Options
+{
+    Types::IPStrType host{"127.0.0.1"};
+    Types::PortType  port{0};
+    size_t           connections{100};
+    size_t           threads{1};
+    double           duration_s{10};
+    double           warmup_s{1};
+    double           rate{0};
+    size_t           size{64};
+    std::string      mode{"rr"};
+    size_t           pipeline{16};
+    size_t           server_spin_us{0};
+};
+
+bool parseArg(const std::string& arg, const char* prefix, std::string& value)
+{
+    size_t len = strlen(prefix);
+    if (arg.compare(0, len, prefix) != 0) {
+        return false;
+    }
+    value = arg.substr(len);
+    return true;
+}
+
+bool parseOptions(int argc, char const* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]), value;
+        if (parseArg(arg, "--host=", value)) {
+            options.host = value;
+        }
+        else if (parseArg(arg, "--port=", value)) {
+            options.port = static_cast<Types::PortType>(std::stoul(value));
+        }
+        else if (parseArg(arg, "--connections=", value)) {
+            options.connections = std::stoul(value);
+        }
+        else if (parseArg(arg, "--threads=", value)) {
+            options.threads = std::stoul(value);
+        }
+        else if (parseArg(arg, "--duration=", value)) {
+            options.duration_s = std::stod(value);
+        }
+        else if (parseArg(arg, "--warmup=", value)) {
+            options.warmup_s = std::stod(value);
+        }
+        else if (parseArg(arg, "--rate=", value)) {
+            options.rate = std::stod(value);
+        }
+        else if (parseArg(arg, "--size=", value)) {
+            options.size = std::stoul(value);
+        }
+        else if (parseArg(arg, "--mode=", value)) {
+            options.mode = value;
+        }
+        else if (parseArg(arg, "--pipeline=", value)) {
+            options.pipeline = std::stoul(value);
+        }
+        else if (parseArg(arg, "--server-spin-us=", value)) {
+            options.server_spin_us = std::stoul(value);
+        }
+        else {
+            fprintf(stderr, "unknown argument: %s\n", arg.c_str());
+            return false;
+        }
+    }
+
+    if (options.mode == "rr") {
+        options.pipeline = 1;
+    }
+    else if (options.mode != "stream") {
+        fprintf(stderr, "unknown mode: %s\n", options.mode.c_str());
+        return false;
+    }
+    if (options.connections == 0 || options.threads == 0 || options.size == 0 ||
+        options.pipeline == 0) {
+        fprintf(stderr, "connections, threads, size and pipeline must be positive\n");
+        return false;
+    }
+    // 一次在途的数据必须能放进套接字缓冲区，否则双方都阻塞在发送上
+    if (options.size * options.pipeline > MAX_INFLIGHT_LEN) {
+        fprintf(stderr, "size * pipeline must not exceed %zu\n", MAX_INFLIGHT_LEN);
+        return false;
+    }
+    options.threads = std::min(options.threads, options.connections);
+    return true;
+}
+
+/**
+ * @brief 进程内回显服务
+ *
+ */
+class EchoServer
+{
+public:
+    JResultWithErrMsg start(const Types::IPStrType& ip, const Types::PortType& port,
+                            size_t backlog, size_t spin_us)
+    {
+        Server::ServerOptions server_options;
+        server_options.spin_duration = std::chrono::microseconds(spin_us);
+        m_server.setOptions(server_options);
+        m_server.setOnNewClient([](Server::TCPPeerClientPtr client) {
+            // 发送缓冲区满时未发出的数据留在连接自己的缓冲区中，暂停读取，
+            // 等可写回调发完后再继续读取，不在reactor线程上忙等，不影响同一reactor上的其他连接
+            auto pending   = std::make_shared<ByteBuffer>();
+            auto echo_data = [pending](Server::TCPPeerClient* ptr) {
+                char buff[MAX_INFLIGHT_LEN];
+                while (pending->empty()) {
+                    auto ret = ptr->readData(buff, sizeof(buff));
+                    if (ret.isFailure()) {
+                        return;
+                    }
+                    size_t len      = *(ret.getSuccessPtr());
+                    auto   send_ret = ptr->sendData(buff, len);
+                    if (send_ret.isFailure() && errno != EAGAIN && errno != EWOULDBLOCK) {
+                        return;
+                    }
+                    size_t sended = send_ret.isFailure() ? 0 : *(send_ret.getSuccessPtr());
+                    if (sended < len) {
+                        pending->append(buff + sended, len - sended);
+                        ptr->watchWritable(true);
+                    }
+                }
+            };
+            client->setOnRecvDataCB(echo_data);
+            client->setOnWritableCB([pending, echo_data](Server::TCPPeerClient* ptr) {
+                while (false == pending->empty()) {
+                    auto ret = ptr->sendData(pending->peek(), pending->readableBytes());
+                    if (ret.isFailure()) {
+                        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                            ptr->watchWritable(false);
+                        }
+                        return;
+                    }
+                    pending->retrieve(*(ret.getSuccessPtr()));
+                }
+                // 边缘触发下暂停期间到达的数据不会再次通知，发完后主动继续读取
+                ptr->watchWritable(false);
+                echo_data(ptr);
+            });
+        });
+        return m_server.start(ip, port, static_cast<Server::TCPServer::ListenMaxNumType>(backlog));
+    }
+
+    JResultWithErrMsg stop() { return m_server.stop(); }
+
+    Metrics::ReactorMetricsSnapshot getMetrics() const { return m_server.getMetrics().total(); }
+
+private:
+    Server::TCPServer m_server;
+};
+
+/**
+ * @brief 单个压测线程的统计
+ *
+ */
+struct WorkerStats
+{
+    Metrics::LatencyHistogram corrected;     ///< 从计划发送时刻开始计算的延迟
+    Metrics::LatencyHistogram uncorrected;   ///< 从实际发送时刻开始计算的延迟
+    uint64_t                  messages{0};   ///< 完成的消息数
+    uint64_t                  bytes{0};      ///< 收到的回显字节数
+    uint64_t                  errors{0};     ///< 收发失败次数
+};
+
+/**
+ * @brief 单个压测线程，负责一组连接
+ *
+ * 每一轮先在所有到期的连接上发送请求，再依次读取它们的回显，
+ * 使同一线程上的多个连接的请求能同时在途。
+ */
+class Worker
+{
+public:
+    Worker(const Options& options, std::vector<std::shared_ptr<Client::TCPClient>> clients)
+        : m_options(options)
+        , m_clients(std::move(clients))
+        , m_send_buff(options.size * options.pipeline, 'x')
+        , m_recv_buff(options.size * options.pipeline)
+    {}
+
+    void run(ClockType::time_point begin, ClockType::time_point measure_begin,
+             ClockType::time_point end)
+    {
+        // 开环模式下本线程的请求间隔
+        std::chrono::nanoseconds interval{0};
+        if (m_options.rate > 0) {
+            interval = std::chrono::nanoseconds(
+                static_cast<int64_t>(1e9 * m_options.threads / m_options.rate));
+        }
+        auto   next_intended = begin;
+        size_t next_client   = 0;
+
+        std::vector<Pending> batch;
+        batch.reserve(m_clients.size());
+        while (true) {
+            auto now = ClockType::now();
+            if (now >= end) {
+                break;
+            }
+
+            batch.clear();
+            if (interval.count() == 0) {
+                for (size_t i = 0; i < m_clients.size(); ++i) {
+                    batch.push_back({i, now, now});
+                }
+            }
+            else {
+                // 取出所有已经到期的请求，每个连接同时最多一个
+                while (batch.size() < m_clients.size() && next_intended <= now) {
+                    batch.push_back({next_client, next_intended, now});
+                    next_intended += interval;
+                    next_client = (next_client + 1) % m_clients.size();
+                }
+                if (batch.empty()) {
+                    waitUntil(next_intended);
+                    continue;
+                }
+            }
+
+            for (auto& pending : batch) {
+                pending.sent = ClockType::now();
+                if (m_clients[pending.index]
+                        ->sendData(m_send_buff.data(), m_send_buff.size())
+                        .isFailure()) {
+                    ++m_stats.errors;
+                    pending.index = m_clients.size();
+                }
+            }
+            for (auto& pending : batch) {
+                if (pending.index < m_clients.size()) {
+                    receive(pending, pending.sent >= measure_begin);
+                }
+            }
+        }
+    }
+
+    const WorkerStats& getStats() const { return m_stats; }
+
+private:
+    struct Pending
+    {
+        size_t                index;      ///< 连接下标
+        ClockType::time_point intended;   ///< 计划发送时刻
+        ClockType::time_point sent;       ///< 实际发送时刻
+    };
+
+    static void waitUntil(ClockType::time_point deadline)
+    {
+        // 较长的等待交给调度器，最后一小段自旋以保证发送时刻的精度
+        auto remain = deadline - ClockType::now();
+        if (remain > std::chrono::microseconds(200)) {
+            std::this_thread::sleep_for(remain - std::chrono::microseconds(100));
+        }
+        while (ClockType::now() < deadline) {}
+    }
+
+    void receive(const Pending& pending, bool record)
+    {
+        auto&  client   = m_clients[pending.index];
+        size_t total    = m_recv_buff.size();
+        size_t received = 0, completed = 0;
+        while (received < total) {
+            size_t len = total - received;
+            if (client->recvData(m_recv_buff.data() + received, len).isFailure() || len == 0) {
+                ++m_stats.errors;
+                return;
+            }
+            received += len;
+
+            // 记录本次读取中完整收到的每个消息的延迟
+            auto done = ClockType::now();
+            for (; completed < received / m_options.size; ++completed) {
+                if (false == record) {
+                    continue;
+                }
+                m_stats.corrected.record(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(done - pending.intended)
+                        .count()));
+                m_stats.uncorrected.record(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(done - pending.sent)
+                        .count()));
+            }
+        }
+        if (record) {
+            m_stats.messages += m_options.pipeline;
+            m_stats.bytes += total;
+        }
+    }
+
+private:
+    const Options&                                  m_options;
+    std::vector<std::shared_ptr<Client::TCPClient>> m_clients;
+    std::vector<char>                               m_send_buff;
+    std::vector<char>                               m_recv_buff;
+    WorkerStats                                     m_stats;
+};
+
+void printLatency(const char* name, const Metrics::HistogramSnapshot& snapshot)
+{
+    printf("%-12s p50 %10.1f  p99 %10.1f  p99.9 %10.1f  max %10.1f  mean %10.1f (us)\n",
+           name,
+           snapshot.percentile(50) / 1e3,
+           snapshot.percentile(99) / 1e3,
+           snapshot.percentile(99.9) / 1e3,
+           snapshot.max() / 1e3,
+           snapshot.mean() / 1e3);
+}
+
+}   // namespace
+
+int main(int argc, char const* argv[])
+{
+    Options options;
+    if (false == parseOptions(argc, argv, options)) {
+        return -1;
+    }
+
+    // 未指定端口时在进程内启动回显服务
+    std::unique_ptr<EchoServer> echo_server{nullptr};
+    if (options.port == 0) {
+        options.port = EMBEDDED_PORT;
+        echo_server  = std::make_unique<EchoServer>();
+        if (auto ret = echo_server->start(
+                options.host, options.port, options.connections, options.server_spin_us);
+            ret.isFailure()) {
+            fprintf(stderr, "start echo server failed: %s\n", ret.getFailurePtr()->c_str());
+            return -1;
+        }
+    }
+
+    // 建立连接，按线程平均分配
+    std::vector<std::vector<std::shared_ptr<Client::TCPClient>>> thread_clients(options.threads);
+    for (size_t i = 0; i < options.connections; ++i) {
+        auto client_ret = Client::TCPClient::createNew(options.host, options.port);
+        if (client_ret.isFailure()) {
+            fprintf(stderr,
+                    "connection %zu failed: %s\n",
+                    i,
+                    client_ret.getFailurePtr()->c_str());
+            return -1;
+        }
+        thread_clients[i % options.threads].push_back(*client_ret.getSuccessPtr());
+    }
+    printf("%zu connections to %s:%u, %zu threads, mode %s, size %zu, pipeline %zu, rate %s\n",
+           options.connections,
+           options.host.c_str(),
+           options.port,
+           options.threads,
+           options.mode.c_str(),
+           options.size,
+           options.pipeline,
+           options.rate > 0 ? std::to_string(static_cast<uint64_t>(options.rate)).c_str()
+                            : "closed loop");
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (auto& clients : thread_clients) {
+        workers.emplace_back(std::make_unique<Worker>(options, std::move(clients)));
+    }
+
+    auto begin = ClockType::now();
+    auto measure_begin =
+        begin + std::chrono::nanoseconds(static_cast<int64_t>(options.warmup_s * 1e9));
+    auto end =
+        measure_begin + std::chrono::nanoseconds(static_cast<int64_t>(options.duration_s * 1e9));
+
+    std::vector<std::thread> threads;
+    for (auto& worker : workers) {
+        threads.emplace_back(&Worker::run, worker.get(), begin, measure_begin, end);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // 汇总并输出结果
+    Metrics::HistogramSnapshot corrected, uncorrected;
+    uint64_t                   messages{0}, bytes{0}, errors{0};
+    for (auto& worker : workers) {
+        auto& stats = worker->getStats();
+        corrected.merge(stats.corrected.snapshot());
+        uncorrected.merge(stats.uncorrected.snapshot());
+        messages += stats.messages;
+        bytes += stats.bytes;
+        errors += stats.errors;
+    }
+
+    printf("messages %lu, errors %lu, throughput %.0f msg/s, %.2f MiB/s\n",
+           static_cast<unsigned long>(messages),
+           static_cast<unsigned long>(errors),
+           messages / options.duration_s,
+           bytes / options.duration_s / (1024 * 1024));
+    printLatency("latency", corrected);
+    if (options.rate > 0) {
+        printLatency("uncorrected", uncorrected);
+    }
+
+    if (echo_server != nullptr) {
+        auto metrics = echo_server->getMetrics();
+        printf("server: wakeups %lu, events/wakeup p50 %lu, callback p99 %.1f us\n",
+               static_cast<unsigned long>(metrics.epoll_wakeups),
+               static_cast<unsigned long>(metrics.events_per_wakeup.percentile(50)),
+               metrics.callback_duration_ns.percentile(99) / 1e3);
+    }
+
+    // 先关闭客户端再停止服务，避免服务端端口进入TIME_WAIT
+    workers.clear();
+    if (echo_server != nullptr) {
+        echo_server->stop();
+    }
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#include "JTCP/common/trace.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace JTCP;
+
+const char* eventName(uint16_t type)
+{
+    switch (static_cast<Trace::EventType>(type)) {
+    case Trace::EventType::ACCEPT: return "accept";
+    case Trace::EventType::EPOLL_WAKEUP: return "epoll_wakeup";
+    case Trace::EventType::READ: return "read";
+    case Trace::EventType::CALLBACK: return "callback";
+    case Trace::EventType::SEND: return "send";
+    case Trace::EventType::SEND_PARTIAL: return "send_partial";
+    case Trace::EventType::ACCEPT_REJECT: return "accept_reject";
+    case Trace::EventType::DISCONNECT: return "disconnect";
+    }
+    return "unknown";
+}
+
+int main(int argc, char const* argv[])
+{
+    if (argc < 2) {
+        printf("usage: %s <trace file>\n", argv[0]);
+        return -1;
+    }
+
+    FILE* file = fopen(argv[1], "rb");
+    if (nullptr == file) {
+        perror("open trace file failed");
+        return -1;
+    }
+
+    // 校验文件头
+    Trace::FileHeader file_header;
+    if (fread(&file_header, sizeof(file_header), 1, file) != 1 ||
+        memcmp(file_header.magic, "JTCPTRC", 8) != 0 ||
+        file_header.record_size != sizeof(Trace::TraceRecord)) {
+        printf("invalid trace file\n");
+        fclose(file);
+        return -1;
+    }
+
+    // 按线程输出CSV：线程id,时间戳,事件,fd,value,aux
+    printf("thread_id,timestamp_ns,event,fd,value,aux\n");
+    for (uint32_t i = 0; i < file_header.thread_count; ++i) {
+        Trace::ThreadHeader thread_header;
+        if (fread(&thread_header, sizeof(thread_header), 1, file) != 1) {
+            break;
+        }
+        std::vector<Trace::TraceRecord> records(thread_header.record_count);
+        if (fread(records.data(), sizeof(Trace::TraceRecord), records.size(), file) !=
+            records.size()) {
+            break;
+        }
+        for (auto& record : records) {
+            printf("%lu,%lu,%s,%d,%ld,%lu\n",
+                   thread_header.thread_id,
+                   record.timestamp_ns,
+                   eventName(record.type),
+                   record.fd,
+                   record.value,
+                   record.aux);
+        }
+    }
+
+    fclose(file);
+    return 0;
+}
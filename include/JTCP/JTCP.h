@@ -6,6 +6,12 @@
 #pragma once
 
 #include "JTCP/server/server.h"
+#include "JTCP/server/reactor.h"
+#include "JTCP/server/coroutine.h"
+#include "JTCP/client/async_client.h"
 #include "JTCP/client/client.h"
+#include "JTCP/client/client_pool.h"
+#include "JTCP/common/resolver.h"
+#include "JTCP/common/shm_channel.h"
 
 #pragma once
\ No newline at end of file
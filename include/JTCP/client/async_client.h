@@ -0,0 +1,149 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 非阻塞的异步TCP客户端
+ */
+#pragma once
+
+#include "JResult/JResult.h"
+#include "JTCP/client/client_loop.h"
+#include "JTCP/common/byte_buffer.h"
+#include "JTCP/common/common_define.h"
+#include "JTCP/common/socket_options.h"
+#include <atomic>
+#include <functional>
+#include <future>
+#include <mutex>
+
+namespace JTCP::Client {
+
+/**
+ * @brief 非阻塞的异步TCP客户端
+ *
+ * 由TCPClientLoop驱动：connect立即返回，连接结果通过EPOLLOUT得到并以回调和future通知；
+ * 收到的数据累积在接收缓冲区中交给回调，回调只取走完整的帧，剩余部分留待下次数据到达；
+ * sendData可在任意线程调用，发不完的数据进入发送队列，待套接字可写时由事件循环继续发送。
+ */
+class AsyncTCPClient : public std::enable_shared_from_this<AsyncTCPClient>
+{
+public:
+    explicit AsyncTCPClient(TCPClientLoop* loop)
+        : m_loop(loop)
+    {}
+    AsyncTCPClient(const AsyncTCPClient&) = delete;
+    AsyncTCPClient(AsyncTCPClient&&)      = delete;
+
+    /**
+     * @brief 连接结果回调类型，第二个参数表示是否连接成功
+     *
+     */
+    using OnConnectCBType = std::function<void(AsyncTCPClient*, bool)>;
+    /**
+     * @brief 数据到达回调类型，回调中从缓冲区取走已处理的数据，未取走的数据会保留
+     *
+     */
+    using OnRecvDataCBType = std::function<void(AsyncTCPClient*, ByteBuffer&)>;
+    /**
+     * @brief 连接关闭回调类型
+     *
+     */
+    using OnCloseCBType = std::function<void(AsyncTCPClient*)>;
+
+public:
+    /**
+     * @brief 创建新的异步客户端
+     *
+     * @param loop 驱动该客户端的事件循环，生命周期需长于客户端的连接
+     * @param socket_options 在connect前设置的套接字选项
+     * @return JResultWithSuccErrMsg<AsyncTCPClientPtr> 创建结果
+     */
+    static JResultWithSuccErrMsg<AsyncTCPClientPtr> createNew(
+        TCPClientLoop& loop, const SocketOptions& socket_options = {});
+
+    /**
+     * @brief 设置回调，需在connect之前设置，回调均在事件循环线程上执行
+     *
+     */
+    void setOnConnectCB(OnConnectCBType cb);
+    void setOnRecvDataCB(OnRecvDataCBType cb);
+    void setOnCloseCB(OnCloseCBType cb);
+
+    /**
+     * @brief 发起非阻塞连接
+     *
+     * @param server_ip 服务器IP地址，或"unix:"前缀的Unix域套接字地址
+     * @param server_port 服务器端口
+     * @return std::future<bool> 连接结果，true表示连接成功
+     */
+    std::future<bool> connect(const Types::IPStrType& server_ip,
+                              const Types::PortType&  server_port);
+
+    /**
+     * @brief 发送消息，可在任意线程调用
+     *
+     * 发送队列为空时直接在调用线程上发送，发不完的部分进入发送队列；
+     * 连接建立前发送的数据会在连接成功后发出。
+     *
+     * @param data 消息数据首地址
+     * @param len 消息长度
+     * @return JResultWithErrMsg 连接已关闭时返回失败
+     */
+    JResultWithErrMsg sendData(const char* data, size_t len);
+
+    /**
+     * @brief 关闭连接，可在任意线程调用，关闭回调在事件循环线程上执行
+     *
+     */
+    void close();
+
+    bool isConnected() const noexcept { return m_state == State::CONNECTED; }
+    bool isClosed() const noexcept { return m_state == State::CLOSED; }
+
+    /**
+     * @brief 发送队列中尚未发出的字节数
+     *
+     */
+    size_t getPendingSendBytes();
+
+    FileDescribePtr getFileDescribe() const noexcept { return m_fd; }
+
+private:
+    enum class State : uint8_t
+    {
+        DISCONNECTED,   ///< 未连接
+        CONNECTING,     ///< 连接中
+        CONNECTED,      ///< 已连接
+        CLOSED,         ///< 已关闭
+    };
+
+    friend class TCPClientLoop;
+    void handleEvent(uint32_t events);
+    void handleConnect();
+    void handleRead();
+    void handleClose();
+
+    /**
+     * @brief 尽可能多地发送队列中的数据，调用时需持有m_send_mutex
+     *
+     * @return true 连接正常
+     * @return false 发送出错，连接需要关闭
+     */
+    bool flushSendBuffer();
+
+private:
+    TCPClientLoop*     m_loop{nullptr};                ///< 事件循环
+    FileDescribePtr    m_fd{nullptr};                  ///< 文件描述符
+    std::atomic<State> m_state{State::DISCONNECTED};   ///< 连接状态
+    std::promise<bool> m_connect_promise;              ///< 连接结果
+    SocketOptions      m_socket_options;               ///< 套接字选项
+
+    OnConnectCBType  m_on_connect_cb{[](AsyncTCPClient*, bool) {}};
+    OnRecvDataCBType m_on_recv_data_cb{[](AsyncTCPClient*, ByteBuffer&) {}};
+    OnCloseCBType    m_on_close_cb{[](AsyncTCPClient*) {}};
+
+    ByteBuffer m_recv_buff;    ///< 接收缓冲区，只在事件循环线程上访问
+    ByteBuffer m_send_buff;    ///< 发送队列
+    std::mutex m_send_mutex;   ///< 发送队列锁
+};
+
+}   // namespace JTCP::Client
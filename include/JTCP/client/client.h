@@ -6,14 +6,32 @@
 #pragma once
 
 #include "JResult/JResult.h"
+#include "JTCP/common/byte_buffer.h"
 #include "JTCP/common/common_define.h"
 #include "JTCP/common/file_describe.h"
+#include "JTCP/common/socket_address.h"
+#include "JTCP/common/socket_options.h"
+#include <chrono>
+#include <string_view>
+#include <sys/uio.h>
+#include <vector>
 
 /**
  * @brief 客户端命名空间
  *
  */
 namespace JTCP::Client {
+/**
+ * @brief 建立连接的选项
+ *
+ */
+struct ConnectOptions
+{
+    std::chrono::milliseconds timeout{5000};        ///< 建立连接的总超时，为0表示不限
+    std::chrono::milliseconds attempt_delay{250};   ///< 相邻两个地址发起连接的间隔
+    SocketOptions             socket_options;       ///< connect前设置的套接字选项，不使用TFO
+};
+
 /**
  * @brief TCP客户端类
  *
@@ -33,15 +51,45 @@ public:
     /**
      * @brief 创建新的TCP客户端
      *
-     * @param server_ip 服务器IP地址
+     * @param server_ip 服务器IP地址，或"unix:"前缀的Unix域套接字地址
      * @param server_port 服务器端口
+     * @param socket_options 在connect前设置的套接字选项
      * @return JResultWithSuccErrMsg<std::shared_ptr<TCPClient>> 创建结果
      */
     static JResultWithSuccErrMsg<std::shared_ptr<TCPClient>> createNew(
-        const Types::IPStrType& server_ip, const Types::PortType& server_port);
+        const Types::IPStrType& server_ip, const Types::PortType& server_port,
+        const SocketOptions& socket_options = {});
+
+    /**
+     * @brief 按主机名创建TCP客户端
+     *
+     * 主机名经Resolver解析为IPv6、IPv4交替排列的地址列表后调用地址列表版本的connectTo。
+     *
+     * @param host 主机名或IP字面量
+     * @param port 服务器端口
+     * @param options 连接选项
+     * @return JResultWithSuccErrMsg<std::shared_ptr<TCPClient>> 创建结果
+     */
+    static JResultWithSuccErrMsg<std::shared_ptr<TCPClient>> connectTo(
+        const std::string& host, const Types::PortType& port, const ConnectOptions& options = {});
+
+    /**
+     * @brief 并行连接多个地址，返回最先建立的连接
+     *
+     * 按顺序以非阻塞方式发起连接，每隔attempt_delay发起下一个，某个尝试失败时立即发起下一个；
+     * 任一连接建立后关闭其余尝试。返回的连接恢复为阻塞模式。
+     *
+     * @param addrs 候选地址，靠前的优先
+     * @param options 连接选项
+     * @return JResultWithSuccErrMsg<std::shared_ptr<TCPClient>> 创建结果，全部失败或超时时返回失败
+     */
+    static JResultWithSuccErrMsg<std::shared_ptr<TCPClient>> connectTo(
+        const std::vector<SocketAddress>& addrs, const ConnectOptions& options = {});
 
     /**
-     * @brief 发送消息
+     * @brief 立即发送消息，部分发送时继续发送直到全部发出
+     *
+     * 发送缓冲区中有尚未发出的数据时，与本次数据合并为一次writev发出，保证顺序。
      *
      * @param data 消息数据首地址
      * @param len 消息长度
@@ -50,15 +98,107 @@ public:
     JResultWithErrMsg sendData(const char* data, size_t len);
 
     /**
-     * @brief 接收消息
+     * @brief 批量发送多段数据，映射为尽量少的writev调用
+     *
+     * @param datas 数据段首地址
+     * @param count 数据段数量
+     * @return JResultWithErrMsg 发送结果，全部发出才返回成功
+     */
+    JResultWithErrMsg sendBatch(const std::string_view* datas, size_t count);
+    JResultWithErrMsg sendBatch(const std::vector<std::string_view>& datas)
+    {
+        return sendBatch(datas.data(), datas.size());
+    }
+
+    /**
+     * @brief 把消息写入发送缓冲区，缓冲的数据达到阈值时自动发送
+     *
+     * 适用于连续发送大量小消息的场景，多个消息合并为一次系统调用，需在最后调用flush。
      *
      * @param data 消息数据首地址
      * @param len 消息长度
+     * @return JResultWithErrMsg 写入结果，自动发送失败时返回失败
+     */
+    JResultWithErrMsg bufferData(const char* data, size_t len);
+
+    /**
+     * @brief 发出发送缓冲区中的全部数据
+     *
+     * @return JResultWithErrMsg 发送结果
+     */
+    JResultWithErrMsg flush();
+
+    /**
+     * @brief 设置自动发送的阈值
+     *
+     */
+    void   setFlushThreshold(size_t threshold) noexcept { m_flush_threshold = threshold; }
+    size_t getBufferedBytes() const noexcept { return m_send_buff.readableBytes(); }
+
+    /**
+     * @brief 接收缓冲区中预读但尚未取走的字节数
+     *
+     */
+    size_t getRecvBufferedBytes() const noexcept { return m_recv_buff.readableBytes(); }
+
+    /**
+     * @brief 接收消息，优先返回接收缓冲区中预读的数据
+     *
+     * @param data 消息数据首地址
+     * @param len 传入缓冲区长度，返回实际接收的长度，为0表示对端已关闭
      * @return JResultWithErrMsg 接收结果
      */
     JResultWithErrMsg recvData(char* data, size_t& len);
 
+    /**
+     * @brief 接收恰好len字节的数据
+     *
+     * 小于预读阈值的请求先整块读入内部接收缓冲区再拷贝，多出的数据留给后续调用，减少系统调用次数；
+     * 大块数据直接读入用户缓冲区。
+     *
+     * @param data 消息数据首地址
+     * @param len 需要接收的长度
+     * @return JResultWithErrMsg 接收结果，对端在收满之前关闭时返回失败
+     */
+    JResultWithErrMsg recvExact(char* data, size_t len);
+
+    /**
+     * @brief 接收数据直到出现分隔符
+     *
+     * @param delim 分隔符
+     * @param max_len 最多接收的长度（含分隔符），超过仍未出现分隔符时返回失败
+     * @return JResultWithSuccErrMsg<std::string> 接收到的数据，包含分隔符
+     */
+    JResultWithSuccErrMsg<std::string> recvUntil(std::string_view delim,
+                                                 size_t           max_len = MAX_RECV_UNTIL_LEN);
+
+    static constexpr size_t READ_AHEAD_LEN     = 16 * 1024;     ///< 小于该长度的读取走预读缓冲区
+    static constexpr size_t MAX_RECV_UNTIL_LEN = 1024 * 1024;   ///< recvUntil默认的最大长度
+    static constexpr size_t FLUSH_THRESHOLD    = 64 * 1024;     ///< 默认的自动发送阈值
+
+    FileDescribePtr getFileDescribe() const noexcept { return m_fd; }
+
+private:
+    /**
+     * @brief 从套接字读取一次数据到接收缓冲区
+     *
+     * @return JResultWithErrMsg 对端关闭或读取出错时返回失败
+     */
+    JResultWithErrMsg fillRecvBuffer();
+
+    /**
+     * @brief 发送iovec数组中的全部数据，部分发送时调整iovec后继续
+     *
+     * @param iov iovec数组，发送过程中会被修改
+     * @param count iovec数量
+     * @return JResultWithErrMsg 发送结果
+     */
+    JResultWithErrMsg sendIOV(struct iovec* iov, size_t count);
+
 private:
-    FileDescribePtr m_fd{nullptr};   ///< 文件描述符
+    FileDescribePtr m_fd{nullptr};                        ///< 文件描述符
+    ByteBuffer      m_recv_buff;                          ///< 接收缓冲区，保存预读的数据
+    ByteBuffer      m_send_buff;                          ///< 发送缓冲区
+    size_t          m_flush_threshold{FLUSH_THRESHOLD};   ///< 自动发送阈值
 };
 }   // namespace JTCP::Client
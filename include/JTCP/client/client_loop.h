@@ -0,0 +1,143 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 异步客户端的事件循环
+ */
+#pragma once
+
+#include "JResult/JResult.h"
+#include "JTCP/common/file_describe.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace JTCP::Client {
+
+/**
+ * @brief 事件循环选项
+ *
+ */
+struct ClientLoopOptions
+{
+    /**
+     * @brief 每次epoll_wait最多取出的事件数
+     *
+     * 事件数组从较小的长度开始，取满时翻倍直到该上限，与ServerOptions::max_events_per_wakeup相同。
+     */
+    uint32_t max_events_per_wakeup{1024};
+};
+
+class AsyncTCPClient;
+using AsyncTCPClientPtr = std::shared_ptr<AsyncTCPClient>;
+
+/**
+ * @brief 异步客户端的事件循环
+ *
+ * 与TCPServer相同的reactor模型：一个线程通过epoll边缘触发驱动其上的所有AsyncTCPClient，
+ * 其他线程通过eventfd唤醒并投递任务，成千上万个连接只需要一个线程。
+ */
+class TCPClientLoop
+{
+public:
+    explicit TCPClientLoop(ClientLoopOptions options = {})
+        : m_options(options)
+    {}
+    ~TCPClientLoop();
+    TCPClientLoop(const TCPClientLoop&) = delete;
+    TCPClientLoop(TCPClientLoop&&)      = delete;
+
+    using TaskType = std::function<void()>;
+
+public:
+    /**
+     * @brief 启动事件循环线程
+     *
+     * @return JResultWithErrMsg 启动结果
+     */
+    JResultWithErrMsg start();
+    /**
+     * @brief 停止事件循环线程，其上仍然存活的连接会被关闭并触发关闭回调
+     *
+     * @return JResultWithErrMsg 返回值
+     */
+    JResultWithErrMsg stop();
+
+    /**
+     * @brief 在事件循环线程上执行任务，当前已在事件循环线程上时直接执行
+     *
+     */
+    void runInLoop(TaskType task);
+    /**
+     * @brief 把任务投递到事件循环线程，在本轮事件处理完后执行
+     *
+     * 事件循环已经停止时直接在调用线程上执行，此时注册连接会失败，连接的结果回调不会丢失。
+     */
+    void queueInLoop(TaskType task);
+
+    bool isInLoopThread() const noexcept { return std::this_thread::get_id() == m_loop_thread_id; }
+
+    /**
+     * @brief 当前注册在事件循环上的连接数量，只能在事件循环线程上调用
+     *
+     */
+    size_t getClientNum() const noexcept { return m_clients.size(); }
+
+private:
+    friend class AsyncTCPClient;
+    JResultWithErrMsg addClient(const AsyncTCPClientPtr& client);
+    void              delClient(FileDescribe::FDType fd);
+
+    JResultWithErrMsg loopThreadFunc();
+    void              wakeup();
+
+    /**
+     * @brief 执行已投递的任务
+     *
+     * @param final_run 是否为退出前的最后一次执行，为true时执行到队列为空，并拒绝之后的投递
+     */
+    void doPendingTasks(bool final_run = false);
+
+    /**
+     * @brief 事件句柄：高32位为注册代数，低32位为fd，eventfd的代数为0
+     *
+     * fd在本轮事件处理中被关闭并由新连接复用时，旧连接的事件按代数丢弃
+     */
+    using HandleType = uint64_t;
+    static HandleType makeHandle(FileDescribe::FDType fd, uint32_t generation) noexcept
+    {
+        return (static_cast<HandleType>(generation) << 32) | static_cast<uint32_t>(fd);
+    }
+
+private:
+    ClientLoopOptions              m_options;              ///< 事件循环选项
+    FileDescribePtr                m_epoll_fd{nullptr};    ///< epoll文件描述符
+    FileDescribePtr                m_wakeup_fd{nullptr};   ///< 唤醒用的eventfd
+    std::future<JResultWithErrMsg> m_loop_thread;          ///< 事件循环线程
+    std::atomic<std::thread::id>   m_loop_thread_id;       ///< 事件循环线程ID
+    std::atomic<bool>              m_run_flag{false};      ///< 运行标志
+
+    std::mutex            m_tasks_mutex;            ///< 任务队列锁
+    std::vector<TaskType> m_tasks;                  ///< 待执行的任务
+    bool                  m_tasks_closed{false};    ///< 事件循环已退出，不再接受投递
+
+    /**
+     * @brief 注册的连接及其注册代数
+     *
+     */
+    struct RegisteredClient
+    {
+        AsyncTCPClientPtr client{nullptr};
+        uint32_t          generation{0};
+    };
+    using ClientMgrType = std::unordered_map<FileDescribe::FDType, RegisteredClient>;
+    ClientMgrType m_clients;         ///< 注册的连接，只在事件循环线程上访问
+    uint32_t      m_generation{0};   ///< 最近一次注册使用的代数
+};
+
+}   // namespace JTCP::Client
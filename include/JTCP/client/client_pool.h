@@ -0,0 +1,216 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief TCP客户端连接池
+ */
+#pragma once
+
+#include "JResult/JResult.h"
+#include "JTCP/client/client.h"
+#include "JTCP/client/pipeline_channel.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace JTCP::Client {
+
+/**
+ * @brief 连接池配置
+ *
+ */
+struct ClientPoolOptions
+{
+    size_t                    max_per_host{16};         ///< 每个(ip, port)最多的连接数
+    std::chrono::milliseconds idle_timeout{60000};      ///< 空闲超过该时长的连接会被回收
+    std::chrono::milliseconds check_interval{1000};     ///< 回收与健康检查的周期
+    TCPClientLoop*            pipeline_loop{nullptr};   ///< 多路复用通道的事件循环，为空时不可用
+    SocketOptions             socket_options;           ///< 新建连接的套接字选项
+};
+
+/**
+ * @brief 单个(ip, port)的连接槽位
+ *
+ * 空闲连接放在固定数量的槽位中，借出、归还、回收都通过槽位状态的CAS完成，不需要加锁。
+ */
+class HostClientSlots
+{
+public:
+    HostClientSlots(const Types::IPStrType& ip, const Types::PortType& port, size_t slot_num)
+        : m_ip(ip)
+        , m_port(port)
+        , m_slots(new Slot[slot_num])
+        , m_slot_num(slot_num)
+    {}
+
+    using ClockType = std::chrono::steady_clock;
+
+public:
+    const Types::IPStrType& getIP() const noexcept { return m_ip; }
+    const Types::PortType&  getPort() const noexcept { return m_port; }
+
+    /**
+     * @brief 取出一个空闲连接
+     *
+     * @return std::shared_ptr<TCPClient> 没有空闲连接时返回nullptr
+     */
+    std::shared_ptr<TCPClient> take() noexcept;
+
+    /**
+     * @brief 放回一个空闲连接，没有空槽位时关闭该连接
+     *
+     */
+    void put(std::shared_ptr<TCPClient> client) noexcept;
+
+    /**
+     * @brief 预占一个新连接的名额
+     *
+     * @return true 未达到上限，预占成功
+     * @return false 已达到上限
+     */
+    bool reserve() noexcept;
+
+    /**
+     * @brief 连接关闭，释放其名额
+     *
+     */
+    void release() noexcept { m_live_num.fetch_sub(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief 关闭空闲超时或已被对端关闭的连接
+     *
+     * @param idle_timeout 空闲超时时长
+     */
+    void evict(std::chrono::milliseconds idle_timeout) noexcept;
+
+    size_t getIdleNum() const noexcept;
+
+    /**
+     * @brief 检查空闲连接是否仍然可用：对端未关闭，内核和用户态缓冲区中都没有残留数据
+     *
+     */
+    static bool isHealthy(const TCPClient& client) noexcept;
+
+private:
+    friend class TCPClientPool;
+    enum SlotState : uint32_t
+    {
+        EMPTY = 0,   ///< 没有连接
+        IDLE,        ///< 有空闲连接
+        BUSY,        ///< 正在被某个线程操作
+    };
+    struct Slot
+    {
+        std::atomic<uint32_t>      state{EMPTY};
+        std::shared_ptr<TCPClient> client{nullptr};
+        ClockType::time_point      last_used;
+    };
+
+    Types::IPStrType        m_ip;            ///< 服务器IP
+    Types::PortType         m_port{0};       ///< 服务器端口
+    std::unique_ptr<Slot[]> m_slots;         ///< 槽位
+    size_t                  m_slot_num{0};   ///< 槽位数量，等于每个host的最大连接数
+    std::atomic<size_t>     m_live_num{0};   ///< 存活的连接数，包括借出和空闲的
+
+    std::mutex            m_channel_mutex;      ///< 多路复用通道锁
+    TCPPipelineChannelPtr m_channel{nullptr};   ///< 多路复用通道
+};
+using HostClientSlotsPtr = std::shared_ptr<HostClientSlots>;
+
+/**
+ * @brief 从连接池借出的连接，析构时自动归还
+ *
+ */
+class PooledClient
+{
+public:
+    PooledClient(HostClientSlotsPtr host, std::shared_ptr<TCPClient> client)
+        : m_host(std::move(host))
+        , m_client(std::move(client))
+    {}
+    ~PooledClient();
+    PooledClient(const PooledClient&) = delete;
+    PooledClient(PooledClient&&)      = delete;
+
+    TCPClient* operator->() const noexcept { return m_client.get(); }
+    TCPClient* get() const noexcept { return m_client.get(); }
+
+    /**
+     * @brief 标记连接已损坏（如收发失败、协议错乱），归还时直接关闭而不放回池中
+     *
+     */
+    void markBroken() noexcept { m_broken = true; }
+
+private:
+    HostClientSlotsPtr         m_host{nullptr};
+    std::shared_ptr<TCPClient> m_client{nullptr};
+    bool                       m_broken{false};
+};
+
+/**
+ * @brief TCP客户端连接池
+ *
+ * 按(ip, port)保存已建立的连接，借出时优先复用空闲连接，省去每次请求的握手；
+ * 后台线程周期性地关闭空闲过久或已被对端关闭的连接。
+ * 配置了pipeline_loop时，还可以获取每个(ip, port)共享的多路复用通道，多个请求同时在一个连接上进行。
+ */
+class TCPClientPool
+{
+public:
+    explicit TCPClientPool(ClientPoolOptions options = ClientPoolOptions());
+    ~TCPClientPool();
+    TCPClientPool(const TCPClientPool&) = delete;
+    TCPClientPool(TCPClientPool&&)      = delete;
+
+public:
+    /**
+     * @brief 借出一个连接
+     *
+     * @param server_ip 服务器IP地址，或"unix:"前缀的Unix域套接字地址
+     * @param server_port 服务器端口
+     * @return JResultWithSuccErrMsg<std::shared_ptr<PooledClient>> 借出的连接，
+     *         达到上限或连接失败时返回失败
+     */
+    JResultWithSuccErrMsg<std::shared_ptr<PooledClient>> acquire(
+        const Types::IPStrType& server_ip, const Types::PortType& server_port);
+
+    /**
+     * @brief 获取(ip, port)共享的多路复用通道，通道断开后下次获取时重新建立
+     *
+     * @param server_ip 服务器IP地址，或"unix:"前缀的Unix域套接字地址
+     * @param server_port 服务器端口
+     * @return JResultWithSuccErrMsg<TCPPipelineChannelPtr> 通道
+     */
+    JResultWithSuccErrMsg<TCPPipelineChannelPtr> getChannel(const Types::IPStrType& server_ip,
+                                                            const Types::PortType&  server_port);
+
+    /**
+     * @brief 获取(ip, port)当前空闲的连接数
+     *
+     */
+    size_t getIdleNum(const Types::IPStrType& server_ip, const Types::PortType& server_port);
+
+private:
+    HostClientSlotsPtr getHost(const Types::IPStrType& server_ip,
+                               const Types::PortType&  server_port);
+    void               evictThreadFunc();
+
+private:
+    ClientPoolOptions m_options;
+
+    using HostMapType    = std::unordered_map<std::string, HostClientSlotsPtr>;
+    using HostMapPtrType = std::shared_ptr<const HostMapType>;
+    HostMapPtrType m_hosts;         ///< 只读的host表，新增host时整体替换
+    std::mutex     m_hosts_mutex;   ///< 新增host时使用的锁
+
+    std::mutex              m_evict_mutex;      ///< 回收线程休眠用的锁
+    std::condition_variable m_evict_cv;         ///< 回收线程休眠用的条件变量
+    bool                    m_run_flag{true};   ///< 运行标志
+    std::thread             m_evict_thread;     ///< 回收线程
+};
+
+}   // namespace JTCP::Client
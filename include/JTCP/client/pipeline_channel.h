@@ -0,0 +1,136 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 以关联ID区分请求的多路复用通道
+ */
+#pragma once
+
+#include "JResult/JResult.h"
+#include "JTCP/client/async_client.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace JTCP::Client {
+
+/**
+ * @brief 多路复用通道的帧格式
+ *
+ * 每帧为12字节的头部加负载：4字节负载长度、8字节关联ID，均为网络字节序。
+ * 服务端按同样的格式回包，并原样带回请求的关联ID，回包顺序可以与请求顺序不同。
+ */
+class PipelineFrame
+{
+public:
+    using CorrelationIDType = uint64_t;
+
+    static constexpr size_t HEADER_LEN      = 12;                  ///< 头部长度
+    static constexpr size_t MAX_PAYLOAD_LEN = 64 * 1024 * 1024;   ///< 负载最大长度
+
+    /**
+     * @brief 把一帧追加到缓冲区
+     *
+     */
+    static void encode(ByteBuffer& buff, CorrelationIDType id, const char* data, size_t len);
+
+    /**
+     * @brief 从缓冲区头部解析一帧
+     *
+     * @param buff 缓冲区，解析成功时取走该帧
+     * @param id 关联ID
+     * @param payload 负载
+     * @return JResultWithSuccErrMsg<bool> 解析到完整的帧时为true，数据不完整时为false，
+     *         帧长度非法时返回失败
+     */
+    static JResultWithSuccErrMsg<bool> decode(ByteBuffer& buff, CorrelationIDType& id,
+                                              std::string& payload);
+};
+
+class TCPPipelineChannel;
+using TCPPipelineChannelPtr = std::shared_ptr<TCPPipelineChannel>;
+
+/**
+ * @brief 多路复用通道
+ *
+ * 在一个AsyncTCPClient连接上同时进行多个请求，每个请求分配唯一的关联ID，
+ * 回包按关联ID交给对应的回调，无需等待前一个请求完成。
+ */
+class TCPPipelineChannel : public std::enable_shared_from_this<TCPPipelineChannel>
+{
+public:
+    TCPPipelineChannel() {}
+    TCPPipelineChannel(const TCPPipelineChannel&) = delete;
+    TCPPipelineChannel(TCPPipelineChannel&&)      = delete;
+
+    /**
+     * @brief 回包回调类型，连接断开时未完成的请求以nullopt回调，回调在事件循环线程上执行
+     *
+     */
+    using OnResponseCBType = std::function<void(std::optional<std::string_view>)>;
+
+public:
+    /**
+     * @brief 创建通道并等待连接建立，会阻塞等待连接结果，不能在事件循环线程上调用
+     *
+     * @param loop 驱动该通道的事件循环
+     * @param server_ip 服务器IP地址，或"unix:"前缀的Unix域套接字地址
+     * @param server_port 服务器端口
+     * @param socket_options 连接的套接字选项
+     * @return JResultWithSuccErrMsg<TCPPipelineChannelPtr> 创建结果
+     */
+    static JResultWithSuccErrMsg<TCPPipelineChannelPtr> createNew(
+        TCPClientLoop& loop, const Types::IPStrType& server_ip, const Types::PortType& server_port,
+        const SocketOptions& socket_options = {});
+
+    /**
+     * @brief 发起一个请求，可在任意线程调用
+     *
+     * @param data 请求数据首地址
+     * @param len 请求长度
+     * @param cb 回包回调
+     * @return JResultWithErrMsg 通道已关闭时返回失败，此时不会调用回调
+     */
+    JResultWithErrMsg call(const char* data, size_t len, OnResponseCBType cb);
+
+    /**
+     * @brief 发起一个请求，通过future获取回包
+     *
+     * @return std::future<std::optional<std::string>> 回包，连接断开时为nullopt
+     */
+    std::future<std::optional<std::string>> call(const char* data, size_t len);
+
+    /**
+     * @brief 关闭通道，未完成的请求以nullopt回调
+     *
+     */
+    void close();
+
+    bool isClosed() const noexcept { return nullptr == m_client || m_client->isClosed(); }
+
+    /**
+     * @brief 尚未收到回包的请求数量
+     *
+     */
+    size_t getPendingNum();
+
+private:
+    void handleRecvData(ByteBuffer& buff);
+    void handleClose();
+
+private:
+    using PendingMapType = std::unordered_map<PipelineFrame::CorrelationIDType, OnResponseCBType>;
+
+    AsyncTCPClientPtr                             m_client{nullptr};   ///< 底层连接
+    std::atomic<PipelineFrame::CorrelationIDType> m_next_id{1};        ///< 下一个关联ID
+    std::mutex                                    m_pending_mutex;     ///< 未完成请求锁
+    PendingMapType                                m_pending;           ///< 未完成的请求
+    bool                                          m_closed{false};     ///< 是否已关闭
+};
+
+}   // namespace JTCP::Client
@@ -0,0 +1,116 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 收发缓冲区
+ */
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+namespace JTCP {
+
+/**
+ * @brief 连续内存的收发缓冲区
+ *
+ * 数据位于[读位置, 写位置)之间，读取只移动读位置；写入空间不足时优先把未读数据搬到头部，仍不够才扩容，
+ * 稳定运行后不再分配内存。
+ */
+class ByteBuffer
+{
+public:
+    static constexpr size_t INIT_SIZE = 4096;
+
+    explicit ByteBuffer(size_t init_size = INIT_SIZE)
+        : m_buff(init_size)
+    {}
+
+public:
+    /**
+     * @brief 可读数据长度
+     *
+     */
+    size_t readableBytes() const noexcept { return m_write_index - m_read_index; }
+    /**
+     * @brief 不扩容时可写入的长度
+     *
+     */
+    size_t writableBytes() const noexcept { return m_buff.size() - m_write_index; }
+    bool   empty() const noexcept { return readableBytes() == 0; }
+
+    /**
+     * @brief 可读数据首地址
+     *
+     */
+    const char*      peek() const noexcept { return m_buff.data() + m_read_index; }
+    std::string_view view() const noexcept { return std::string_view(peek(), readableBytes()); }
+
+    /**
+     * @brief 在可读数据中查找分隔符
+     *
+     * @param delim 分隔符
+     * @param offset 从可读数据的第offset个字节开始查找
+     * @return size_t 分隔符相对可读数据首地址的偏移，未找到时返回std::string_view::npos
+     */
+    size_t find(std::string_view delim, size_t offset = 0) const noexcept
+    {
+        return view().find(delim, offset);
+    }
+
+    /**
+     * @brief 丢弃len字节的可读数据
+     *
+     */
+    void retrieve(size_t len) noexcept
+    {
+        if (len >= readableBytes()) {
+            retrieveAll();
+            return;
+        }
+        m_read_index += len;
+    }
+    void retrieveAll() noexcept
+    {
+        m_read_index  = 0;
+        m_write_index = 0;
+    }
+
+    /**
+     * @brief 写入数据
+     *
+     */
+    void append(const char* data, size_t len);
+
+    /**
+     * @brief 保证至少有len字节的可写空间
+     *
+     */
+    void ensureWritable(size_t len);
+
+    /**
+     * @brief 可写空间首地址，直接写入后需调用hasWritten
+     *
+     */
+    char* beginWrite() noexcept { return m_buff.data() + m_write_index; }
+    void  hasWritten(size_t len) noexcept { m_write_index += len; }
+
+    /**
+     * @brief 从文件描述符读取数据
+     *
+     * 使用readv同时读入缓冲区剩余空间和栈上的64KB临时空间，一次系统调用即可读走大量数据，
+     * 又不必为每个连接预留大缓冲区。
+     *
+     * @param fd 文件描述符
+     * @return ssize_t 同read的返回值，失败时errno保持不变
+     */
+    ssize_t readFD(int fd);
+
+private:
+    std::vector<char> m_buff;             ///< 缓冲区
+    size_t            m_read_index{0};    ///< 读位置
+    size_t            m_write_index{0};   ///< 写位置
+};
+
+}   // namespace JTCP
@@ -0,0 +1,45 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief CPU与NUMA拓扑
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace JTCP {
+
+/**
+ * @brief CPU与NUMA拓扑查询，读取/sys/devices/system下的信息，不依赖libnuma
+ *
+ */
+class CPUTopology
+{
+public:
+    /**
+     * @brief 系统配置的CPU数量
+     *
+     */
+    static int getCPUNum() noexcept;
+
+    /**
+     * @brief CPU所在的NUMA节点，无法获取时为0
+     *
+     */
+    static int getNumaNode(int cpu) noexcept;
+
+    /**
+     * @brief NUMA节点上的CPU列表，节点不存在时为空
+     *
+     */
+    static std::vector<int> getNodeCPUs(int node);
+
+    /**
+     * @brief 解析"0-3,8,10-11"形式的CPU列表
+     *
+     */
+    static std::vector<int> parseCPUList(const std::string& cpu_list);
+};
+
+}   // namespace JTCP
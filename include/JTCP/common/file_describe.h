@@ -23,7 +23,13 @@ public:
     FileDescribe(const FDType& fd)
         : m_fd(fd)
     {}
-    ~FileDescribe() { close(m_fd); }
+    ~FileDescribe()
+    {
+        // 无效的fd不关闭，避免误关同号的其他文件
+        if (isValid()) {
+            close(m_fd);
+        }
+    }
 
     // 删除默认构造函数，防止外部创建FileDescribe的实例
     FileDescribe()                    = delete;
@@ -36,7 +42,7 @@ public:
     bool   isInvalid() const { return false == isValid(); }
 
 private:
-    FDType m_fd{0};
+    FDType m_fd{-1};
 };
 using FileDescribePtr = std::shared_ptr<FileDescribe>;
 };   // namespace JTCP
@@ -0,0 +1,193 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 日志接口与异步日志后端
+ *
+ * 库内部统一使用JTCP_LOG_*宏输出日志，低于JTCP_LOG_LEVEL的日志在编译期被移除。
+ * 日志后端可以通过Log::setBackend替换，默认使用AsyncLogBackend输出到stderr：
+ * 调用线程只负责格式化并写入本线程的SPSC队列，真正的IO由后台线程完成，不会阻塞reactor。
+ */
+#pragma once
+
+#include "JTCP/common/spsc_ring.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 编译期日志级别，0:DEBUG 1:INFO 2:WARN 3:ERROR 4:OFF
+ *
+ */
+#ifndef JTCP_LOG_LEVEL
+#    define JTCP_LOG_LEVEL 1
+#endif
+
+/**
+ * @brief 日志命名空间
+ *
+ */
+namespace JTCP::Log {
+
+/**
+ * @brief 日志级别
+ *
+ */
+enum class LogLevel : uint8_t
+{
+    DEBUG = 0,
+    INFO  = 1,
+    WARN  = 2,
+    ERROR = 3,
+    OFF   = 4,
+};
+
+/**
+ * @brief 获取日志级别名称
+ *
+ */
+const char* getLevelName(LogLevel level) noexcept;
+
+/**
+ * @brief 日志后端接口
+ *
+ */
+class LogBackend
+{
+public:
+    virtual ~LogBackend() = default;
+
+    /**
+     * @brief 写入一条已格式化的日志，可能被任意线程并发调用
+     *
+     * @param level 日志级别
+     * @param msg 日志内容，不含换行
+     */
+    virtual void write(LogLevel level, std::string_view msg) noexcept = 0;
+
+    /**
+     * @brief 等待已写入的日志全部输出
+     *
+     */
+    virtual void flush() {}
+};
+
+/**
+ * @brief 异步日志后端
+ *
+ * 每个写日志的线程拥有独立的SPSC队列，后台线程轮询所有队列并交给sink输出。
+ * 队列满时直接丢弃并计数，保证写日志的线程永远不会被阻塞。
+ */
+class AsyncLogBackend : public LogBackend
+{
+public:
+    /**
+     * @brief 日志输出函数类型，只会在后台线程上被调用
+     *
+     */
+    using SinkType = std::function<void(LogLevel, uint64_t timestamp_ns, std::string_view)>;
+
+    /**
+     * @brief 输出到stderr的默认sink
+     *
+     */
+    static void stderrSink(LogLevel level, uint64_t timestamp_ns, std::string_view msg);
+
+    static constexpr size_t MAX_MSG_LEN   = 240;    ///< 单条日志最大长度，超出部分截断
+    static constexpr size_t RING_CAPACITY = 1024;   ///< 每个线程的队列容量
+
+    explicit AsyncLogBackend(SinkType sink = stderrSink);
+    ~AsyncLogBackend() override;
+
+    AsyncLogBackend(const AsyncLogBackend&) = delete;
+    AsyncLogBackend(AsyncLogBackend&&)      = delete;
+
+public:
+    void write(LogLevel level, std::string_view msg) noexcept override;
+    void flush() override;
+
+    /**
+     * @brief 获取因队列满而丢弃的日志数量
+     *
+     */
+    uint64_t getDroppedCount() const noexcept
+    {
+        return m_dropped_count.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct LogEntry
+    {
+        uint64_t timestamp_ns;
+        LogLevel level;
+        uint8_t  len;
+        char     msg[MAX_MSG_LEN];
+    };
+    using RingType    = SPSCRing<LogEntry, RING_CAPACITY>;
+    using RingPtrType = std::shared_ptr<RingType>;
+
+    RingType* getLocalRing() noexcept;
+    void      consumeThreadFunc();
+    bool      drainOnce();
+
+private:
+    SinkType                 m_sink;               ///< 日志输出
+    uint64_t                 m_id{0};              ///< 后端唯一编号，区分线程局部缓存
+    std::mutex               m_rings_mutex;        ///< 队列登记锁，只在线程首次写日志时使用
+    std::vector<RingPtrType> m_rings;              ///< 所有线程的队列
+    std::atomic<uint64_t>    m_dropped_count{0};   ///< 丢弃的日志数量
+    std::atomic<uint64_t>    m_drained_round{0};   ///< 后台线程完成的轮询次数
+    std::mutex               m_wait_mutex;         ///< 后台线程休眠用的锁
+    std::condition_variable  m_wait_cv;            ///< 后台线程休眠用的条件变量
+    std::atomic<bool>        m_run_flag{true};     ///< 运行标志
+    std::thread              m_consume_thread;     ///< 后台线程
+};
+
+/**
+ * @brief 设置日志后端，传入nullptr可关闭日志
+ *
+ */
+void setBackend(std::shared_ptr<LogBackend> backend);
+
+/**
+ * @brief 获取当前日志后端，未设置时返回默认的AsyncLogBackend
+ *
+ */
+std::shared_ptr<LogBackend> getBackend();
+
+/**
+ * @brief 格式化并写入一条日志，通常通过JTCP_LOG_*宏调用
+ *
+ */
+void log(LogLevel level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+}   // namespace JTCP::Log
+
+#if JTCP_LOG_LEVEL <= 0
+#    define JTCP_LOG_DEBUG(...) ::JTCP::Log::log(::JTCP::Log::LogLevel::DEBUG, __VA_ARGS__)
+#else
+#    define JTCP_LOG_DEBUG(...) ((void)0)
+#endif
+
+#if JTCP_LOG_LEVEL <= 1
+#    define JTCP_LOG_INFO(...) ::JTCP::Log::log(::JTCP::Log::LogLevel::INFO, __VA_ARGS__)
+#else
+#    define JTCP_LOG_INFO(...) ((void)0)
+#endif
+
+#if JTCP_LOG_LEVEL <= 2
+#    define JTCP_LOG_WARN(...) ::JTCP::Log::log(::JTCP::Log::LogLevel::WARN, __VA_ARGS__)
+#else
+#    define JTCP_LOG_WARN(...) ((void)0)
+#endif
+
+#if JTCP_LOG_LEVEL <= 3
+#    define JTCP_LOG_ERROR(...) ::JTCP::Log::log(::JTCP::Log::LogLevel::ERROR, __VA_ARGS__)
+#else
+#    define JTCP_LOG_ERROR(...) ((void)0)
+#endif
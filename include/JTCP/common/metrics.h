@@ -0,0 +1,203 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 运行指标：无锁计数器与HDR风格延迟直方图
+ *
+ * 热路径上只做一次relaxed原子加，所有汇总、百分位计算都在读取快照时完成。
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief 指标命名空间
+ *
+ */
+namespace JTCP::Metrics {
+
+/**
+ * @brief 独占一个缓存行的计数器，避免不同线程写不同计数器时的伪共享
+ *
+ */
+struct alignas(64) PaddedCounter
+{
+    std::atomic<uint64_t> value{0};
+
+    void     add(uint64_t n = 1) noexcept { value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t load() const noexcept { return value.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @brief 直方图快照，由LatencyHistogram::snapshot生成，可合并
+ *
+ */
+struct HistogramSnapshot
+{
+    uint64_t              count{0};   ///< 样本数量
+    uint64_t              sum{0};     ///< 样本总和
+    std::vector<uint64_t> buckets;    ///< 各桶计数
+
+    /**
+     * @brief 获取百分位值
+     *
+     * @param percentile 百分位，取值[0, 100]
+     * @return uint64_t 该百分位所在桶的上界，精度约为6.25%
+     */
+    uint64_t percentile(double percentile) const noexcept;
+    uint64_t max() const noexcept { return percentile(100.0); }
+    double   mean() const noexcept { return count == 0 ? 0.0 : static_cast<double>(sum) / count; }
+
+    void merge(const HistogramSnapshot& other);
+};
+
+/**
+ * @brief HDR风格的对数-线性直方图
+ *
+ * 每个2的幂区间再线性划分为16个子桶，覆盖完整的uint64_t取值范围，相对误差不超过6.25%。
+ * record只对一个桶做relaxed原子加，允许多线程同时写入。
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr uint32_t SUB_BUCKET_BITS  = 4;
+    static constexpr uint32_t SUB_BUCKET_COUNT = 1u << SUB_BUCKET_BITS;
+    static constexpr uint32_t BUCKET_COUNT     = SUB_BUCKET_COUNT * (64 - SUB_BUCKET_BITS + 1);
+
+    /**
+     * @brief 计算样本值所在的桶
+     *
+     * @param value 样本值
+     * @return uint32_t 桶下标
+     */
+    static constexpr uint32_t bucketIndex(uint64_t value) noexcept
+    {
+        if (value < SUB_BUCKET_COUNT) {
+            return static_cast<uint32_t>(value);
+        }
+        uint32_t msb   = 63 - static_cast<uint32_t>(__builtin_clzll(value));
+        uint32_t group = msb - SUB_BUCKET_BITS + 1;
+        uint32_t sub   = static_cast<uint32_t>(value >> (msb - SUB_BUCKET_BITS)) - SUB_BUCKET_COUNT;
+        return group * SUB_BUCKET_COUNT + sub;
+    }
+
+    /**
+     * @brief 获取桶所能表示的最大值
+     *
+     * @param index 桶下标
+     * @return uint64_t 桶上界（包含）
+     */
+    static uint64_t bucketUpperBound(uint32_t index) noexcept;
+
+public:
+    void record(uint64_t value) noexcept
+    {
+        m_buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    HistogramSnapshot snapshot() const;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> m_buckets{};   ///< 各桶计数
+    std::atomic<uint64_t>                           m_sum{0};      ///< 样本总和
+};
+
+/**
+ * @brief 单个reactor的指标快照
+ *
+ */
+struct ReactorMetricsSnapshot
+{
+    uint64_t accepts{0};             ///< 成功accept的连接数
+    uint64_t accept_failures{0};     ///< accept失败次数
+    uint64_t accept_rejects{0};      ///< 被准入控制拒绝的连接数
+    uint64_t disconnects{0};         ///< 断开的连接数
+    uint64_t peer_closes{0};         ///< 因对端关闭而断开的连接数
+    uint64_t socket_errors{0};       ///< 因套接字错误而断开的连接数
+    uint64_t callback_failures{0};   ///< 回调抛出异常的次数，对应的连接被断开
+    uint64_t epoll_wakeups{0};       ///< epoll_wait返回次数（不含超时）
+    uint64_t epoll_timeouts{0};      ///< epoll_wait超时次数
+    uint64_t epoll_spins{0};         ///< 自旋模式下零超时epoll_wait没有事件的次数
+    uint64_t events{0};              ///< 处理的事件总数
+    uint64_t event_list_full{0};     ///< 一次唤醒取满事件数组的次数
+    uint64_t stale_events{0};        ///< 所指连接已断开或已被新连接取代而丢弃的事件数
+    uint64_t epoll_ctl_calls{0};     ///< epoll_ctl系统调用次数
+    uint64_t read_calls{0};          ///< read系统调用次数
+    uint64_t bytes_in{0};            ///< 读取的字节数
+    uint64_t read_eagains{0};        ///< read返回EAGAIN的次数
+    uint64_t read_budget_hits{0};    ///< 连接用完本轮读取配额的次数
+    uint64_t requeues{0};            ///< 因用完配额而被重新调度的连接回调次数
+    uint64_t throttles{0};           ///< 连接因超过限速而暂停读取的次数
+    uint64_t send_calls{0};          ///< send系统调用次数
+    uint64_t bytes_out{0};           ///< 发送的字节数
+    uint64_t send_eagains{0};        ///< send返回EAGAIN的次数
+    uint64_t send_partials{0};       ///< send只发送了部分数据的次数
+
+    HistogramSnapshot events_per_wakeup;      ///< 每次唤醒处理的事件数
+    HistogramSnapshot dispatch_delay_ns;      ///< 从epoll唤醒到回调开始的延迟
+    HistogramSnapshot callback_duration_ns;   ///< 数据回调的执行耗时
+
+    void merge(const ReactorMetricsSnapshot& other);
+};
+
+/**
+ * @brief 服务端指标快照，按reactor分别给出
+ *
+ */
+struct ServerMetricsSnapshot
+{
+    std::vector<ReactorMetricsSnapshot> reactors;
+
+    /**
+     * @brief 汇总所有reactor的指标
+     *
+     * @return ReactorMetricsSnapshot 汇总结果
+     */
+    ReactorMetricsSnapshot total() const;
+};
+
+/**
+ * @brief 单个reactor的指标
+ *
+ * 计数器各自独占缓存行，reactor线程与调用sendData的用户线程互不干扰。
+ */
+class ReactorMetrics
+{
+public:
+    PaddedCounter accepts;
+    PaddedCounter accept_failures;
+    PaddedCounter accept_rejects;
+    PaddedCounter disconnects;
+    PaddedCounter peer_closes;
+    PaddedCounter socket_errors;
+    PaddedCounter callback_failures;
+    PaddedCounter epoll_wakeups;
+    PaddedCounter epoll_timeouts;
+    PaddedCounter epoll_spins;
+    PaddedCounter events;
+    PaddedCounter event_list_full;
+    PaddedCounter stale_events;
+    PaddedCounter epoll_ctl_calls;
+    PaddedCounter read_calls;
+    PaddedCounter bytes_in;
+    PaddedCounter read_eagains;
+    PaddedCounter read_budget_hits;
+    PaddedCounter requeues;
+    PaddedCounter throttles;
+    PaddedCounter send_calls;
+    PaddedCounter bytes_out;
+    PaddedCounter send_eagains;
+    PaddedCounter send_partials;
+
+    LatencyHistogram events_per_wakeup;
+    LatencyHistogram dispatch_delay_ns;
+    LatencyHistogram callback_duration_ns;
+
+public:
+    ReactorMetricsSnapshot snapshot() const;
+};
+
+}   // namespace JTCP::Metrics
@@ -0,0 +1,56 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 主机名解析
+ */
+#pragma once
+
+#include "JResult/JResult.h"
+#include "JTCP/common/common_define.h"
+#include "JTCP/common/socket_address.h"
+#include <string>
+#include <vector>
+
+namespace JTCP {
+
+/**
+ * @brief 主机名解析器
+ *
+ * 依次尝试IP字面量（含"unix:"地址）、hosts文件和系统解析（getaddrinfo），
+ * 返回的地址按IPv6、IPv4交替排列，供happy eyeballs式的并行连接使用。
+ */
+class Resolver
+{
+public:
+    static constexpr const char* HOSTS_FILE = "/etc/hosts";   ///< 默认的hosts文件
+
+    /**
+     * @brief 解析主机名
+     *
+     * @param host 主机名或IP字面量
+     * @param port 端口
+     * @return JResultWithSuccErrMsg<std::vector<SocketAddress>> 解析出的地址，至少一个
+     */
+    static JResultWithSuccErrMsg<std::vector<SocketAddress>> resolve(const std::string&     host,
+                                                                     const Types::PortType& port);
+
+    /**
+     * @brief 仅在hosts文件中查找主机名
+     *
+     * @param host 主机名
+     * @param port 端口
+     * @param hosts_file hosts文件路径
+     * @return std::vector<SocketAddress> 查找到的地址，按文件中的顺序排列，未找到时为空
+     */
+    static std::vector<SocketAddress> lookupHostsFile(const std::string&     host,
+                                                      const Types::PortType& port,
+                                                      const char*            hosts_file = HOSTS_FILE);
+
+    /**
+     * @brief 按IPv6、IPv4交替重排地址，同一地址族内保持原有顺序
+     *
+     */
+    static std::vector<SocketAddress> interleave(const std::vector<SocketAddress>& addrs);
+};
+
+}   // namespace JTCP
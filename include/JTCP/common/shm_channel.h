@@ -0,0 +1,144 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 同机进程间的共享内存通道
+ */
+#pragma once
+
+#include "JResult/JResult.h"
+#include "JTCP/common/file_describe.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace JTCP {
+
+/**
+ * @brief 共享内存通道的选项
+ *
+ */
+struct ShmChannelOptions
+{
+    size_t   ring_capacity{1024 * 1024};   ///< 每个方向的环形缓冲区容量，向上取整为2的幂
+    uint32_t spin_count{4096};             ///< waitData先忙等的轮数，之后以futex睡眠
+};
+
+struct ShmControlBlock;
+struct ShmRingHeader;
+
+class ShmChannel;
+using ShmChannelPtr = std::shared_ptr<ShmChannel>;
+
+/**
+ * @brief 基于共享内存的消息通道
+ *
+ * 客户端创建memfd并在其中放置两个单生产者单消费者的环形缓冲区（每个方向一个），
+ * 通过一条Unix域套接字连接以SCM_RIGHTS把memfd交给服务端。之后的消息只经过共享内存，
+ * 不再进行系统调用；只有接收方在waitData中睡眠时，发送方才用一次futex唤醒它。
+ *
+ * 与TCPPeerClient不同，通道按消息收发：每次readData恰好取出一条sendData写入的消息。
+ * 每个方向只允许一个线程发送、一个线程接收。
+ */
+class ShmChannel
+{
+public:
+    ShmChannel() {}
+    ShmChannel(const ShmChannel&) = delete;
+    ShmChannel(ShmChannel&&)      = delete;
+    ~ShmChannel();
+
+public:
+    /**
+     * @brief 客户端：连接服务端并建立共享内存通道，阻塞直到服务端确认
+     *
+     * @param addr 服务端的Unix域套接字地址，如"unix:/tmp/app.sock"、"unix:@app"
+     * @param options 通道选项
+     * @return JResultWithSuccErrMsg<ShmChannelPtr> 建立结果
+     */
+    static JResultWithSuccErrMsg<ShmChannelPtr> connect(const std::string&       addr,
+                                                        const ShmChannelOptions& options = {});
+
+    /**
+     * @brief 服务端：在收到握手消息的连接上建立共享内存通道，通常在接收回调中调用
+     *
+     * @param fd 连接的文件描述符，如TCPPeerClient::getFileDescribe()，通道会持有它直到关闭
+     * @param options 通道选项，环形缓冲区容量由客户端决定，此处只使用spin_count
+     * @return JResultWithSuccErrMsg<ShmChannelPtr> 建立结果，握手消息尚未到达时返回失败
+     */
+    static JResultWithSuccErrMsg<ShmChannelPtr> accept(FileDescribePtr          fd,
+                                                       const ShmChannelOptions& options = {});
+
+    /**
+     * @brief 发送一条消息，不阻塞
+     *
+     * @param data 消息数据首地址
+     * @param len 消息长度，不能超过getMaxMessageLen()
+     * @return JResultWithSuccErrMsg<std::size_t> 发送的长度，缓冲区已满或通道已关闭时返回失败
+     */
+    JResultWithSuccErrMsg<std::size_t> sendData(const char* data, size_t len);
+
+    /**
+     * @brief 接收一条消息，不阻塞
+     *
+     * @param data 接收缓冲区
+     * @param expect_len 缓冲区长度，小于消息长度时返回失败且不取出消息
+     * @return JResultWithSuccErrMsg<std::size_t> 消息长度，没有消息或通道已关闭时返回失败
+     */
+    JResultWithSuccErrMsg<std::size_t> readData(char* data, const size_t& expect_len);
+
+    /**
+     * @brief 等待有消息可读
+     *
+     * 先忙等spin_count轮，仍没有消息时在futex上睡眠，由发送方唤醒；进程只能使用一个CPU时不忙等。
+     *
+     * @param timeout 最长等待时间
+     * @return true 有消息可读
+     * @return false 超时或通道已关闭，对端未关闭通道就退出时也视为关闭
+     */
+    bool waitData(std::chrono::nanoseconds timeout);
+
+    /**
+     * @brief 关闭通道，对端的waitData会被唤醒，已写入的消息仍可读出
+     *
+     */
+    void close() noexcept;
+
+    bool   isClosed() const noexcept;
+    size_t getMaxMessageLen() const noexcept;
+
+private:
+    /**
+     * @brief 映射共享内存并确定收发方向
+     *
+     */
+    JResultWithErrMsg attach(int memfd, size_t map_size, bool is_client);
+
+    bool hasData() noexcept;
+
+    /**
+     * @brief 检查握手连接，对端进程已退出时关闭通道
+     *
+     */
+    bool isPeerGone() noexcept;
+
+    void copyIn(uint64_t pos, const void* src, size_t len) noexcept;
+    void copyOut(uint64_t pos, void* dst, size_t len) noexcept;
+
+private:
+    FileDescribePtr  m_fd{nullptr};           ///< 握手用的连接
+    void*            m_map{nullptr};          ///< 共享内存首地址
+    size_t           m_map_size{0};           ///< 共享内存大小
+    ShmControlBlock* m_control{nullptr};      ///< 控制块
+    ShmRingHeader*   m_send_ring{nullptr};    ///< 发送方向的环形缓冲区
+    char*            m_send_data{nullptr};    ///< 发送方向的数据区
+    uint64_t         m_cached_read_pos{0};    ///< 发送方缓存的对端读位置
+    ShmRingHeader*   m_recv_ring{nullptr};    ///< 接收方向的环形缓冲区
+    char*            m_recv_data{nullptr};    ///< 接收方向的数据区
+    uint64_t         m_cached_write_pos{0};   ///< 接收方缓存的对端写位置
+    uint64_t         m_capacity{0};           ///< 每个方向的容量
+    uint32_t         m_spin_count{0};         ///< 忙等轮数
+};
+
+}   // namespace JTCP
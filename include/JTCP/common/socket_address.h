@@ -0,0 +1,158 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 与地址族无关的套接字地址
+ */
+#pragma once
+
+#include "JResult/JResult.h"
+#include "JTCP/common/common_define.h"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <sys/socket.h>
+
+namespace JTCP {
+
+/**
+ * @brief 地址的二进制键，用于哈希表查找、按IP限流等场景，比较和哈希都不涉及字符串
+ *
+ * IPv4地址按IPv4映射的IPv6地址保存，因此同一IPv4地址在单栈和双栈监听下得到相同的键。
+ */
+struct AddressKey
+{
+    uint8_t         ip[16]{0};   ///< IPv6地址或IPv4映射地址，网络字节序
+    Types::PortType port{0};     ///< 端口，只按IP区分时为0
+
+    bool operator==(const AddressKey& other) const noexcept
+    {
+        return port == other.port && memcmp(ip, other.ip, sizeof(ip)) == 0;
+    }
+    bool operator!=(const AddressKey& other) const noexcept { return !(*this == other); }
+};
+
+/**
+ * @brief AddressKey的哈希函数
+ *
+ */
+struct AddressKeyHash
+{
+    size_t operator()(const AddressKey& key) const noexcept
+    {
+        uint64_t high{0};
+        uint64_t low{0};
+        memcpy(&high, key.ip, sizeof(high));
+        memcpy(&low, key.ip + sizeof(high), sizeof(low));
+        uint64_t hash = (high * 0x9E3779B97F4A7C15ULL) ^ low ^ (uint64_t(key.port) << 48);
+        return static_cast<size_t>(hash ^ (hash >> 29));
+    }
+};
+
+/**
+ * @brief 与地址族无关的套接字地址，内部以sockaddr_storage保存
+ *
+ */
+class SocketAddress
+{
+public:
+    SocketAddress() {}
+    SocketAddress(const struct sockaddr* addr, socklen_t len);
+
+    /**
+     * @brief 由IP字面量和端口构造地址，支持IPv4与IPv6
+     *
+     * @param ip IP地址，如"127.0.0.1"、"::1"，IPv6地址可以带方括号
+     * @param port 端口
+     * @return JResultWithSuccErrMsg<SocketAddress> 解析结果，不是合法的IP字面量时返回失败
+     */
+    static JResultWithSuccErrMsg<SocketAddress> fromIP(const Types::IPStrType& ip,
+                                                       const Types::PortType&  port);
+
+    /**
+     * @brief 构造Unix域套接字地址
+     *
+     * @param path 套接字文件路径，以'@'开头时表示抽象命名空间中的名字
+     * @return JResultWithSuccErrMsg<SocketAddress> 构造结果，路径为空或过长时返回失败
+     */
+    static JResultWithSuccErrMsg<SocketAddress> fromUnix(const std::string& path);
+
+    /**
+     * @brief 解析地址，"unix:"前缀的地址按Unix域套接字解析并忽略端口，其余按IP字面量解析
+     *
+     * @param addr 如"127.0.0.1"、"::1"、"unix:/tmp/app.sock"、"unix:@app"
+     * @param port 端口
+     * @return JResultWithSuccErrMsg<SocketAddress> 解析结果
+     */
+    static JResultWithSuccErrMsg<SocketAddress> parse(const std::string&     addr,
+                                                      const Types::PortType& port);
+
+    static constexpr const char* UNIX_PREFIX = "unix:";   ///< Unix域套接字地址前缀
+
+public:
+    int                    getFamily() const noexcept { return m_addr.ss_family; }
+    bool                   isIPv6() const noexcept { return getFamily() == AF_INET6; }
+    bool                   isUnix() const noexcept { return getFamily() == AF_UNIX; }
+    const struct sockaddr* getSockAddr() const noexcept
+    {
+        return reinterpret_cast<const struct sockaddr*>(&m_addr);
+    }
+    struct sockaddr* getSockAddr() noexcept { return reinterpret_cast<struct sockaddr*>(&m_addr); }
+    socklen_t        getLength() const noexcept { return m_len; }
+
+    /**
+     * @brief 设置地址长度，用于accept、getsockname等直接写入getSockAddr()之后
+     *
+     */
+    void setLength(socklen_t len) noexcept { m_len = len; }
+
+    /**
+     * @brief 获取IP字符串，非IP地址返回空字符串
+     *
+     */
+    std::string getIP() const;
+
+    /**
+     * @brief 把IP字符串写入调用方提供的缓冲区，不分配内存
+     *
+     * @param buff 缓冲区，长度不小于INET6_ADDRSTRLEN时总能写下
+     * @param len 缓冲区长度
+     * @return const char* 即buff，非IP地址或缓冲区不足时为空字符串
+     */
+    const char* getIP(char* buff, socklen_t len) const noexcept;
+
+    Types::PortType getPort() const noexcept;
+    void            setPort(Types::PortType port) noexcept;
+
+    /**
+     * @brief 获取二进制键
+     *
+     * @param with_port 是否包含端口，按IP限流时传false
+     */
+    AddressKey getKey(bool with_port = true) const noexcept;
+
+    /**
+     * @brief 获取Unix域套接字路径，抽象命名空间的名字以'@'开头，其余地址返回空字符串
+     *
+     */
+    std::string getUnixPath() const;
+
+    /**
+     * @brief 格式化为"ip:port"，IPv6地址格式化为"[ip]:port"，Unix域套接字格式化为"unix:path"
+     *
+     */
+    std::string toString() const;
+
+    /**
+     * @brief 把IPv4映射的IPv6地址（::ffff:a.b.c.d）还原为IPv4地址，其余地址不变
+     *
+     * 双栈监听时IPv4连接以映射地址的形式accept，还原后日志、限流等与单栈监听时一致。
+     */
+    void unmapIPv4() noexcept;
+
+private:
+    struct sockaddr_storage m_addr{};                          ///< 地址
+    socklen_t               m_len{sizeof(sockaddr_storage)};   ///< 地址长度
+};
+
+}   // namespace JTCP
@@ -0,0 +1,73 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 套接字选项
+ */
+#pragma once
+
+#include "JResult/JResult.h"
+#include "JTCP/common/file_describe.h"
+#include <cstdint>
+
+namespace JTCP {
+
+/**
+ * @brief 连接套接字的选项，服务端在accept后、客户端在connect前设置
+ *
+ * 数值为0的项保持系统默认值。TCP层的选项对Unix域套接字不生效。
+ *
+ * 请求-响应式协议可开启defer_accept、fast_open_queue与fast_open_connect：
+ * 客户端的首个请求随SYN到达，监听套接字在数据到达后才通知accept，
+ * 服务端在accept的同一次唤醒中即可读取请求。
+ * 服务端TFO还需要系统net.ipv4.tcp_fastopen开启对应的位，未开启时退化为普通握手。
+ */
+struct SocketOptions
+{
+    bool    tcp_nodelay{false};         ///< TCP_NODELAY，关闭Nagle算法，小消息立即发出
+    bool    quick_ack{false};           ///< TCP_QUICKACK，关闭延迟确认；内核可能在之后自动恢复
+    int32_t recv_buffer_size{0};        ///< SO_RCVBUF，字节
+    int32_t send_buffer_size{0};        ///< SO_SNDBUF，字节
+    bool    keep_alive{false};          ///< SO_KEEPALIVE
+    int32_t keep_alive_idle{0};         ///< TCP_KEEPIDLE，连接空闲多少秒后开始探测
+    int32_t keep_alive_interval{0};     ///< TCP_KEEPINTVL，探测间隔，秒
+    int32_t keep_alive_count{0};        ///< TCP_KEEPCNT，探测失败多少次后断开
+    bool    reuse_addr{true};           ///< SO_REUSEADDR，只对监听套接字生效，避免重启时绑定失败
+    int32_t defer_accept{0};            ///< TCP_DEFER_ACCEPT，监听套接字等待首个数据的最长秒数
+    int32_t fast_open_queue{0};         ///< TCP_FASTOPEN，监听套接字上TFO请求的队列长度
+    bool    fast_open_connect{false};   ///< TCP_FASTOPEN_CONNECT，客户端的首次发送随SYN发出
+
+    /**
+     * @brief 低延迟预设：关闭Nagle算法和延迟确认，适合请求-响应式的小消息
+     *
+     */
+    static SocketOptions lowLatency() noexcept;
+
+    /**
+     * @brief 高吞吐预设：4MB收发缓冲区并保留Nagle算法，适合大块数据的持续传输
+     *
+     */
+    static SocketOptions bulkThroughput() noexcept;
+
+    /**
+     * @brief 设置监听套接字，需在bind之前调用
+     *
+     * 除SO_REUSEADDR外还设置收发缓冲区：accept得到的连接继承该值，
+     * 握手时通告的窗口扩大因子才能与之匹配。
+     *
+     * @param fd 监听套接字
+     * @param family 地址族
+     * @return JResultWithErrMsg 任一选项设置失败时返回失败
+     */
+    JResultWithErrMsg applyListen(FileDescribe::FDType fd, int family) const;
+
+    /**
+     * @brief 设置连接套接字，客户端应在connect之前调用
+     *
+     * @param fd 连接套接字
+     * @param family 地址族
+     * @return JResultWithErrMsg 任一选项设置失败时返回失败
+     */
+    JResultWithErrMsg apply(FileDescribe::FDType fd, int family) const;
+};
+
+}   // namespace JTCP
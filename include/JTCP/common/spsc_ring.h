@@ -0,0 +1,90 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 单生产者单消费者无锁环形队列
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace JTCP {
+
+/**
+ * @brief 单生产者单消费者无锁环形队列
+ *
+ * 生产者与消费者的位置各自独占缓存行，并各自缓存对方的位置，
+ * 只有在缓存值显示队列满/空时才去读取对方的原子变量，减少缓存行来回迁移。
+ *
+ * @tparam T 元素类型
+ * @tparam CAPACITY 容量，必须是2的幂
+ */
+template <typename T, size_t CAPACITY>
+class SPSCRing
+{
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+    static constexpr uint64_t MASK = CAPACITY - 1;
+
+public:
+    /**
+     * @brief 写入一个元素，只能由生产者线程调用
+     *
+     * @param value 元素
+     * @return true 写入成功
+     * @return false 队列已满
+     */
+    bool tryPush(const T& value) noexcept
+    {
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_cached_tail >= CAPACITY) {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+            if (head - m_cached_tail >= CAPACITY) {
+                return false;
+            }
+        }
+        m_items[head & MASK] = value;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 取出一个元素，只能由消费者线程调用
+     *
+     * @param value 取出的元素
+     * @return true 取出成功
+     * @return false 队列为空
+     */
+    bool tryPop(T& value) noexcept
+    {
+        uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_cached_head) {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+            if (tail == m_cached_head) {
+                return false;
+            }
+        }
+        value = m_items[tail & MASK];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 队列是否为空，任意线程可调用，结果仅供参考
+     *
+     */
+    bool empty() const noexcept
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(64) std::atomic<uint64_t>   m_head{0};          ///< 生产者写位置
+    uint64_t                            m_cached_tail{0};   ///< 生产者缓存的消费者位置
+    alignas(64) std::atomic<uint64_t>   m_tail{0};          ///< 消费者读位置
+    uint64_t                            m_cached_head{0};   ///< 消费者缓存的生产者位置
+    alignas(64) std::array<T, CAPACITY> m_items;            ///< 元素
+};
+
+}   // namespace JTCP
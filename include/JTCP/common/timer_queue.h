@@ -0,0 +1,74 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 定时器队列
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace JTCP {
+
+/**
+ * @brief 单线程定时器队列，由事件循环驱动
+ *
+ * 事件循环以getWaitTime的结果作为epoll_wait的超时，返回后调用runExpired执行到期的定时器。
+ * 所有接口只能在事件循环线程上调用。
+ */
+class TimerQueue
+{
+public:
+    using ClockType    = std::chrono::steady_clock;
+    using CallbackType = std::function<void()>;
+
+    /**
+     * @brief 添加定时器
+     *
+     * @param deadline 到期时间
+     * @param cb 到期时执行的回调，回调中可以继续添加定时器
+     */
+    void addTimer(const ClockType::time_point& deadline, CallbackType cb);
+
+    /**
+     * @brief 距离最近一个定时器到期的毫秒数，向上取整
+     *
+     * @param now 当前时间
+     * @param max_wait_ms 没有定时器或定时器更晚到期时返回的值
+     * @return int 等待的毫秒数
+     */
+    int getWaitTime(const ClockType::time_point& now, int max_wait_ms) const;
+
+    /**
+     * @brief 执行所有已到期的定时器
+     *
+     * @param now 当前时间
+     * @return size_t 执行的定时器数量
+     */
+    size_t runExpired(const ClockType::time_point& now);
+
+    bool   empty() const noexcept { return m_timers.empty(); }
+    size_t size() const noexcept { return m_timers.size(); }
+
+private:
+    struct Timer
+    {
+        ClockType::time_point deadline;   ///< 到期时间
+        uint64_t              seq;        ///< 添加顺序，同时到期的定时器按添加顺序执行
+        CallbackType          cb;         ///< 回调
+
+        bool operator>(const Timer& other) const noexcept
+        {
+            return deadline != other.deadline ? deadline > other.deadline : seq > other.seq;
+        }
+    };
+
+    using HeapType = std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>>;
+    HeapType m_timers;        ///< 按到期时间排列的最小堆
+    uint64_t m_next_seq{0};   ///< 下一个定时器的添加顺序
+};
+
+}   // namespace JTCP
@@ -0,0 +1,77 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 令牌桶
+ */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace JTCP {
+
+/**
+ * @brief 允许透支的令牌桶，非线程安全
+ *
+ * 事先无法确定消费量时可以先消费后结算，令牌变为负数；调用方据getRefillWait的结果暂停消费，
+ * 令牌恢复到容量的一半后再继续，避免每补充一点令牌就恢复一次。
+ */
+class TokenBucket
+{
+public:
+    using ClockType = std::chrono::steady_clock;
+
+    /**
+     * @brief 设置速率并装满令牌
+     *
+     * @param rate 每秒补充的令牌数，为0时不限速
+     * @param burst 令牌桶容量，为0时等于rate
+     * @param now 当前时间
+     */
+    void reset(uint64_t rate, uint64_t burst, const ClockType::time_point& now) noexcept
+    {
+        m_rate   = static_cast<double>(rate);
+        m_burst  = static_cast<double>(burst > 0 ? burst : rate);
+        m_tokens = m_burst;
+        m_last   = now;
+    }
+
+    bool isEnabled() const noexcept { return m_rate > 0; }
+
+    /**
+     * @brief 按经过的时间补充令牌
+     *
+     * @return uint64_t 当前可用的令牌数
+     */
+    uint64_t refill(const ClockType::time_point& now) noexcept
+    {
+        auto elapsed = std::chrono::duration<double>(now - m_last).count();
+        m_last       = now;
+        m_tokens     = std::min(m_burst, m_tokens + elapsed * m_rate);
+        return m_tokens > 0 ? static_cast<uint64_t>(m_tokens) : 0;
+    }
+
+    void consume(uint64_t n) noexcept { m_tokens -= static_cast<double>(n); }
+
+    /**
+     * @brief 令牌不足一个时，恢复到容量一半所需的时长；否则为0
+     *
+     */
+    std::chrono::nanoseconds getRefillWait() const noexcept
+    {
+        if (false == isEnabled() || m_tokens >= 1) {
+            return std::chrono::nanoseconds(0);
+        }
+        auto target = std::max(1.0, m_burst / 2);
+        return std::chrono::nanoseconds(static_cast<int64_t>((target - m_tokens) / m_rate * 1e9));
+    }
+
+private:
+    double                m_rate{0};     ///< 每秒补充的令牌数
+    double                m_burst{0};    ///< 令牌桶容量
+    double                m_tokens{0};   ///< 当前令牌数，可以为负
+    ClockType::time_point m_last;        ///< 上次补充的时间
+};
+
+}   // namespace JTCP
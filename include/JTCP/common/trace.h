@@ -0,0 +1,140 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 热路径事件追踪
+ *
+ * 只有在定义了JTCP_ENABLE_TRACE（CMake选项JTCP_ENABLE_TRACE=ON）时，JTCP_TRACE才会记录事件，
+ * 否则展开为空语句，不产生任何开销。
+ *
+ * 开启后每个线程拥有一个无锁环形缓冲区，写满后覆盖最旧的记录，相当于一个飞行记录仪。
+ * 调用Trace::dump可以把所有线程的记录以二进制格式写入文件，供离线分析。
+ *
+ * 文件格式（小端，与本机字节序一致）：
+ *   FileHeader
+ *   { ThreadHeader, TraceRecord * record_count } * thread_count
+ */
+#pragma once
+
+#include "JResult/JResult.h"
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief 追踪命名空间
+ *
+ */
+namespace JTCP::Trace {
+
+/**
+ * @brief 事件类型
+ *
+ */
+enum class EventType : uint16_t
+{
+    ACCEPT        = 1,   ///< accept完成，value为0成功，否则为errno
+    EPOLL_WAKEUP  = 2,   ///< epoll_wait返回，value为就绪事件数
+    READ          = 3,   ///< read调用，value为读取字节数或负的errno，aux为期望长度
+    CALLBACK      = 4,   ///< 数据回调，value为回调耗时(ns)，aux为从唤醒到回调开始的延迟(ns)
+    SEND          = 5,   ///< send调用，value为发送字节数或负的errno，aux为期望长度
+    SEND_PARTIAL  = 6,   ///< send只发送了部分数据，value为已发送字节数，aux为期望长度
+    ACCEPT_REJECT = 7,   ///< 准入控制拒绝连接，value为AdmitResult
+    DISCONNECT    = 8,   ///< 连接断开，value为0表示对端关闭，否则为errno
+};
+
+/**
+ * @brief 定长二进制追踪记录
+ *
+ */
+struct TraceRecord
+{
+    uint64_t timestamp_ns;   ///< CLOCK_MONOTONIC时间戳
+    int64_t  value;          ///< 事件值，含义见EventType
+    uint64_t aux;            ///< 附加值，含义见EventType
+    int32_t  fd;             ///< 相关的文件描述符，没有则为-1
+    uint16_t type;           ///< EventType
+    uint16_t reserved;
+};
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord must stay 32 bytes");
+
+/**
+ * @brief dump文件头
+ *
+ */
+struct FileHeader
+{
+    char     magic[8];       ///< "JTCPTRC"
+    uint32_t version;        ///< 格式版本，当前为1
+    uint32_t record_size;    ///< sizeof(TraceRecord)
+    uint32_t thread_count;   ///< 线程数量
+    uint32_t reserved;
+};
+
+/**
+ * @brief 每个线程记录段的头
+ *
+ */
+struct ThreadHeader
+{
+    uint64_t thread_id;      ///< 线程id(gettid)
+    uint64_t record_count;   ///< 该线程的记录数量
+};
+
+/**
+ * @brief 每个线程环形缓冲区能保存的记录数量，必须是2的幂
+ *
+ */
+#ifndef JTCP_TRACE_RING_CAPACITY
+#    define JTCP_TRACE_RING_CAPACITY 16384
+#endif
+static_assert((JTCP_TRACE_RING_CAPACITY & (JTCP_TRACE_RING_CAPACITY - 1)) == 0,
+              "JTCP_TRACE_RING_CAPACITY must be a power of two");
+
+/**
+ * @brief 保留的已退出线程的环形缓冲区数量，超过时新线程接手最早退出的线程的缓冲区
+ *
+ */
+#ifndef JTCP_TRACE_RETIRED_RINGS
+#    define JTCP_TRACE_RETIRED_RINGS 16
+#endif
+
+/**
+ * @brief 是否编译了追踪功能
+ *
+ */
+constexpr bool isEnabled()
+{
+#ifdef JTCP_ENABLE_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief 向当前线程的环形缓冲区写入一条记录
+ *
+ * 通常通过JTCP_TRACE宏调用，以便在未开启追踪时完全移除
+ */
+void record(EventType type, int32_t fd, int64_t value, uint64_t aux) noexcept;
+
+/**
+ * @brief 把所有线程的追踪记录写入文件
+ *
+ * 可以在运行中调用，正被覆盖的记录会被丢弃
+ *
+ * @param path 文件路径
+ * @return JResultWithErrMsg 写入结果，未开启追踪时返回失败
+ */
+JResultWithErrMsg dump(const std::string& path);
+
+}   // namespace JTCP::Trace
+
+#ifdef JTCP_ENABLE_TRACE
+#    define JTCP_TRACE(type, fd, value, aux)                                    \
+        ::JTCP::Trace::record(::JTCP::Trace::EventType::type,                  \
+                              static_cast<int32_t>(fd),                        \
+                              static_cast<int64_t>(value),                     \
+                              static_cast<uint64_t>(aux))
+#else
+#    define JTCP_TRACE(type, fd, value, aux) ((void)0)
+#endif
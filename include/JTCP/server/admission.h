@@ -0,0 +1,103 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 连接准入控制
+ */
+#pragma once
+
+#include "JTCP/common/socket_address.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace JTCP::Server {
+
+/**
+ * @brief 准入控制选项，各项为0时不限制
+ *
+ */
+struct AdmissionOptions
+{
+    size_t   max_connections{0};          ///< 整个服务的最大并发连接数
+    uint32_t max_connections_per_ip{0};   ///< 每个来源IP的最大并发连接数，Unix域套接字不受此限制
+    uint32_t accept_rate{0};              ///< 每秒最多接受的新连接数
+    uint32_t accept_burst{0};             ///< 允许突发接受的连接数，为0时等于accept_rate
+};
+
+/**
+ * @brief 准入结果
+ *
+ */
+enum class AdmitResult : uint8_t
+{
+    ADMITTED             = 0,   ///< 允许接入
+    RATE_LIMITED         = 1,   ///< 超过接受速率
+    TOO_MANY_CONNECTIONS = 2,   ///< 超过最大并发连接数
+    TOO_MANY_FROM_IP     = 3,   ///< 超过单个来源IP的并发连接数
+};
+
+/**
+ * @brief 连接准入控制，所有reactor共享，无锁
+ *
+ * 接受速率按GCRA（令牌桶的等价形式）限制，只需一个原子时间戳。每个来源IP的连接数记录在两行
+ * 定长计数表中（count-min sketch），取两行中较小的计数，哈希冲突只会高估，不会放过超限的IP。
+ */
+class AdmissionControl
+{
+public:
+    static constexpr size_t IP_TABLE_SIZE = 4096;   ///< 每行计数表的槽位数，2的幂
+
+    AdmissionControl();
+    AdmissionControl(const AdmissionControl&) = delete;
+
+    /**
+     * @brief 设置选项并清空计数，需在reactor启动前调用
+     *
+     */
+    void reset(const AdmissionOptions& options) noexcept;
+
+    /**
+     * @brief 是否设置了任一限制，未设置时accept路径不调用admit和release
+     *
+     */
+    bool isEnabled() const noexcept { return m_enabled; }
+
+    /**
+     * @brief 为新连接申请名额
+     *
+     * @param addr 对端地址
+     * @return AdmitResult 不为ADMITTED时未占用任何名额
+     */
+    AdmitResult admit(const SocketAddress& addr) noexcept;
+
+    /**
+     * @brief 连接断开，释放admit占用的名额
+     *
+     * @param addr 对端地址，需与admit时相同
+     */
+    void release(const SocketAddress& addr) noexcept;
+
+    size_t getConnectionNum() const noexcept { return m_connection_num.load(); }
+
+private:
+    bool acquireRate() noexcept;
+
+    /**
+     * @brief 来源IP在两行计数表中的槽位
+     *
+     */
+    void getIPSlots(const SocketAddress& addr, size_t& slot0, size_t& slot1) const noexcept;
+
+private:
+    AdmissionOptions     m_options;                 ///< 准入控制选项
+    bool                 m_enabled{false};          ///< 是否设置了任一限制
+    std::atomic<size_t>  m_connection_num{0};       ///< 当前连接数
+    std::atomic<int64_t> m_next_accept_ns{0};       ///< GCRA的理论到达时间
+    int64_t              m_accept_interval_ns{0};   ///< 相邻两个连接的最小间隔
+    int64_t              m_burst_ns{0};             ///< 允许提前的时长
+
+    std::unique_ptr<std::atomic<uint32_t>[]> m_ip_counts;   ///< 两行来源IP计数表
+};
+
+}   // namespace JTCP::Server
@@ -0,0 +1,297 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 基于C++20协程的连接处理
+ *
+ * 只有在定义了JTCP_ENABLE_COROUTINE（CMake选项JTCP_ENABLE_COROUTINE=ON，同时以C++20编译）时可用。
+ */
+#pragma once
+
+#ifdef JTCP_ENABLE_COROUTINE
+
+#include "JResult/JResult.h"
+#include "JTCP/common/byte_buffer.h"
+#include "JTCP/server/peer_client.h"
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace JTCP::Server {
+
+/**
+ * @brief 协程帧内存池
+ *
+ * 协程帧按64字节分级，释放后留在当前线程的空闲链表中。每个reactor是一个线程，
+ * 连接的协程在reactor线程上创建，因此相当于每个reactor一个池，分配和释放都不加锁。
+ */
+class CoroutineFramePool
+{
+public:
+    static constexpr size_t CLASS_SIZE     = 64;     ///< 分级粒度
+    static constexpr size_t CLASS_NUM      = 64;     ///< 分级数，更大的帧直接使用operator new
+    static constexpr size_t MAX_FREE_BLOCK = 1024;   ///< 每级最多缓存的空闲块数
+
+    static void* allocate(size_t size);
+    static void  deallocate(void* ptr, size_t size) noexcept;
+};
+
+/**
+ * @brief 连接处理协程的返回类型
+ *
+ * 协程创建后立即运行，直到第一次需要等待数据；结束后帧保留到连接对象释放时销毁。
+ */
+class CoTask
+{
+public:
+    struct promise_type
+    {
+        CoTask get_return_object() noexcept
+        {
+            return CoTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_never  initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void                return_void() noexcept {}
+        void unhandled_exception() noexcept { m_exception = std::current_exception(); }
+
+        static void* operator new(size_t size) { return CoroutineFramePool::allocate(size); }
+        static void  operator delete(void* ptr, size_t size) noexcept
+        {
+            CoroutineFramePool::deallocate(ptr, size);
+        }
+
+        std::exception_ptr m_exception;   ///< 协程中未捕获的异常
+    };
+
+    CoTask() = default;
+    CoTask(const CoTask&) = delete;
+    CoTask(CoTask&& other) noexcept
+        : m_handle(other.m_handle)
+    {
+        other.m_handle = nullptr;
+    }
+    CoTask& operator=(CoTask&& other) noexcept;
+    ~CoTask();
+
+    bool               done() const noexcept { return nullptr == m_handle || m_handle.done(); }
+    std::exception_ptr getException() const noexcept;
+
+private:
+    explicit CoTask(std::coroutine_handle<promise_type> handle)
+        : m_handle(handle)
+    {}
+
+    std::coroutine_handle<promise_type> m_handle{nullptr};   ///< 协程句柄
+};
+
+class CoConnection;
+using CoConnectionPtr = std::shared_ptr<CoConnection>;
+
+/**
+ * @brief 以协程处理一个连接
+ *
+ * 协程中co_await readExact、readFrame、write挂起，由reactor在数据到达、发送缓冲区可写
+ * 或连接断开时恢复，全程在reactor线程上执行，不占用额外线程。
+ * 处理协程结束或抛出异常时，本端断开连接。
+ *
+ * @code
+ * server.setOnNewClient([](Server::TCPPeerClientPtr client) {
+ *     Server::CoConnection::spawn(client, [](Server::CoConnection& conn) -> Server::CoTask {
+ *         std::string request;
+ *         while ((co_await conn.readFrame(request)).isSuccess()) {
+ *             co_await conn.writeFrame(request.data(), request.size());
+ *         }
+ *     });
+ * });
+ * @endcode
+ */
+class CoConnection
+{
+public:
+    using HandlerType = std::function<CoTask(CoConnection&)>;
+
+    /// 帧格式：4字节网络字节序的负载长度加负载
+    static constexpr size_t FRAME_HEADER_LEN  = 4;
+    static constexpr size_t MAX_FRAME_PAYLOAD = 64 * 1024 * 1024;   ///< 默认的负载最大长度
+    static constexpr size_t RECV_HIGH_WATER   = 64 * 1024;          ///< 未等待数据时的预读上限
+
+    /**
+     * @brief 接管连接的数据、可写和断开回调，并启动处理协程
+     *
+     * 需在reactor线程（新连接回调）中调用。处理函数保存在连接上，
+     * 作为协程的lambda，其捕获在协程的整个生命周期内有效。
+     *
+     * @param peer_client 连接
+     * @param handler 返回CoTask的协程函数
+     */
+    static void spawn(const TCPPeerClientPtr& peer_client, HandlerType handler);
+
+    explicit CoConnection(TCPPeerClient* peer_client)
+        : m_peer_client(peer_client)
+    {}
+    CoConnection(const CoConnection&) = delete;
+
+    TCPPeerClient* getPeerClient() const noexcept { return m_peer_client; }
+    bool           isClosed() const noexcept { return m_closed; }
+
+    class ReadExactAwaiter;
+    class ReadFrameAwaiter;
+    class WriteAwaiter;
+
+    /**
+     * @brief 读取恰好len字节，co_await的结果为JResultWithErrMsg，连接断开前数据不足时返回失败
+     *
+     */
+    ReadExactAwaiter readExact(char* data, size_t len) noexcept;
+
+    /**
+     * @brief 读取一个长度前缀帧的负载
+     *
+     * @param payload 负载
+     * @param max_len 负载最大长度，超过时返回失败
+     */
+    ReadFrameAwaiter readFrame(std::string& payload, size_t max_len = MAX_FRAME_PAYLOAD) noexcept;
+
+    /**
+     * @brief 发送数据，内核发送缓冲区满时挂起，全部发出后恢复，数据在co_await时已被复制
+     *
+     */
+    WriteAwaiter write(const char* data, size_t len);
+
+    /**
+     * @brief 以长度前缀帧发送负载
+     *
+     */
+    WriteAwaiter writeFrame(const char* data, size_t len);
+
+private:
+    /**
+     * @brief 数据回调：读取内核中的数据，满足等待条件时恢复协程
+     *
+     * 已读取的数据超过RECV_HIGH_WATER且协程不需要更多数据时暂停读取，剩余数据留在内核中，
+     * 由TCP流控约束对端；协程取走数据后经reactor的重新调度队列恢复读取。
+     */
+    void onReadable();
+
+    /**
+     * @brief 可写回调：继续发送缓冲的数据，发完后恢复协程
+     *
+     */
+    void onWritable();
+
+    /**
+     * @brief 断开回调：恢复等待中的协程，使其得到失败结果
+     *
+     */
+    void onDisconnect();
+
+    /**
+     * @brief 尽量发送缓冲的数据，返回false表示发送出错
+     *
+     */
+    bool flush();
+
+private:
+    enum class WaitType : uint8_t
+    {
+        NONE  = 0,   ///< 没有等待
+        READ  = 1,   ///< 等待readExact的数据
+        FRAME = 2,   ///< 等待一个完整的帧
+        WRITE = 3,   ///< 等待发送缓冲区发完
+    };
+
+    /**
+     * @brief 已读取的数据是否满足读取等待条件
+     *
+     * @param wait_type READ或FRAME
+     * @param wait_len 等待的字节数或帧的最大负载长度
+     */
+    bool readReady(WaitType wait_type, size_t wait_len) const noexcept;
+
+    /**
+     * @brief 是否应暂停读取：已读取的数据超过高水位，且协程不在等待更多数据
+     *
+     */
+    bool shouldPauseRead() const noexcept;
+
+    /**
+     * @brief 满足等待条件或连接已断开时恢复协程，协程结束后断开连接
+     *
+     */
+    void resume();
+
+private:
+    TCPPeerClient*          m_peer_client{nullptr};        ///< 连接，连接对象持有本对象
+    HandlerType             m_handler;                     ///< 处理函数
+    CoTask                  m_task;                        ///< 处理协程
+    std::coroutine_handle<> m_waiting{nullptr};            ///< 挂起等待的协程
+    WaitType                m_wait_type{WaitType::NONE};   ///< 等待的条件
+    size_t                  m_wait_len{0};                 ///< 等待的字节数或帧的最大负载长度
+    ByteBuffer              m_recv_buff;                   ///< 已读取未消费的数据
+    ByteBuffer              m_send_buff;                   ///< 未发出的数据
+    bool                    m_closed{false};               ///< 连接是否已断开
+    bool                    m_write_failed{false};         ///< 发送是否出错
+    bool                    m_in_callback{false};          ///< 是否在数据或可写回调中
+    bool                    m_read_paused{false};          ///< 是否因高水位暂停了读取
+};
+
+class CoConnection::ReadExactAwaiter
+{
+public:
+    ReadExactAwaiter(CoConnection& conn, char* data, size_t len) noexcept
+        : m_conn(conn)
+        , m_data(data)
+        , m_len(len)
+    {}
+
+    bool              await_ready() const noexcept;
+    void              await_suspend(std::coroutine_handle<> handle) noexcept;
+    JResultWithErrMsg await_resume() noexcept;
+
+private:
+    CoConnection& m_conn;   ///< 连接
+    char*         m_data;   ///< 输出缓冲区
+    size_t        m_len;    ///< 读取长度
+};
+
+class CoConnection::ReadFrameAwaiter
+{
+public:
+    ReadFrameAwaiter(CoConnection& conn, std::string& payload, size_t max_len) noexcept
+        : m_conn(conn)
+        , m_payload(payload)
+        , m_max_len(max_len)
+    {}
+
+    bool              await_ready() const noexcept;
+    void              await_suspend(std::coroutine_handle<> handle) noexcept;
+    JResultWithErrMsg await_resume();
+
+private:
+    CoConnection& m_conn;      ///< 连接
+    std::string&  m_payload;   ///< 负载
+    size_t        m_max_len;   ///< 负载最大长度
+};
+
+class CoConnection::WriteAwaiter
+{
+public:
+    explicit WriteAwaiter(CoConnection& conn) noexcept
+        : m_conn(conn)
+    {}
+
+    bool              await_ready() noexcept;
+    void              await_suspend(std::coroutine_handle<> handle);
+    JResultWithErrMsg await_resume() noexcept;
+
+private:
+    CoConnection& m_conn;   ///< 连接
+};
+
+}   // namespace JTCP::Server
+
+#endif
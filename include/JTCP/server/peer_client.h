@@ -8,12 +8,29 @@
 #include "JResult/JResult.h"
 #include "JTCP/common/common_define.h"
 #include "JTCP/common/file_describe.h"
+#include "JTCP/common/socket_address.h"
+#include "JTCP/common/token_bucket.h"
 #include "JTCP/server/server.h"
+#include <atomic>
+#include <cstdint>
 #include <functional>
 
 namespace JTCP::Server {
 
-class TCPServer;
+class TCPReactor;
+
+/**
+ * @brief 单个连接的统计
+ *
+ */
+struct PeerClientStats
+{
+    uint64_t bytes_in{0};                ///< 读取的字节数
+    uint64_t messages{0};                ///< 回调通过countMessages上报的消息数
+    bool     throttled{false};           ///< 当前是否因超过限速而暂停读取
+    uint64_t throttle_count{0};          ///< 被限速的次数
+    uint64_t throttled_duration_ns{0};   ///< 累计暂停读取的时长，不含正在进行的一次
+};
 
 /**
  * @brief 对手方客户端管理器
@@ -22,19 +39,42 @@ class TCPServer;
 class TCPPeerClient
 {
 public:
-    TCPPeerClient(TCPServer* server)
-        : m_server(server)
+    TCPPeerClient(TCPReactor* reactor)
+        : m_reactor(reactor)
     {}
 
     using OnRecvDataCBType   = std::function<void(TCPPeerClient*)>;
     using OnDisconnectCBType = std::function<void(TCPPeerClient*)>;
+    using OnWritableCBType   = std::function<void(TCPPeerClient*)>;
 
 public:
-    struct sockaddr_in* getSockAddr();
+    /**
+     * @brief 设置对端地址，在accept时调用一次，同时格式化IP字符串并生成二进制键
+     *
+     */
+    void setPeerAddress(const SocketAddress& addr) noexcept;
+
+    /**
+     * @brief 对端地址，IPv4或IPv6，双栈监听下的IPv4连接已还原为IPv4地址
+     *
+     */
+    const SocketAddress& getPeerAddress() const noexcept { return m_sock_addr; }
 
+    /**
+     * @brief 对端IP，指向连接对象内部的缓冲区，在连接对象的生命周期内有效，可在任意线程调用
+     *
+     */
+    Types::IPStrVType getPeerIP() const noexcept
+    {
+        return Types::IPStrVType(m_peer_ip, m_peer_ip_len);
+    }
+    const Types::PortType getPeerPort() const noexcept { return m_peer_key.port; }
 
-    Types::IPStrVType     getPeerIP() const;
-    const Types::PortType getPeerPort() const;
+    /**
+     * @brief 对端地址的二进制键（含端口），用于哈希表查找
+     *
+     */
+    const AddressKey& getPeerKey() const noexcept { return m_peer_key; }
 
     void            setFileDescribe(FileDescribePtr fd) noexcept;
     FileDescribePtr getFileDescribe() const noexcept;
@@ -45,15 +85,91 @@ public:
     void setOnDisconnectCB(OnDisconnectCBType cb);
     void onDisconnect();
 
+    void setOnWritableCB(OnWritableCBType cb);
+    void onWritable();
+
+    /**
+     * @brief 开启或关闭可写通知，开启后发送缓冲区有空间时调用可写回调
+     *
+     * 只能在reactor线程（即连接的回调）中调用。用于sendData只发送了部分数据后，等待继续发送。
+     */
+    void watchWritable(bool enable);
+
+    /**
+     * @brief 请求reactor在下一轮再次调用数据回调
+     *
+     * 只能在reactor线程中调用。数据回调为限制内存而暂停读取后，边缘触发不会再次报告
+     * 内核中剩余的数据，恢复读取时调用本函数。
+     */
+    void requestRead();
+
+    /**
+     * @brief 本端主动断开连接，关闭两个方向，对端随后读到EOF
+     *
+     * 断开回调在本次调用中执行，fd在连接对象释放时关闭。
+     */
+    JResultWithErrMsg disconnect();
+
     JResultWithSuccErrMsg<std::size_t> sendData(const char* data, size_t len);
+
+    /**
+     * @brief 上报在数据回调中处理的消息数，用于ServerOptions::throttle的消息限速
+     *
+     * 服务端不解析消息边界，消息数由用户按自己的协议统计。
+     */
+    void countMessages(uint64_t num = 1) noexcept
+    {
+        m_messages.fetch_add(num, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 连接的统计，可在任意线程调用
+     *
+     */
+    PeerClientStats getStats() const noexcept;
+
+    /**
+     * @brief 读取数据，不阻塞
+     *
+     * 在数据回调中读取的总量受ServerOptions::read_budget限制，用完后返回失败，
+     * 剩余数据在下一轮重新调用数据回调时读取。
+     * 对端已关闭时，读到的数据少于请求长度即说明已读完，之后直接返回失败，连接由reactor断开。
+     */
     JResultWithSuccErrMsg<std::size_t> readData(char* data, const size_t& expect_len);
 
 private:
-    TCPServer*         m_server{nullptr};
-    FileDescribePtr    m_fd{nullptr};
-    struct sockaddr_in m_sock_addr;
-    OnRecvDataCBType   m_on_recv_data_cb{[](TCPPeerClient*) {}};
-    OnDisconnectCBType m_on_disconnect_cb{[](TCPPeerClient*) {}};
+    friend class TCPReactor;
+
+    TCPReactor*        m_reactor{nullptr};                          ///< 所属reactor
+    FileDescribePtr    m_fd{nullptr};                               ///< 文件描述符
+    SocketAddress      m_sock_addr;                                 ///< 对端地址
+    AddressKey         m_peer_key;                                  ///< 对端地址的二进制键
+    char               m_peer_ip[INET6_ADDRSTRLEN]{0};              ///< 格式化后的对端IP
+    uint8_t            m_peer_ip_len{0};                            ///< 对端IP长度
+    size_t             m_read_budget{SIZE_MAX};                     ///< 本轮剩余的读取配额
+    bool               m_budget_exhausted{false};                   ///< 本轮是否用完了读取配额
+    bool               m_requeued{false};                           ///< 是否在重新调度队列中
+    uint32_t           m_generation{0};                             ///< 连接代数，与fd组成连接句柄
+    bool               m_registered{false};                         ///< 是否已注册到epoll
+    bool               m_want_write{false};                         ///< 是否关注可写事件
+
+    using TimePointType = TokenBucket::ClockType::time_point;
+    TokenBucket   m_byte_bucket;           ///< 字节限速，只在reactor线程上访问
+    TokenBucket   m_message_bucket;        ///< 消息限速，只在reactor线程上访问
+    TimePointType m_throttle_begin;        ///< 本次暂停读取的开始时间
+    uint64_t      m_charged_bytes{0};      ///< 已计入限速的字节数
+    uint64_t      m_charged_messages{0};   ///< 已计入限速的消息数
+
+    std::atomic<uint64_t> m_bytes_in{0};           ///< 读取的字节数
+    std::atomic<uint64_t> m_messages{0};           ///< 上报的消息数
+    std::atomic<bool>     m_throttled{false};      ///< 是否暂停读取
+    std::atomic<uint64_t> m_throttle_count{0};     ///< 被限速的次数
+    std::atomic<uint64_t> m_throttled_ns{0};       ///< 累计暂停读取的时长
+    std::atomic<bool>     m_peer_closed{false};    ///< 对端已关闭写方向（EPOLLRDHUP）
+    std::atomic<bool>     m_peer_drained{false};   ///< 对端已关闭且缓冲区中的数据已读完
+    OnRecvDataCBType   m_on_recv_data_cb{[](TCPPeerClient*) {}};    ///< 收到数据的回调
+    OnDisconnectCBType m_on_disconnect_cb{[](TCPPeerClient*) {}};   ///< 断开连接的回调
+    OnWritableCBType   m_on_writable_cb{[](TCPPeerClient*) {}};     ///< 可写的回调
 };
 
 using TCPPeerClientPtr = std::shared_ptr<TCPPeerClient>;
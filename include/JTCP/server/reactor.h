@@ -0,0 +1,209 @@
+/**
+ * @author Wangzhengqiao (me@zhengqiao.wang)
+ * @date 2024-11-28
+ * @brief 服务端reactor
+ */
+#pragma once
+
+#include "JResult/JResult.h"
+#include "JTCP/common/file_describe.h"
+#include "JTCP/common/metrics.h"
+#include "JTCP/common/timer_queue.h"
+#include "JTCP/server/server.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <sys/epoll.h>
+#include <unordered_map>
+#include <vector>
+
+namespace JTCP::Server {
+
+/**
+ * @brief reactor：一个epoll实例和运行它的线程，负责自己监听套接字上accept到的全部连接
+ *
+ * 连接对象在reactor线程上创建并首次访问，reactor绑定到某个NUMA节点的CPU后，
+ * 按内核的first-touch策略，连接对象和收发路径上的内存都落在该节点上。
+ *
+ * epoll事件中保存的是连接句柄（fd与连接代数），而不是单独的fd：fd关闭后可能被新连接复用，
+ * 代数不符的事件属于已断开的连接，直接丢弃。断开的连接在本轮事件全部处理完后才释放，
+ * 同一批事件处理期间其fd不会被关闭，也就不会被本轮accept到的新连接复用。
+ */
+class TCPReactor
+{
+public:
+    /**
+     * @brief 构造reactor
+     *
+     * @param server 所属服务，提供回调与选项
+     * @param index reactor序号，用于CPU绑定
+     * @param listen_fd 监听套接字，多个reactor可以共享同一个
+     */
+    TCPReactor(TCPServer* server, size_t index, FileDescribePtr listen_fd);
+    TCPReactor(const TCPReactor&) = delete;
+    TCPReactor(TCPReactor&&)      = delete;
+    ~TCPReactor();
+
+    /**
+     * @brief reactor线程函数，直到stop后返回
+     *
+     * @return JResultWithErrMsg 返回值
+     */
+    JResultWithErrMsg run();
+
+    /**
+     * @brief 通知reactor线程退出，线程在下一次epoll_wait返回后结束
+     *
+     */
+    void stop() noexcept { m_run_flag = false; }
+
+    bool   isRunning() const noexcept { return m_run_flag; }
+    size_t getIndex() const noexcept { return m_index; }
+
+    /**
+     * @brief 本reactor的运行指标快照
+     *
+     */
+    Metrics::ReactorMetricsSnapshot getMetrics() const { return m_metrics.snapshot(); }
+
+private:
+    /**
+     * @brief 初始化epoll
+     *
+     * @return JResultWithErrMsg 返回值
+     */
+    JResultWithErrMsg initEpoll();
+
+    using EpollEventType = uint32_t;
+    using EpollOprType   = int32_t;
+
+    /// 连接关注的事件，EPOLLRDHUP使对端关闭在事件中直接可见
+    static constexpr EpollEventType CLIENT_EVENTS = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    /// 限速期间关注的事件，只去掉EPOLLIN，仍能及时发现对端关闭和错误
+    static constexpr EpollEventType CLIENT_PAUSED_EVENTS = EPOLLRDHUP | EPOLLET;
+
+    /**
+     * @brief 按连接的限速和可写通知状态计算应关注的事件
+     *
+     */
+    static EpollEventType getClientEvents(const TCPPeerClient& peer_client) noexcept;
+
+    /**
+     * @brief 连接状态变化后更新epoll中关注的事件，尚未注册的连接在注册时处理
+     *
+     */
+    JResultWithErrMsg updateClientEvents(TCPPeerClient* peer_client);
+
+    /**
+     * @brief 把连接加入重新调度队列，下一轮再次调用其数据回调
+     *
+     */
+    void requeueClient(TCPPeerClient* peer_client);
+    JResultWithErrMsg epollOprEvent(EpollOprType opr, FileDescribe::FDType fd,
+                                    EpollEventType epoll_events, uint32_t generation = 0);
+
+    /**
+     * @brief 连接句柄：高32位为连接代数，低32位为fd，监听套接字的代数为0
+     *
+     */
+    using HandleType = uint64_t;
+    static HandleType makeHandle(FileDescribe::FDType fd, uint32_t generation) noexcept
+    {
+        return (static_cast<HandleType>(generation) << 32) | static_cast<uint32_t>(fd);
+    }
+    static FileDescribe::FDType getHandleFD(HandleType handle) noexcept
+    {
+        return static_cast<FileDescribe::FDType>(handle & 0xFFFFFFFF);
+    }
+    static uint32_t getHandleGeneration(HandleType handle) noexcept
+    {
+        return static_cast<uint32_t>(handle >> 32);
+    }
+
+    using ClockType = std::chrono::steady_clock;
+    JResultWithErrMsg handleNewClientConnect(const ClockType::time_point& wakeup_time);
+    JResultWithErrMsg handleClientMsg(epoll_event& event, const ClockType::time_point& wakeup_time);
+
+    /**
+     * @brief 以RST关闭未通过准入控制的连接，不进入TIME_WAIT
+     *
+     */
+    void rejectConnection(FileDescribe::FDType fd, AdmitResult result);
+
+    /**
+     * @brief accept失败（如fd耗尽）后，在稍后由定时器重试
+     *
+     */
+    void scheduleAcceptRetry();
+
+    /**
+     * @brief 以本轮读取配额调用连接的数据回调，并记录分发延迟与回调耗时
+     *
+     * 回调中用完配额的连接加入重新调度队列。
+     */
+    void dispatchRecvData(const TCPPeerClientPtr& peer_client, FileDescribe::FDType fd,
+                          const ClockType::time_point& wakeup_time);
+
+    /**
+     * @brief 按本次回调读取的字节数和上报的消息数扣减令牌，令牌不足时暂停读取该连接
+     *
+     */
+    void applyThrottle(const TCPPeerClientPtr& peer_client, FileDescribe::FDType fd);
+
+    /**
+     * @brief 定时器到期，恢复读取被限速的连接
+     *
+     */
+    void resumeThrottled(const TCPPeerClientPtr& peer_client, FileDescribe::FDType fd);
+
+    /**
+     * @brief 重新调用上一轮用完读取配额的连接的数据回调
+     *
+     */
+    void dispatchRequeued(const ClockType::time_point& wakeup_time);
+
+    /**
+     * @brief 释放上一轮断开的连接
+     *
+     */
+    void reclaimRetired();
+
+    friend class TCPPeerClient;
+
+    /**
+     * @brief 断开连接，可在任意线程调用，同一连接重复调用时返回失败
+     *
+     * 连接对象移入待释放列表，在reactor线程处理完本轮事件后释放。
+     *
+     * @param peer_client 要断开的连接
+     * @param error 为0表示对端正常关闭，-1表示本端主动断开，否则为导致断开的errno
+     */
+    JResultWithErrMsg delClient(TCPPeerClient* peer_client, int error = 0);
+
+private:
+    TCPServer*      m_server{nullptr};      ///< 所属服务
+    size_t          m_index{0};             ///< reactor序号
+    FileDescribePtr m_listen_fd{nullptr};   ///< 监听的文件描述符
+
+    using ClientMgrType = std::unordered_map<FileDescribe::FDType, TCPPeerClientPtr>;
+    ClientMgrType                 m_client_mgr;         ///< 客户端管理
+    std::vector<TCPPeerClientPtr> m_retired;            ///< 已断开待释放的连接，由客户端管理锁保护
+    std::mutex                    m_client_mgr_mutex;   ///< 客户端管理锁
+    uint32_t                      m_generation{0};      ///< 最近分配的连接代数
+
+    /// accept失败后的重试间隔
+    static constexpr auto ACCEPT_RETRY_INTERVAL = std::chrono::milliseconds(100);
+    bool                  m_accept_retry_pending{false};   ///< 是否已安排accept重试
+
+    using EpollFileDescribeType = FileDescribe::FDType;
+    EpollFileDescribeType m_epollfd{-1};   ///< epoll文件描述符
+
+    std::atomic<bool> m_run_flag{false};   ///< 运行标志
+
+    std::vector<TCPPeerClientPtr> m_requeued;   ///< 用完读取配额的连接，只在reactor线程上访问
+    TimerQueue                    m_timers;     ///< 定时器，只在reactor线程上访问
+
+    Metrics::ReactorMetrics m_metrics;   ///< 运行指标
+};
+
+}   // namespace JTCP::Server
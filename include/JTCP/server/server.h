@@ -6,12 +6,19 @@
 #pragma once
 
 #include "JResult/JResult.h"
+#include "JTCP/common/metrics.h"
+#include "JTCP/common/socket_address.h"
+#include "JTCP/common/socket_options.h"
+#include "JTCP/server/admission.h"
 #include "JTCP/server/peer_client.h"
+#include <chrono>
 #include <fcntl.h>
 #include <functional>
 #include <future>
+#include <memory>
 #include <unordered_map>
 #include <mutex>
+#include <vector>
 
 /**
  * @brief Server命名空间
@@ -26,6 +33,118 @@ namespace JTCP::Server {
 class TCPPeerClient;
 using TCPPeerClientPtr = std::shared_ptr<TCPPeerClient>;
 
+/**
+ * @brief reactor对象类，见include/JTCP/server/reactor.h文件
+ *
+ */
+class TCPReactor;
+
+/**
+ * @brief 单个连接的读取限速，各项为0时不限制
+ *
+ * 超过限速的连接暂时从epoll中去掉EPOLLIN，由定时器在令牌补足后恢复。暂停期间数据留在
+ * 内核接收缓冲区，缓冲区满后由TCP流量控制让对端停止发送，服务端不替对端缓存数据。
+ */
+struct ThrottleOptions
+{
+    uint64_t bytes_per_second{0};      ///< 每秒最多读取的字节数
+    uint64_t burst_bytes{0};           ///< 允许突发读取的字节数，为0时等于bytes_per_second
+    uint32_t messages_per_second{0};   ///< 每秒最多处理的消息数，由TCPPeerClient::countMessages上报
+    uint32_t burst_messages{0};        ///< 允许突发处理的消息数，为0时等于messages_per_second
+
+    bool isEnabled() const noexcept { return bytes_per_second > 0 || messages_per_second > 0; }
+};
+
+/**
+ * @brief 服务端选项
+ *
+ */
+struct ServerOptions
+{
+    /**
+     * @brief 双栈监听：监听IPv6地址时同时接受IPv4连接，监听"0.0.0.0"时改为监听"::"
+     *
+     * 关闭时IPv6监听套接字只接受IPv6连接，不受系统net.ipv6.bindv6only配置影响。
+     */
+    bool dual_stack{false};
+
+    /**
+     * @brief 自旋时长：处理完一批事件后，在该时长内以零超时调用epoll_wait，之后才阻塞等待
+     *
+     * 为0时不自旋。自旋期间reactor线程占满一个CPU，换取新消息到达时无需经过线程唤醒。
+     */
+    std::chrono::microseconds spin_duration{0};
+
+    /**
+     * @brief 大于0时对监听和连接套接字设置SO_BUSY_POLL（微秒），内核支持时同时开启epoll忙轮询
+     *
+     * 超过系统net.core.busy_read配置的值需要CAP_NET_ADMIN权限，设置失败时只记录日志。
+     */
+    uint32_t busy_poll_us{0};
+
+    /**
+     * @brief reactor线程绑定的CPU，第i个reactor绑定cpu_affinity[i % size]，为空时不绑定
+     *
+     */
+    std::vector<int> cpu_affinity;
+
+    /**
+     * @brief reactor数量，大于1时每个reactor以SO_REUSEPORT各自监听同一地址，由内核分配新连接
+     *
+     * Unix域套接字不支持SO_REUSEPORT的负载分配，此时所有reactor共享同一个监听套接字。
+     */
+    size_t reactor_num{1};
+
+    /**
+     * @brief reactor线程绑定的NUMA节点，第i个reactor绑定numa_nodes[i % size]上的全部CPU
+     *
+     * 设置了cpu_affinity时以cpu_affinity为准。连接对象在reactor线程上分配，随之落在本节点内存上。
+     */
+    std::vector<int> numa_nodes;
+
+    /**
+     * @brief 按收到连接请求的CPU选择reactor：优先绑定了该CPU的reactor，其次同一NUMA节点上的reactor
+     *
+     * 通过在SO_REUSEPORT组上挂载CBPF程序实现，需要reactor_num大于1且监听TCP地址；
+     * 网卡队列的中断应与reactor绑定在相同的CPU上，才能让连接始终在本节点处理。
+     */
+    bool steer_by_cpu{false};
+
+    /**
+     * @brief 每次epoll_wait最多取出的事件数
+     *
+     * 事件数组从较小的长度开始，取满时翻倍直到该上限；取满的次数见指标event_list_full。
+     */
+    uint32_t max_events_per_wakeup{1024};
+
+    /**
+     * @brief 每个连接每轮最多读取的字节数，为0时不限
+     *
+     * 用完配额后readData返回失败，与暂时没有数据时相同。该连接在本轮其余事件处理完后
+     * 重新调用数据回调，避免单个持续发送的连接在边缘触发模式下独占reactor。
+     */
+    size_t read_budget{0};
+
+    /**
+     * @brief 连接准入控制，超限的连接在accept后立即以RST关闭，不创建TCPPeerClient也不触发新连接回调
+     *
+     */
+    AdmissionOptions admission;
+
+    /**
+     * @brief 单个连接的读取限速，限速状态见TCPPeerClient::getStats()
+     *
+     */
+    ThrottleOptions throttle;
+
+    /**
+     * @brief 套接字选项，监听套接字在bind前设置，连接在accept后设置；默认只开启SO_REUSEADDR
+     *
+     * 可使用SocketOptions::lowLatency()、SocketOptions::bulkThroughput()预设。
+     */
+    SocketOptions socket_options;
+};
+
 /**
  * @brief TCP服务对象
  *
@@ -38,57 +157,81 @@ public:
      * 
      */
     using OnNewClientCBType = std::function<void(TCPPeerClientPtr)>;
+    TCPServer() = default;
+    ~TCPServer();
+
     /**
      * @brief 设置当有客户端链接时触发的回调
      *
+     * 连接对象引用其所属的reactor，reactor在下次start或服务端析构时释放，
+     * 用户持有的TCPPeerClientPtr必须在此之前释放，之后不能再调用其任何方法。
+     *
      * @param cb 回调函数
      */
     void setOnNewClient(OnNewClientCBType cb) noexcept;
 
+    /**
+     * @brief 设置服务端选项，需在start之前调用
+     *
+     */
+    void setOptions(const ServerOptions& options) noexcept;
+
     using ListenMaxNumType = int32_t;
     /**
      * @brief 开始监听
      *
-     * @param listen_addr 监听地址
+     * @param listen_addr 监听地址，IPv4或IPv6字面量，或"unix:/path"、"unix:@name"形式的
+     *                    Unix域套接字地址；Unix域套接字忽略端口，stop时删除套接字文件
      * @param listen_port 监听端口
      * @param listen_max_num 最大监听队列数量，超出的请求会被拒绝
-     * @return JResultWithErrMsg 返回值
+     * @return JResultWithErrMsg 返回值，已经启动且未调用stop时返回失败
      */
     JResultWithErrMsg start(const Types::IPStrType& listen_addr, const Types::PortType& listen_port,
                             const ListenMaxNumType& listen_max_num = 20);
     /**
      * @brief 停止监听
      *
+     * reactor对象保留到下次start或服务端析构，在此之前用户持有的连接仍可安全调用。
+     *
      * @return JResultWithErrMsg 返回值
      */
     JResultWithErrMsg stop();
 
+    /**
+     * @brief 获取运行指标快照，每个reactor一项
+     *
+     * 只读取各计数器当前值并在调用线程上汇总，不影响reactor线程
+     *
+     * @return Metrics::ServerMetricsSnapshot 指标快照
+     */
+    Metrics::ServerMetricsSnapshot getMetrics() const;
+
 private:
     /**
-     * @brief epoll处理线程函数
+     * @brief 创建、绑定并开始监听一个监听套接字
      *
-     * @param listen_max_num 最大监听数量
-     * @return JResultWithErrMsg 返回值
+     * @param addr 监听地址
+     * @param listen_max_num 最大监听队列数量
+     * @param reuse_port 是否设置SO_REUSEPORT，多个reactor各自监听同一地址时使用
+     * @return JResultWithSuccErrMsg<FileDescribePtr> 非阻塞的监听套接字
      */
-    JResultWithErrMsg acceptThreadFunc(const ListenMaxNumType& listen_max_num);
+    JResultWithSuccErrMsg<FileDescribePtr> createListenSocket(
+        const SocketAddress& addr, const ListenMaxNumType& listen_max_num, bool reuse_port);
 
     /**
-     * @brief 初始化epoll
+     * @brief 在SO_REUSEPORT组上挂载按CPU选择reactor的CBPF程序
      *
+     * @param fd 组内任一监听套接字
      * @return JResultWithErrMsg 返回值
      */
-    JResultWithErrMsg initEpoll();
+    JResultWithErrMsg attachSteeringProgram(FileDescribe::FDType fd);
 
-    using EpollEventType = uint32_t;
-    using EpollOprType   = int32_t;
-    JResultWithErrMsg epollOprEvent(EpollOprType opr, FileDescribe::FDType fd,
-                                    EpollEventType epoll_events);
-
-    JResultWithErrMsg handleNewClientConnect();
-    JResultWithErrMsg handleClientMsg(epoll_event& event);
-
-    friend class TCPPeerClient;
-    JResultWithErrMsg delClient(const FileDescribe::FDType& fd);
+    /**
+     * @brief reactor绑定的CPU列表，cpu_affinity优先于numa_nodes，都未设置时为空
+     *
+     * @param reactor_index reactor序号
+     */
+    std::vector<int> getReactorCPUs(size_t reactor_index) const;
 
     /**
      * 设置文件描述符的阻塞或非阻塞模式
@@ -102,18 +245,36 @@ private:
      */
     JResultWithErrMsg setFileDiscribeBlock(FileDescribe::FDType fd, bool is_block);
 
-private:
-    OnNewClientCBType              m_on_new_client_cb;            ///< 新客户端连接的回调
-    FileDescribePtr                m_server_listen_fd{nullptr};   ///< 监听的文件描述符
-    std::future<JResultWithErrMsg> m_accept_thread;               ///< 监听连接的线程
+    /**
+     * @brief 绑定Unix域套接字路径前删除残留的套接字文件
+     *
+     * @param path 套接字路径，抽象命名空间的名字以'@'开头
+     * @return JResultWithErrMsg 路径被非套接字文件占用时返回失败
+     */
+    JResultWithErrMsg prepareUnixPath(const std::string& path);
+
+    /**
+     * @brief 按选项设置套接字的SO_BUSY_POLL
+     *
+     */
+    void applyBusyPoll(FileDescribe::FDType fd);
+
+    /**
+     * @brief 按选项把当前reactor线程绑定到CPU
+     *
+     * @param reactor_index reactor序号
+     */
+    void applyCPUAffinity(size_t reactor_index);
 
-    using ClientMgrType = std::unordered_map<FileDescribe::FDType, TCPPeerClientPtr>;
-    ClientMgrType m_client_mgr;         ///< 客户端管理
-    std::mutex    m_client_mgr_mutex;   ///< 客户端管理锁
+    friend class TCPReactor;
 
-    using EpollFileDescribeType = FileDescribe::FDType;
-    EpollFileDescribeType m_epollfd;   ///< epoll文件描述符
+private:
+    OnNewClientCBType m_on_new_client_cb;   ///< 新客户端连接的回调
+    ServerOptions     m_options;            ///< 服务端选项
+    std::string       m_unix_path;          ///< 需在stop时删除的套接字文件
+    AdmissionControl  m_admission;          ///< 连接准入控制
 
-    bool m_run_flag{false};   ///< 运行标志
+    std::vector<std::unique_ptr<TCPReactor>>    m_reactors;          ///< 全部reactor
+    std::vector<std::future<JResultWithErrMsg>> m_reactor_threads;   ///< reactor线程
 };
 }   // namespace JTCP::Server
@@ -0,0 +1,238 @@
+#include "JTCP/client/async_client.h"
+#include "JTCP/common/logger.h"
+#include "JTCP/common/socket_address.h"
+#include <cerrno>
+#include <cstring>
+
+namespace JTCP::Client {
+
+JResultWithSuccErrMsg<AsyncTCPClientPtr> AsyncTCPClient::createNew(
+    TCPClientLoop& loop, const SocketOptions& socket_options)
+{
+    auto client              = std::make_shared<AsyncTCPClient>(&loop);
+    client->m_socket_options = socket_options;
+    client->m_fd = std::make_shared<FileDescribe>(
+        socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+    if (client->m_fd->isInvalid()) {
+        JTCP_LOG_WARN("create socket failed: %s", strerror(errno));
+        return JResultWithSuccErrMsg<AsyncTCPClientPtr>::failure("failed to create socket");
+    }
+    return JResultWithSuccErrMsg<AsyncTCPClientPtr>::success(std::move(client));
+}
+
+void AsyncTCPClient::setOnConnectCB(OnConnectCBType cb)
+{
+    m_on_connect_cb = cb;
+}
+void AsyncTCPClient::setOnRecvDataCB(OnRecvDataCBType cb)
+{
+    m_on_recv_data_cb = cb;
+}
+void AsyncTCPClient::setOnCloseCB(OnCloseCBType cb)
+{
+    m_on_close_cb = cb;
+}
+
+std::future<bool> AsyncTCPClient::connect(const Types::IPStrType& server_ip,
+                                          const Types::PortType&  server_port)
+{
+    State expect_state = State::DISCONNECTED;
+    if (false == m_state.compare_exchange_strong(expect_state, State::CONNECTING)) {
+        std::promise<bool> promise;
+        promise.set_value(false);
+        return promise.get_future();
+    }
+    auto future = m_connect_promise.get_future();
+
+    auto addr_ret = SocketAddress::parse(server_ip, server_port);
+    if (addr_ret.isFailure()) {
+        JTCP_LOG_WARN("connect to %s:%u failed: invalid address", server_ip.c_str(), server_port);
+        auto self = shared_from_this();
+        m_loop->runInLoop([self]() { self->handleClose(); });
+        return future;
+    }
+    auto& addr = *addr_ret.getSuccessPtr();
+    // createNew时地址族未知，先按IPv4创建，连接其他地址族时重新创建套接字
+    if (addr.getFamily() != AF_INET) {
+        m_fd = std::make_shared<FileDescribe>(
+            socket(addr.getFamily(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+    }
+    // 选项设置失败只记录日志，仍然发起连接
+    m_socket_options.apply(m_fd->getFD(), addr.getFamily());
+    if (::connect(m_fd->getFD(), addr.getSockAddr(), addr.getLength()) < 0 &&
+        errno != EINPROGRESS) {
+        JTCP_LOG_WARN(
+            "connect to %s:%u failed: %s", server_ip.c_str(), server_port, strerror(errno));
+        // 在事件循环线程上通知连接失败，保证回调总是在事件循环线程上执行
+        auto self = shared_from_this();
+        m_loop->runInLoop([self]() { self->handleClose(); });
+        return future;
+    }
+
+    // 无论connect是否立即完成，都以注册后的第一个可写事件作为连接完成的信号
+    auto self = shared_from_this();
+    m_loop->runInLoop([self]() {
+        if (self->m_loop->addClient(self).isFailure()) {
+            self->handleClose();
+        }
+    });
+    return future;
+}
+
+JResultWithErrMsg AsyncTCPClient::sendData(const char* data, size_t len)
+{
+    std::lock_guard<std::mutex> lock_guard(m_send_mutex);
+    if (m_state == State::CLOSED || m_state == State::DISCONNECTED) {
+        return JResultWithErrMsg::failure("client is not connected");
+    }
+
+    bool was_empty = m_send_buff.empty();
+    m_send_buff.append(data, len);
+    // 队列中已有数据时，说明套接字不可写，等待事件循环在可写时继续发送
+    if (m_state == State::CONNECTED && was_empty && false == flushSendBuffer()) {
+        // 持有发送队列锁，不能在此直接关闭
+        auto self = shared_from_this();
+        m_loop->queueInLoop([self]() { self->handleClose(); });
+        return JResultWithErrMsg::failure("failed to send data");
+    }
+    return JResultWithErrMsg::success();
+}
+
+void AsyncTCPClient::close()
+{
+    auto self = shared_from_this();
+    m_loop->runInLoop([self]() { self->handleClose(); });
+}
+
+size_t AsyncTCPClient::getPendingSendBytes()
+{
+    std::lock_guard<std::mutex> lock_guard(m_send_mutex);
+    return m_send_buff.readableBytes();
+}
+
+void AsyncTCPClient::handleEvent(uint32_t events)
+{
+    if (m_state == State::CONNECTING) {
+        if (0 == (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+            return;
+        }
+        handleConnect();
+        if (m_state != State::CONNECTED) {
+            return;
+        }
+    }
+
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        handleRead();
+    }
+    if (m_state == State::CONNECTED && (events & EPOLLOUT)) {
+        std::unique_lock<std::mutex> lock(m_send_mutex);
+        if (false == flushSendBuffer()) {
+            lock.unlock();
+            handleClose();
+        }
+    }
+}
+
+void AsyncTCPClient::handleConnect()
+{
+    int       error{0};
+    socklen_t len = sizeof(error);
+    if (getsockopt(m_fd->getFD(), SOL_SOCKET, SO_ERROR, &error, &len) < 0) {
+        error = errno;
+    }
+    if (error != 0) {
+        JTCP_LOG_WARN("async connect failed: %s", strerror(error));
+        handleClose();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock_guard(m_send_mutex);
+        m_state = State::CONNECTED;
+    }
+    m_connect_promise.set_value(true);
+    m_on_connect_cb(this, true);
+
+    // 发出连接建立前排队的数据
+    std::unique_lock<std::mutex> lock(m_send_mutex);
+    if (false == flushSendBuffer()) {
+        lock.unlock();
+        handleClose();
+    }
+}
+
+void AsyncTCPClient::handleRead()
+{
+    // 边缘触发，必须读到EAGAIN为止
+    bool peer_closed = false;
+    while (true) {
+        auto ret = m_recv_buff.readFD(m_fd->getFD());
+        if (ret > 0) {
+            continue;
+        }
+        if (ret == 0) {
+            peer_closed = true;
+        }
+        else if (errno == EINTR) {
+            continue;
+        }
+        else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            JTCP_LOG_WARN("read from server failed: %s", strerror(errno));
+            peer_closed = true;
+        }
+        break;
+    }
+
+    if (false == m_recv_buff.empty()) {
+        m_on_recv_data_cb(this, m_recv_buff);
+    }
+    if (peer_closed) {
+        handleClose();
+    }
+}
+
+void AsyncTCPClient::handleClose()
+{
+    State old_state;
+    {
+        std::lock_guard<std::mutex> lock_guard(m_send_mutex);
+        old_state = m_state.exchange(State::CLOSED);
+    }
+    if (old_state == State::CLOSED) {
+        return;
+    }
+
+    // 只关闭连接而不释放描述符，描述符随对象析构释放，避免其他线程误用被复用的描述符
+    shutdown(m_fd->getFD(), SHUT_RDWR);
+    m_loop->delClient(m_fd->getFD());
+
+    if (old_state == State::CONNECTING) {
+        m_connect_promise.set_value(false);
+        m_on_connect_cb(this, false);
+        return;
+    }
+    m_on_close_cb(this);
+}
+
+bool AsyncTCPClient::flushSendBuffer()
+{
+    while (false == m_send_buff.empty()) {
+        auto ret =
+            send(m_fd->getFD(), m_send_buff.peek(), m_send_buff.readableBytes(), MSG_NOSIGNAL);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            JTCP_LOG_WARN("send to server failed: %s", strerror(errno));
+            return false;
+        }
+        m_send_buff.retrieve(ret);
+    }
+    return true;
+}
+
+}   // namespace JTCP::Client
@@ -1,24 +1,40 @@
 #include "JTCP/client/client.h"
-
+#include "JTCP/common/logger.h"
+#include "JTCP/common/resolver.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
 
 namespace JTCP::Client {
 
 JResultWithSuccErrMsg<std::shared_ptr<TCPClient>> TCPClient::createNew(
-    const Types::IPStrType& server_ip, const Types::PortType& server_port)
+    const Types::IPStrType& server_ip, const Types::PortType& server_port,
+    const SocketOptions& socket_options)
 {
+    auto addr_ret = SocketAddress::parse(server_ip, server_port);
+    if (addr_ret.isFailure()) {
+        return JResultWithSuccErrMsg<std::shared_ptr<TCPClient>>::failure(
+            addr_ret.getFailurePtr());
+    }
+    auto& addr = *addr_ret.getSuccessPtr();
+
     auto client  = std::make_shared<TCPClient>();
-    client->m_fd = std::make_shared<FileDescribe>(socket(AF_INET, SOCK_STREAM, 0));
+    client->m_fd = std::make_shared<FileDescribe>(socket(addr.getFamily(), SOCK_STREAM, 0));
     if (client->m_fd->isInvalid()) {
+        JTCP_LOG_WARN("create socket failed: %s", strerror(errno));
         return JResultWithSuccErrMsg<std::shared_ptr<TCPClient>>::failure(
             "failed to create socket");
     }
+    if (auto ret = socket_options.apply(client->m_fd->getFD(), addr.getFamily()); ret.isFailure()) {
+        return JResultWithSuccErrMsg<std::shared_ptr<TCPClient>>::failure(ret.getFailurePtr());
+    }
 
-    struct sockaddr_in addr;
-    addr.sin_family      = AF_INET;
-    addr.sin_port        = htons(server_port);
-    addr.sin_addr.s_addr = inet_addr(server_ip.c_str());
-    if (connect(client->m_fd->getFD(), (const struct sockaddr*)&addr, sizeof(struct sockaddr_in)) <
-        0) {
+    if (connect(client->m_fd->getFD(), addr.getSockAddr(), addr.getLength()) < 0) {
+        JTCP_LOG_WARN(
+            "connect to %s:%u failed: %s", server_ip.c_str(), server_port, strerror(errno));
         return JResultWithSuccErrMsg<std::shared_ptr<TCPClient>>::failure(
             "failed to connect to server");
     }
@@ -27,16 +43,233 @@ JResultWithSuccErrMsg<std::shared_ptr<TCPClient>> TCPClient::createNew(
     return JResultWithSuccErrMsg<std::shared_ptr<TCPClient>>::success(std::move(client));
 }
 
+JResultWithSuccErrMsg<std::shared_ptr<TCPClient>> TCPClient::connectTo(
+    const std::string& host, const Types::PortType& port, const ConnectOptions& options)
+{
+    auto addrs_ret = Resolver::resolve(host, port);
+    if (addrs_ret.isFailure()) {
+        return JResultWithSuccErrMsg<std::shared_ptr<TCPClient>>::failure(
+            addrs_ret.getFailurePtr());
+    }
+    return connectTo(*addrs_ret.getSuccessPtr(), options);
+}
+
+JResultWithSuccErrMsg<std::shared_ptr<TCPClient>> TCPClient::connectTo(
+    const std::vector<SocketAddress>& addrs, const ConnectOptions& options)
+{
+    using ClockType  = std::chrono::steady_clock;
+    using ResultType = JResultWithSuccErrMsg<std::shared_ptr<TCPClient>>;
+
+    auto now          = ClockType::now();
+    auto deadline     = now + options.timeout;
+    bool has_deadline = options.timeout.count() > 0;
+
+    // 进行中的连接尝试
+    std::vector<struct pollfd> attempts;
+    size_t                     next_index = 0;
+    auto                       next_time  = now;
+    int                        winner_fd  = -1;
+    int                        last_errno = 0;
+
+    // TFO下connect不等待握手就返回成功，无法据此挑选最先连通的地址
+    auto socket_options              = options.socket_options;
+    socket_options.fast_open_connect = false;
+
+    while (winner_fd < 0) {
+        now = ClockType::now();
+        if (has_deadline && now >= deadline) {
+            last_errno = ETIMEDOUT;
+            break;
+        }
+
+        // 到了发起下一个尝试的时间，或已经没有进行中的尝试
+        if (next_index < addrs.size() && (attempts.empty() || now >= next_time)) {
+            auto& addr = addrs[next_index++];
+            int   fd   = socket(addr.getFamily(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) {
+                last_errno = errno;
+                continue;
+            }
+            if (socket_options.apply(fd, addr.getFamily()).isFailure()) {
+                last_errno = errno;
+                close(fd);
+                continue;
+            }
+            if (connect(fd, addr.getSockAddr(), addr.getLength()) == 0) {
+                winner_fd = fd;
+                break;
+            }
+            if (errno != EINPROGRESS) {
+                last_errno = errno;
+                JTCP_LOG_DEBUG("connect to %s failed: %s", addr.toString().c_str(), strerror(errno));
+                close(fd);
+                continue;
+            }
+            attempts.push_back({fd, POLLOUT, 0});
+            next_time = now + options.attempt_delay;
+            continue;
+        }
+        if (attempts.empty()) {
+            break;
+        }
+
+        // 等到有尝试完成、该发起下一个尝试或超时
+        int wait_ms = -1;
+        if (next_index < addrs.size() || has_deadline) {
+            auto wake_time = next_index < addrs.size() ? next_time : deadline;
+            if (has_deadline) {
+                wake_time = std::min(wake_time, deadline);
+            }
+            wait_ms = static_cast<int>(std::max<int64_t>(
+                0, std::chrono::ceil<std::chrono::milliseconds>(wake_time - now).count()));
+        }
+        if (poll(attempts.data(), attempts.size(), wait_ms) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            last_errno = errno;
+            break;
+        }
+
+        for (size_t i = 0; i < attempts.size();) {
+            if (attempts[i].revents == 0) {
+                ++i;
+                continue;
+            }
+            int       err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(attempts[i].fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err == 0 && winner_fd < 0) {
+                winner_fd = attempts[i].fd;
+            }
+            else {
+                last_errno = err;
+                close(attempts[i].fd);
+                // 失败后不必等待间隔，立即发起下一个尝试
+                next_time = now;
+            }
+            attempts.erase(attempts.begin() + i);
+        }
+    }
+
+    for (auto& attempt : attempts) {
+        close(attempt.fd);
+    }
+    if (winner_fd < 0) {
+        JTCP_LOG_WARN("connect to %zu addresses failed: %s",
+                      addrs.size(),
+                      last_errno != 0 ? strerror(last_errno) : "no address");
+        return ResultType::failure(last_errno == ETIMEDOUT ? "connect timeout"
+                                                           : "failed to connect to server");
+    }
+
+    // 后续读写均为阻塞模式
+    fcntl(winner_fd, F_SETFL, fcntl(winner_fd, F_GETFL) & ~O_NONBLOCK);
+    auto client  = std::make_shared<TCPClient>();
+    client->m_fd = std::make_shared<FileDescribe>(winner_fd);
+    return ResultType::success(std::move(client));
+}
+
 JResultWithErrMsg TCPClient::sendData(const char* data, size_t len)
+{
+    std::string_view view(data, len);
+    return sendBatch(&view, 1);
+}
+
+JResultWithErrMsg TCPClient::sendBatch(const std::string_view* datas, size_t count)
 {
     if (m_fd->isInvalid()) {
         return JResultWithErrMsg::failure("invalid file descriptor");
     }
 
-    if (send(m_fd->getFD(), data, len, 0) < 0) {
-        return JResultWithErrMsg::failure("failed to send data");
+    // 缓冲区中尚未发出的数据排在最前面，一并发出
+    constexpr size_t          STACK_IOV_NUM = 64;
+    struct iovec              stack_iov[STACK_IOV_NUM];
+    std::vector<struct iovec> heap_iov;
+    struct iovec*             iov = stack_iov;
+    if (count + 1 > STACK_IOV_NUM) {
+        heap_iov.resize(count + 1);
+        iov = heap_iov.data();
+    }
+
+    size_t iov_num = 0;
+    if (false == m_send_buff.empty()) {
+        iov[iov_num].iov_base = const_cast<char*>(m_send_buff.peek());
+        iov[iov_num].iov_len  = m_send_buff.readableBytes();
+        ++iov_num;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        iov[iov_num].iov_base = const_cast<char*>(datas[i].data());
+        iov[iov_num].iov_len  = datas[i].size();
+        ++iov_num;
+    }
+
+    // 失败时无法确定已发出多少，缓冲区同样清空，连接应当被丢弃
+    auto ret = sendIOV(iov, iov_num);
+    m_send_buff.retrieveAll();
+    return ret;
+}
+
+JResultWithErrMsg TCPClient::bufferData(const char* data, size_t len)
+{
+    // 大消息没有合并的必要，直接与已缓冲的数据一起发出，省去拷贝
+    if (len >= m_flush_threshold) {
+        return sendData(data, len);
+    }
+    m_send_buff.append(data, len);
+    if (m_send_buff.readableBytes() >= m_flush_threshold) {
+        return flush();
+    }
+    return JResultWithErrMsg::success();
+}
+
+JResultWithErrMsg TCPClient::flush()
+{
+    if (m_send_buff.empty()) {
+        return JResultWithErrMsg::success();
     }
+    return sendBatch(nullptr, 0);
+}
+
+JResultWithErrMsg TCPClient::sendIOV(struct iovec* iov, size_t count)
+{
+    while (count > 0) {
+        // 跳过已发完的数据段
+        if (iov->iov_len == 0) {
+            ++iov;
+            --count;
+            continue;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov    = iov;
+        msg.msg_iovlen = std::min<size_t>(count, IOV_MAX);
+
+        auto sended_len = sendmsg(m_fd->getFD(), &msg, MSG_NOSIGNAL);
+        if (sended_len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            JTCP_LOG_WARN("send to server failed: %s", strerror(errno));
+            return JResultWithErrMsg::failure("failed to send data");
+        }
 
+        // 部分发送，调整iovec后继续
+        size_t remain = static_cast<size_t>(sended_len);
+        while (remain > 0) {
+            if (remain >= iov->iov_len) {
+                remain -= iov->iov_len;
+                iov->iov_len = 0;
+                ++iov;
+                --count;
+                continue;
+            }
+            iov->iov_base = static_cast<char*>(iov->iov_base) + remain;
+            iov->iov_len -= remain;
+            remain = 0;
+        }
+    }
     return JResultWithErrMsg::success();
 }
 
@@ -46,11 +279,112 @@ JResultWithErrMsg TCPClient::recvData(char* data, size_t& len)
         return JResultWithErrMsg::failure("invalid file descriptor");
     }
 
-    if (recv(m_fd->getFD(), data, len, 0) < 0) {
+    if (false == m_recv_buff.empty()) {
+        len = std::min(len, m_recv_buff.readableBytes());
+        memcpy(data, m_recv_buff.peek(), len);
+        m_recv_buff.retrieve(len);
+        return JResultWithErrMsg::success();
+    }
+
+    auto recv_len = recv(m_fd->getFD(), data, len, 0);
+    if (recv_len < 0) {
+        JTCP_LOG_WARN("recv from server failed: %s", strerror(errno));
         return JResultWithErrMsg::failure("failed to recv data");
     }
+    len = static_cast<size_t>(recv_len);
+
+    return JResultWithErrMsg::success();
+}
+
+JResultWithErrMsg TCPClient::recvExact(char* data, size_t len)
+{
+    if (m_fd->isInvalid()) {
+        return JResultWithErrMsg::failure("invalid file descriptor");
+    }
+
+    // 先取走预读的数据
+    size_t received = std::min(len, m_recv_buff.readableBytes());
+    memcpy(data, m_recv_buff.peek(), received);
+    m_recv_buff.retrieve(received);
+
+    while (received < len) {
+        size_t remain = len - received;
+        if (remain >= READ_AHEAD_LEN) {
+            // 大块数据直接读入用户缓冲区，省去一次拷贝
+            auto recv_len = recv(m_fd->getFD(), data + received, remain, 0);
+            if (recv_len < 0 && errno == EINTR) {
+                continue;
+            }
+            if (recv_len <= 0) {
+                JTCP_LOG_WARN("recv from server failed: %s",
+                              recv_len == 0 ? "closed by peer" : strerror(errno));
+                return JResultWithErrMsg::failure("failed to recv data");
+            }
+            received += recv_len;
+            continue;
+        }
+
+        if (auto ret = fillRecvBuffer(); ret.isFailure()) {
+            return ret;
+        }
+        size_t copy_len = std::min(remain, m_recv_buff.readableBytes());
+        memcpy(data + received, m_recv_buff.peek(), copy_len);
+        m_recv_buff.retrieve(copy_len);
+        received += copy_len;
+    }
 
     return JResultWithErrMsg::success();
 }
 
+JResultWithSuccErrMsg<std::string> TCPClient::recvUntil(std::string_view delim, size_t max_len)
+{
+    if (m_fd->isInvalid()) {
+        return JResultWithSuccErrMsg<std::string>::failure("invalid file descriptor");
+    }
+    if (delim.empty()) {
+        return JResultWithSuccErrMsg<std::string>::failure("empty delimiter");
+    }
+
+    // 只在新到达的数据中查找，已查找过的部分不再重复扫描
+    size_t offset = 0;
+    while (true) {
+        auto pos = m_recv_buff.find(delim, offset);
+        // 预读可能一次取到max_len之后的数据，分隔符出现在max_len之后同样视为超长
+        if (pos != std::string_view::npos && pos + delim.size() > max_len) {
+            return JResultWithSuccErrMsg<std::string>::failure("delimiter not found");
+        }
+        if (pos != std::string_view::npos) {
+            std::string result(m_recv_buff.peek(), pos + delim.size());
+            m_recv_buff.retrieve(result.size());
+            return JResultWithSuccErrMsg<std::string>::success(std::move(result));
+        }
+        if (m_recv_buff.readableBytes() >= max_len) {
+            return JResultWithSuccErrMsg<std::string>::failure("delimiter not found");
+        }
+        if (m_recv_buff.readableBytes() >= delim.size()) {
+            offset = m_recv_buff.readableBytes() - delim.size() + 1;
+        }
+        if (auto ret = fillRecvBuffer(); ret.isFailure()) {
+            return JResultWithSuccErrMsg<std::string>::failure(ret.getFailurePtr());
+        }
+    }
+}
+
+JResultWithErrMsg TCPClient::fillRecvBuffer()
+{
+    m_recv_buff.ensureWritable(READ_AHEAD_LEN);
+    while (true) {
+        auto recv_len = m_recv_buff.readFD(m_fd->getFD());
+        if (recv_len > 0) {
+            return JResultWithErrMsg::success();
+        }
+        if (recv_len < 0 && errno == EINTR) {
+            continue;
+        }
+        JTCP_LOG_WARN("recv from server failed: %s",
+                      recv_len == 0 ? "closed by peer" : strerror(errno));
+        return JResultWithErrMsg::failure("failed to recv data");
+    }
+}
+
 }   // namespace JTCP::Client
@@ -0,0 +1,216 @@
+#include "JTCP/client/client_loop.h"
+#include "JTCP/client/async_client.h"
+#include "JTCP/common/logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/eventfd.h>
+
+namespace JTCP::Client {
+
+TCPClientLoop::~TCPClientLoop()
+{
+    if (m_loop_thread.valid()) {
+        stop();
+    }
+}
+
+JResultWithErrMsg TCPClientLoop::start()
+{
+    if (m_loop_thread.valid()) {
+        return JResultWithErrMsg::failure("client loop is already running");
+    }
+
+    m_epoll_fd = std::make_shared<FileDescribe>(epoll_create1(EPOLL_CLOEXEC));
+    if (m_epoll_fd->isInvalid()) {
+        return JResultWithErrMsg::failure("create epoll failed");
+    }
+    {
+        std::lock_guard<std::mutex> lock_guard(m_tasks_mutex);
+        m_tasks_closed = false;
+    }
+    m_wakeup_fd = std::make_shared<FileDescribe>(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    if (m_wakeup_fd->isInvalid()) {
+        return JResultWithErrMsg::failure("create eventfd failed");
+    }
+
+    struct epoll_event event;
+    event.events   = EPOLLIN;
+    event.data.u64 = makeHandle(m_wakeup_fd->getFD(), 0);
+    if (epoll_ctl(m_epoll_fd->getFD(), EPOLL_CTL_ADD, m_wakeup_fd->getFD(), &event) < 0) {
+        return JResultWithErrMsg::failure("add eventfd to epoll failed");
+    }
+
+    m_loop_thread = std::async(std::launch::async, &TCPClientLoop::loopThreadFunc, this);
+    while (m_run_flag == false) {
+        if (m_loop_thread.wait_for(std::chrono::milliseconds(100)) !=
+            std::future_status::timeout) {
+            return m_loop_thread.get();
+        }
+    }
+    return JResultWithErrMsg::success();
+}
+
+JResultWithErrMsg TCPClientLoop::stop()
+{
+    if (false == m_loop_thread.valid()) {
+        return JResultWithErrMsg::failure("client loop is not running");
+    }
+    m_run_flag = false;
+    wakeup();
+    return m_loop_thread.get();
+}
+
+void TCPClientLoop::runInLoop(TaskType task)
+{
+    if (isInLoopThread()) {
+        task();
+        return;
+    }
+    queueInLoop(std::move(task));
+}
+
+void TCPClientLoop::queueInLoop(TaskType task)
+{
+    {
+        std::lock_guard<std::mutex> lock_guard(m_tasks_mutex);
+        if (false == m_tasks_closed) {
+            m_tasks.emplace_back(std::move(task));
+            wakeup();
+            return;
+        }
+    }
+    // 事件循环已退出，投递的任务不会再被执行，直接执行使连接得到失败结果
+    task();
+}
+
+JResultWithErrMsg TCPClientLoop::addClient(const AsyncTCPClientPtr& client)
+{
+    auto fd = client->getFileDescribe()->getFD();
+    if (false == m_run_flag) {
+        return JResultWithErrMsg::failure("client loop is stopped");
+    }
+    // 代数0留给eventfd
+    if (0 == ++m_generation) {
+        ++m_generation;
+    }
+
+    // 边缘触发同时关注读写，可写事件只在从不可写变为可写时触发，无需反复修改关注的事件
+    struct epoll_event event;
+    event.events   = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.u64 = makeHandle(fd, m_generation);
+    if (epoll_ctl(m_epoll_fd->getFD(), EPOLL_CTL_ADD, fd, &event) < 0) {
+        JTCP_LOG_WARN("add client %d to epoll failed: %s", fd, strerror(errno));
+        return JResultWithErrMsg::failure("add client to epoll failed");
+    }
+    m_clients[fd] = RegisteredClient{client, m_generation};
+    return JResultWithErrMsg::success();
+}
+
+void TCPClientLoop::delClient(FileDescribe::FDType fd)
+{
+    auto client_iter = m_clients.find(fd);
+    if (client_iter == m_clients.end()) {
+        return;
+    }
+    epoll_ctl(m_epoll_fd->getFD(), EPOLL_CTL_DEL, fd, nullptr);
+    // 延后到本轮事件处理完再释放，保证正在执行的回调中客户端对象仍然有效
+    auto client = std::move(client_iter->second.client);
+    m_clients.erase(client_iter);
+    queueInLoop([client]() {});
+}
+
+JResultWithErrMsg TCPClientLoop::loopThreadFunc()
+{
+    m_loop_thread_id = std::this_thread::get_id();
+
+    // 事件数组从较小的长度开始，取满时翻倍，直到max_events_per_wakeup
+    size_t max_events = std::max<size_t>(m_options.max_events_per_wakeup, 1);
+
+    using ReadyNumType = int;
+    ReadyNumType             ready_event_num{0};                             ///< 触发的事件数量
+    std::vector<epoll_event> event_list(std::min<size_t>(64, max_events));   ///< 缓存的event列表
+
+    m_run_flag = true;
+    while (m_run_flag) {
+        ready_event_num = epoll_wait(
+            m_epoll_fd->getFD(), event_list.data(), static_cast<int>(event_list.size()), 1000);
+        if (ready_event_num == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            JTCP_LOG_ERROR("client loop epoll_wait failed: %s", strerror(errno));
+            m_run_flag = false;
+            break;
+        }
+
+        for (ReadyNumType i = 0; i < ready_event_num; i++) {
+            auto& event = event_list[i];
+            if (event.data.u64 == makeHandle(m_wakeup_fd->getFD(), 0)) {
+                uint64_t count{0};
+                while (read(m_wakeup_fd->getFD(), &count, sizeof(count)) > 0) {}
+                continue;
+            }
+            // 本轮前面的事件处理中连接已关闭，或fd已被新连接复用，事件不属于当前连接
+            auto fd          = static_cast<FileDescribe::FDType>(event.data.u64 & 0xFFFFFFFF);
+            auto client_iter = m_clients.find(fd);
+            if (client_iter != m_clients.end() &&
+                makeHandle(fd, client_iter->second.generation) == event.data.u64) {
+                client_iter->second.client->handleEvent(event.events);
+            }
+        }
+        if ((size_t)ready_event_num == event_list.size() && event_list.size() < max_events) {
+            event_list.resize(std::min(event_list.size() * 2, max_events));
+        }
+
+        doPendingTasks();
+    }
+
+    // 关闭仍然存活的连接，关闭回调中投递的任务也一并执行
+    std::vector<AsyncTCPClientPtr> clients;
+    for (auto& client : m_clients) {
+        clients.push_back(client.second.client);
+    }
+    for (auto& client : clients) {
+        client->handleClose();
+    }
+    doPendingTasks(true);
+    m_loop_thread_id = std::thread::id();
+
+    return JResultWithErrMsg::success();
+}
+
+void TCPClientLoop::wakeup()
+{
+    if (nullptr == m_wakeup_fd) {
+        return;
+    }
+    uint64_t count{1};
+    if (write(m_wakeup_fd->getFD(), &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        JTCP_LOG_WARN("wakeup client loop failed: %s", strerror(errno));
+    }
+}
+
+void TCPClientLoop::doPendingTasks(bool final_run)
+{
+    while (true) {
+        std::vector<TaskType> tasks;
+        {
+            std::lock_guard<std::mutex> lock_guard(m_tasks_mutex);
+            tasks.swap(m_tasks);
+            // 队列为空时才关闭投递，关闭前投递的任务都在本线程上执行
+            if (tasks.empty()) {
+                m_tasks_closed = final_run;
+                return;
+            }
+        }
+        for (auto& task : tasks) {
+            task();
+        }
+        if (false == final_run) {
+            return;
+        }
+    }
+}
+
+}   // namespace JTCP::Client
@@ -0,0 +1,227 @@
+#include "JTCP/client/client_pool.h"
+#include "JTCP/common/logger.h"
+#include <cerrno>
+
+namespace JTCP::Client {
+
+std::shared_ptr<TCPClient> HostClientSlots::take() noexcept
+{
+    for (size_t i = 0; i < m_slot_num; ++i) {
+        auto&    slot  = m_slots[i];
+        uint32_t state = IDLE;
+        if (slot.state.load(std::memory_order_relaxed) != IDLE ||
+            false == slot.state.compare_exchange_strong(state, BUSY, std::memory_order_acquire)) {
+            continue;
+        }
+        auto client = std::move(slot.client);
+        slot.state.store(EMPTY, std::memory_order_release);
+        return client;
+    }
+    return nullptr;
+}
+
+void HostClientSlots::put(std::shared_ptr<TCPClient> client) noexcept
+{
+    for (size_t i = 0; i < m_slot_num; ++i) {
+        auto&    slot  = m_slots[i];
+        uint32_t state = EMPTY;
+        if (slot.state.load(std::memory_order_relaxed) != EMPTY ||
+            false == slot.state.compare_exchange_strong(state, BUSY, std::memory_order_acquire)) {
+            continue;
+        }
+        slot.client    = std::move(client);
+        slot.last_used = ClockType::now();
+        slot.state.store(IDLE, std::memory_order_release);
+        return;
+    }
+    // 槽位数与连接上限相同，正常情况下不会走到这里
+    release();
+}
+
+bool HostClientSlots::reserve() noexcept
+{
+    size_t live_num = m_live_num.load(std::memory_order_relaxed);
+    while (live_num < m_slot_num) {
+        if (m_live_num.compare_exchange_weak(live_num, live_num + 1, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void HostClientSlots::evict(std::chrono::milliseconds idle_timeout) noexcept
+{
+    auto now = ClockType::now();
+    for (size_t i = 0; i < m_slot_num; ++i) {
+        auto&    slot  = m_slots[i];
+        uint32_t state = IDLE;
+        if (slot.state.load(std::memory_order_relaxed) != IDLE ||
+            false == slot.state.compare_exchange_strong(state, BUSY, std::memory_order_acquire)) {
+            continue;
+        }
+        if (now - slot.last_used < idle_timeout && isHealthy(*slot.client)) {
+            slot.state.store(IDLE, std::memory_order_release);
+            continue;
+        }
+        slot.client = nullptr;
+        slot.state.store(EMPTY, std::memory_order_release);
+        release();
+    }
+}
+
+size_t HostClientSlots::getIdleNum() const noexcept
+{
+    size_t idle_num = 0;
+    for (size_t i = 0; i < m_slot_num; ++i) {
+        if (m_slots[i].state.load(std::memory_order_relaxed) == IDLE) {
+            ++idle_num;
+        }
+    }
+    return idle_num;
+}
+
+bool HostClientSlots::isHealthy(const TCPClient& client) noexcept
+{
+    auto fd = client.getFileDescribe();
+    if (nullptr == fd || fd->isInvalid()) {
+        return false;
+    }
+    // 用户态缓冲区中残留的数据会被下一个使用者读到或发出
+    if (client.getRecvBufferedBytes() > 0 || client.getBufferedBytes() > 0) {
+        return false;
+    }
+    // 空闲连接上不应有数据：读到0说明对端已关闭，读到数据说明上一个请求的回包未读完
+    char probe;
+    auto ret = recv(fd->getFD(), &probe, sizeof(probe), MSG_PEEK | MSG_DONTWAIT);
+    return ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+PooledClient::~PooledClient()
+{
+    if (nullptr == m_host || nullptr == m_client) {
+        return;
+    }
+    // 预读了多余的回包或忘记flush的连接不能交给下一个请求
+    if (m_broken || m_client->getRecvBufferedBytes() > 0 || m_client->getBufferedBytes() > 0) {
+        m_client = nullptr;
+        m_host->release();
+        return;
+    }
+    m_host->put(std::move(m_client));
+}
+
+TCPClientPool::TCPClientPool(ClientPoolOptions options)
+    : m_options(options)
+    , m_hosts(std::make_shared<const HostMapType>())
+{
+    m_evict_thread = std::thread(&TCPClientPool::evictThreadFunc, this);
+}
+
+TCPClientPool::~TCPClientPool()
+{
+    {
+        std::lock_guard<std::mutex> lock_guard(m_evict_mutex);
+        m_run_flag = false;
+    }
+    m_evict_cv.notify_one();
+    if (m_evict_thread.joinable()) {
+        m_evict_thread.join();
+    }
+}
+
+JResultWithSuccErrMsg<std::shared_ptr<PooledClient>> TCPClientPool::acquire(
+    const Types::IPStrType& server_ip, const Types::PortType& server_port)
+{
+    using ResultType = JResultWithSuccErrMsg<std::shared_ptr<PooledClient>>;
+
+    auto host = getHost(server_ip, server_port);
+
+    // 优先复用空闲连接，跳过已被对端关闭的
+    while (auto client = host->take()) {
+        if (HostClientSlots::isHealthy(*client)) {
+            return ResultType::success(std::make_shared<PooledClient>(host, std::move(client)));
+        }
+        host->release();
+    }
+
+    if (false == host->reserve()) {
+        return ResultType::failure("too many connections to " + server_ip + ":" +
+                                   std::to_string(server_port));
+    }
+    auto client_ret = TCPClient::createNew(server_ip, server_port, m_options.socket_options);
+    if (client_ret.isFailure()) {
+        host->release();
+        return ResultType::failure(client_ret.getFailurePtr());
+    }
+    return ResultType::success(std::make_shared<PooledClient>(host, *client_ret.getSuccessPtr()));
+}
+
+JResultWithSuccErrMsg<TCPPipelineChannelPtr> TCPClientPool::getChannel(
+    const Types::IPStrType& server_ip, const Types::PortType& server_port)
+{
+    using ResultType = JResultWithSuccErrMsg<TCPPipelineChannelPtr>;
+    if (nullptr == m_options.pipeline_loop) {
+        return ResultType::failure("pipeline loop is not set");
+    }
+
+    auto                        host = getHost(server_ip, server_port);
+    std::lock_guard<std::mutex> lock_guard(host->m_channel_mutex);
+    if (nullptr != host->m_channel && false == host->m_channel->isClosed()) {
+        return ResultType::success(host->m_channel);
+    }
+
+    auto channel_ret = TCPPipelineChannel::createNew(
+        *m_options.pipeline_loop, server_ip, server_port, m_options.socket_options);
+    if (channel_ret.isFailure()) {
+        return channel_ret;
+    }
+    host->m_channel = *channel_ret.getSuccessPtr();
+    return ResultType::success(host->m_channel);
+}
+
+size_t TCPClientPool::getIdleNum(const Types::IPStrType& server_ip,
+                                 const Types::PortType&  server_port)
+{
+    return getHost(server_ip, server_port)->getIdleNum();
+}
+
+HostClientSlotsPtr TCPClientPool::getHost(const Types::IPStrType& server_ip,
+                                          const Types::PortType&  server_port)
+{
+    auto key   = server_ip + ":" + std::to_string(server_port);
+    auto hosts = std::atomic_load(&m_hosts);
+    if (auto host_iter = hosts->find(key); host_iter != hosts->end()) {
+        return host_iter->second;
+    }
+
+    // 新增host时复制整张表再替换，读取方始终无锁
+    std::lock_guard<std::mutex> lock_guard(m_hosts_mutex);
+    hosts = std::atomic_load(&m_hosts);
+    if (auto host_iter = hosts->find(key); host_iter != hosts->end()) {
+        return host_iter->second;
+    }
+    auto new_hosts = std::make_shared<HostMapType>(*hosts);
+    auto host =
+        std::make_shared<HostClientSlots>(server_ip, server_port, m_options.max_per_host);
+    new_hosts->emplace(key, host);
+    std::atomic_store(&m_hosts, HostMapPtrType(std::move(new_hosts)));
+    return host;
+}
+
+void TCPClientPool::evictThreadFunc()
+{
+    std::unique_lock<std::mutex> lock(m_evict_mutex);
+    while (m_run_flag) {
+        m_evict_cv.wait_for(lock, m_options.check_interval);
+        if (false == m_run_flag) {
+            break;
+        }
+
+        auto hosts = std::atomic_load(&m_hosts);
+        for (auto& host : *hosts) {
+            host.second->evict(m_options.idle_timeout);
+        }
+    }
+}
+
+}   // namespace JTCP::Client
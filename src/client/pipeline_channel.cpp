@@ -0,0 +1,196 @@
+#include "JTCP/client/pipeline_channel.h"
+#include "JTCP/common/logger.h"
+#include <cstring>
+#include <endian.h>
+
+namespace JTCP::Client {
+
+namespace {
+
+void encodeHeader(char* header, uint32_t len, PipelineFrame::CorrelationIDType id)
+{
+    uint32_t net_len = htobe32(len);
+    uint64_t net_id  = htobe64(id);
+    memcpy(header, &net_len, sizeof(net_len));
+    memcpy(header + sizeof(net_len), &net_id, sizeof(net_id));
+}
+
+void decodeHeader(const char* header, uint32_t& len, PipelineFrame::CorrelationIDType& id)
+{
+    uint32_t net_len{0};
+    uint64_t net_id{0};
+    memcpy(&net_len, header, sizeof(net_len));
+    memcpy(&net_id, header + sizeof(net_len), sizeof(net_id));
+    len = be32toh(net_len);
+    id  = be64toh(net_id);
+}
+
+}   // namespace
+
+void PipelineFrame::encode(ByteBuffer& buff, CorrelationIDType id, const char* data, size_t len)
+{
+    buff.ensureWritable(HEADER_LEN + len);
+    encodeHeader(buff.beginWrite(), static_cast<uint32_t>(len), id);
+    buff.hasWritten(HEADER_LEN);
+    buff.append(data, len);
+}
+
+JResultWithSuccErrMsg<bool> PipelineFrame::decode(ByteBuffer& buff, CorrelationIDType& id,
+                                                  std::string& payload)
+{
+    if (buff.readableBytes() < HEADER_LEN) {
+        return JResultWithSuccErrMsg<bool>::success(false);
+    }
+    uint32_t len{0};
+    decodeHeader(buff.peek(), len, id);
+    if (len > MAX_PAYLOAD_LEN) {
+        return JResultWithSuccErrMsg<bool>::failure("invalid frame length");
+    }
+    if (buff.readableBytes() < HEADER_LEN + len) {
+        return JResultWithSuccErrMsg<bool>::success(false);
+    }
+    payload.assign(buff.peek() + HEADER_LEN, len);
+    buff.retrieve(HEADER_LEN + len);
+    return JResultWithSuccErrMsg<bool>::success(true);
+}
+
+JResultWithSuccErrMsg<TCPPipelineChannelPtr> TCPPipelineChannel::createNew(
+    TCPClientLoop& loop, const Types::IPStrType& server_ip, const Types::PortType& server_port,
+    const SocketOptions& socket_options)
+{
+    auto client_ret = AsyncTCPClient::createNew(loop, socket_options);
+    if (client_ret.isFailure()) {
+        return JResultWithSuccErrMsg<TCPPipelineChannelPtr>::failure(client_ret.getFailurePtr());
+    }
+
+    auto channel      = std::make_shared<TCPPipelineChannel>();
+    channel->m_client = *client_ret.getSuccessPtr();
+
+    // 回调只持有弱引用，避免通道与连接互相持有
+    std::weak_ptr<TCPPipelineChannel> weak_channel = channel;
+    channel->m_client->setOnRecvDataCB([weak_channel](AsyncTCPClient*, ByteBuffer& buff) {
+        if (auto channel = weak_channel.lock(); nullptr != channel) {
+            channel->handleRecvData(buff);
+        }
+    });
+    channel->m_client->setOnCloseCB([weak_channel](AsyncTCPClient*) {
+        if (auto channel = weak_channel.lock(); nullptr != channel) {
+            channel->handleClose();
+        }
+    });
+
+    if (false == channel->m_client->connect(server_ip, server_port).get()) {
+        return JResultWithSuccErrMsg<TCPPipelineChannelPtr>::failure(
+            "failed to connect to server");
+    }
+    return JResultWithSuccErrMsg<TCPPipelineChannelPtr>::success(std::move(channel));
+}
+
+JResultWithErrMsg TCPPipelineChannel::call(const char* data, size_t len, OnResponseCBType cb)
+{
+    if (len > PipelineFrame::MAX_PAYLOAD_LEN) {
+        return JResultWithErrMsg::failure("request is too large");
+    }
+
+    // 先登记再发送，回包可能在sendData返回前就已到达
+    auto id = m_next_id.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock_guard(m_pending_mutex);
+        if (m_closed) {
+            return JResultWithErrMsg::failure("channel is closed");
+        }
+        m_pending.emplace(id, std::move(cb));
+    }
+
+    thread_local ByteBuffer frame;
+    frame.retrieveAll();
+    PipelineFrame::encode(frame, id, data, len);
+    if (auto ret = m_client->sendData(frame.peek(), frame.readableBytes()); ret.isFailure()) {
+        std::lock_guard<std::mutex> lock_guard(m_pending_mutex);
+        m_pending.erase(id);
+        return ret;
+    }
+    return JResultWithErrMsg::success();
+}
+
+std::future<std::optional<std::string>> TCPPipelineChannel::call(const char* data, size_t len)
+{
+    auto promise = std::make_shared<std::promise<std::optional<std::string>>>();
+    auto future  = promise->get_future();
+    auto ret     = call(data, len, [promise](std::optional<std::string_view> response) {
+        if (response.has_value()) {
+            promise->set_value(std::string(*response));
+        }
+        else {
+            promise->set_value(std::nullopt);
+        }
+    });
+    if (ret.isFailure()) {
+        promise->set_value(std::nullopt);
+    }
+    return future;
+}
+
+void TCPPipelineChannel::close()
+{
+    if (nullptr != m_client) {
+        m_client->close();
+    }
+}
+
+size_t TCPPipelineChannel::getPendingNum()
+{
+    std::lock_guard<std::mutex> lock_guard(m_pending_mutex);
+    return m_pending.size();
+}
+
+void TCPPipelineChannel::handleRecvData(ByteBuffer& buff)
+{
+    // 负载直接以视图交给回调，避免拷贝
+    while (buff.readableBytes() >= PipelineFrame::HEADER_LEN) {
+        uint32_t                         len{0};
+        PipelineFrame::CorrelationIDType id{0};
+        decodeHeader(buff.peek(), len, id);
+        if (len > PipelineFrame::MAX_PAYLOAD_LEN) {
+            JTCP_LOG_WARN("pipeline channel received invalid frame length: %u", len);
+            m_client->close();
+            return;
+        }
+        if (buff.readableBytes() < PipelineFrame::HEADER_LEN + len) {
+            return;
+        }
+
+        OnResponseCBType cb{nullptr};
+        {
+            std::lock_guard<std::mutex> lock_guard(m_pending_mutex);
+            auto                        pending_iter = m_pending.find(id);
+            if (pending_iter != m_pending.end()) {
+                cb = std::move(pending_iter->second);
+                m_pending.erase(pending_iter);
+            }
+        }
+        if (nullptr != cb) {
+            cb(std::string_view(buff.peek() + PipelineFrame::HEADER_LEN, len));
+        }
+        else {
+            JTCP_LOG_WARN("pipeline channel received unknown correlation id: %lu",
+                          static_cast<unsigned long>(id));
+        }
+        buff.retrieve(PipelineFrame::HEADER_LEN + len);
+    }
+}
+
+void TCPPipelineChannel::handleClose()
+{
+    PendingMapType pending;
+    {
+        std::lock_guard<std::mutex> lock_guard(m_pending_mutex);
+        m_closed = true;
+        pending.swap(m_pending);
+    }
+    for (auto& request : pending) {
+        request.second(std::nullopt);
+    }
+}
+
+}   // namespace JTCP::Client
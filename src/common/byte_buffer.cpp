@@ -0,0 +1,56 @@
+#include "JTCP/common/byte_buffer.h"
+#include <algorithm>
+#include <cstring>
+#include <sys/uio.h>
+
+namespace JTCP {
+
+void ByteBuffer::append(const char* data, size_t len)
+{
+    ensureWritable(len);
+    memcpy(beginWrite(), data, len);
+    hasWritten(len);
+}
+
+void ByteBuffer::ensureWritable(size_t len)
+{
+    if (writableBytes() >= len) {
+        return;
+    }
+
+    // 头部已读的空间不够时才扩容，否则只把未读数据搬到头部
+    size_t readable = readableBytes();
+    if (m_read_index + writableBytes() < len) {
+        m_buff.resize(std::max(m_buff.size() * 2, m_write_index + len));
+    }
+    memmove(m_buff.data(), peek(), readable);
+    m_read_index  = 0;
+    m_write_index = readable;
+}
+
+ssize_t ByteBuffer::readFD(int fd)
+{
+    char extra_buff[65536];
+
+    struct iovec vec[2];
+    size_t       writable = writableBytes();
+    vec[0].iov_base       = beginWrite();
+    vec[0].iov_len        = writable;
+    vec[1].iov_base       = extra_buff;
+    vec[1].iov_len        = sizeof(extra_buff);
+
+    ssize_t ret = readv(fd, vec, 2);
+    if (ret <= 0) {
+        return ret;
+    }
+    if (static_cast<size_t>(ret) <= writable) {
+        hasWritten(ret);
+    }
+    else {
+        hasWritten(writable);
+        append(extra_buff, ret - writable);
+    }
+    return ret;
+}
+
+}   // namespace JTCP
@@ -0,0 +1,74 @@
+#include "JTCP/common/cpu_topology.h"
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+namespace JTCP {
+
+int CPUTopology::getCPUNum() noexcept
+{
+    auto cpu_num = sysconf(_SC_NPROCESSORS_CONF);
+    return cpu_num > 0 ? static_cast<int>(cpu_num) : 1;
+}
+
+int CPUTopology::getNumaNode(int cpu) noexcept
+{
+    // CPU目录下有一个指向所在节点的nodeN链接
+    auto path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR* dir  = opendir(path.c_str());
+    if (nullptr == dir) {
+        return 0;
+    }
+    int node = 0;
+    while (auto entry = readdir(dir)) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' &&
+            entry->d_name[4] <= '9') {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+std::vector<int> CPUTopology::getNodeCPUs(int node)
+{
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string   cpu_list;
+    if (false == static_cast<bool>(std::getline(file, cpu_list))) {
+        // 没有NUMA信息的系统视为只有节点0
+        if (node != 0) {
+            return {};
+        }
+        std::vector<int> cpus;
+        for (int cpu = 0; cpu < getCPUNum(); ++cpu) {
+            cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+    return parseCPUList(cpu_list);
+}
+
+std::vector<int> CPUTopology::parseCPUList(const std::string& cpu_list)
+{
+    std::vector<int>   cpus;
+    std::istringstream ranges(cpu_list);
+    std::string        range;
+    while (std::getline(ranges, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        auto dash_pos = range.find('-');
+        int  first    = atoi(range.c_str());
+        int  last     = dash_pos == std::string::npos ? first : atoi(range.c_str() + dash_pos + 1);
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+}   // namespace JTCP
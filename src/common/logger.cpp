@@ -0,0 +1,211 @@
+#include "JTCP/common/logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace JTCP::Log {
+
+namespace {
+
+uint64_t nowNS() noexcept
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::system_clock::now().time_since_epoch())
+                                     .count());
+}
+
+/**
+ * @brief 全局日志后端，程序退出时析构，默认后端会在析构时输出剩余日志
+ *
+ */
+struct BackendHolder
+{
+    std::shared_ptr<LogBackend> backend{std::make_shared<AsyncLogBackend>()};
+};
+
+BackendHolder& backendHolder()
+{
+    static BackendHolder instance;
+    return instance;
+}
+
+std::atomic<uint64_t> g_backend_id{0};
+
+}   // namespace
+
+const char* getLevelName(LogLevel level) noexcept
+{
+    switch (level) {
+    case LogLevel::DEBUG: return "DEBUG";
+    case LogLevel::INFO: return "INFO";
+    case LogLevel::WARN: return "WARN";
+    case LogLevel::ERROR: return "ERROR";
+    case LogLevel::OFF: return "OFF";
+    }
+    return "UNKNOWN";
+}
+
+void AsyncLogBackend::stderrSink(LogLevel level, uint64_t timestamp_ns, std::string_view msg)
+{
+    time_t    seconds = static_cast<time_t>(timestamp_ns / 1000000000);
+    struct tm local_time;
+    localtime_r(&seconds, &local_time);
+
+    char time_buff[32]{0};
+    strftime(time_buff, sizeof(time_buff), "%Y-%m-%d %H:%M:%S", &local_time);
+    fprintf(stderr,
+            "[%s.%06lu][%s] %.*s\n",
+            time_buff,
+            static_cast<unsigned long>(timestamp_ns % 1000000000 / 1000),
+            getLevelName(level),
+            static_cast<int>(msg.size()),
+            msg.data());
+}
+
+AsyncLogBackend::AsyncLogBackend(SinkType sink)
+    : m_sink(std::move(sink))
+    , m_id(++g_backend_id)
+{
+    m_consume_thread = std::thread(&AsyncLogBackend::consumeThreadFunc, this);
+}
+
+AsyncLogBackend::~AsyncLogBackend()
+{
+    m_run_flag = false;
+    m_wait_cv.notify_one();
+    if (m_consume_thread.joinable()) {
+        m_consume_thread.join();
+    }
+}
+
+void AsyncLogBackend::write(LogLevel level, std::string_view msg) noexcept
+{
+    auto ring = getLocalRing();
+    if (nullptr == ring) {
+        m_dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    LogEntry entry;
+    entry.timestamp_ns = nowNS();
+    entry.level        = level;
+    entry.len          = static_cast<uint8_t>(std::min(msg.size(), MAX_MSG_LEN));
+    memcpy(entry.msg, msg.data(), entry.len);
+    if (false == ring->tryPush(entry)) {
+        m_dropped_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void AsyncLogBackend::flush()
+{
+    // 等待后台线程完整地轮询两轮，保证调用前写入的日志都已输出
+    auto target = m_drained_round.load(std::memory_order_acquire) + 2;
+    while (m_run_flag && m_drained_round.load(std::memory_order_acquire) < target) {
+        m_wait_cv.notify_one();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+AsyncLogBackend::RingType* AsyncLogBackend::getLocalRing() noexcept
+{
+    struct LocalCache
+    {
+        uint64_t    backend_id{0};
+        RingPtrType ring{nullptr};
+    };
+    thread_local LocalCache cache;
+    if (cache.backend_id == m_id) {
+        return cache.ring.get();
+    }
+
+    // 本线程第一次向该后端写日志，创建并登记队列
+    try {
+        auto ring = std::make_shared<RingType>();
+        {
+            std::lock_guard<std::mutex> lock_guard(m_rings_mutex);
+            m_rings.push_back(ring);
+        }
+        cache.backend_id = m_id;
+        cache.ring       = std::move(ring);
+    }
+    catch (...) {
+        return nullptr;
+    }
+    return cache.ring.get();
+}
+
+void AsyncLogBackend::consumeThreadFunc()
+{
+    while (m_run_flag) {
+        bool has_data = drainOnce();
+        m_drained_round.fetch_add(1, std::memory_order_release);
+        if (false == has_data) {
+            std::unique_lock<std::mutex> lock(m_wait_mutex);
+            m_wait_cv.wait_for(lock, std::chrono::milliseconds(10));
+        }
+    }
+
+    // 退出前输出剩余日志
+    while (drainOnce()) {}
+}
+
+bool AsyncLogBackend::drainOnce()
+{
+    std::vector<RingPtrType> rings;
+    {
+        std::lock_guard<std::mutex> lock_guard(m_rings_mutex);
+        // 线程退出后只剩登记表持有其队列，输出完即可回收
+        m_rings.erase(std::remove_if(m_rings.begin(),
+                                     m_rings.end(),
+                                     [](const RingPtrType& ring) {
+                                         return ring.use_count() == 1 && ring->empty();
+                                     }),
+                      m_rings.end());
+        rings = m_rings;
+    }
+
+    bool     has_data = false;
+    LogEntry entry;
+    for (auto& ring : rings) {
+        while (ring->tryPop(entry)) {
+            has_data = true;
+            m_sink(entry.level, entry.timestamp_ns, std::string_view(entry.msg, entry.len));
+        }
+    }
+    return has_data;
+}
+
+void setBackend(std::shared_ptr<LogBackend> backend)
+{
+    std::atomic_store(&backendHolder().backend, std::move(backend));
+}
+
+std::shared_ptr<LogBackend> getBackend()
+{
+    return std::atomic_load(&backendHolder().backend);
+}
+
+void log(LogLevel level, const char* fmt, ...)
+{
+    auto backend = getBackend();
+    if (nullptr == backend) {
+        return;
+    }
+
+    char    buff[512];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(buff, sizeof(buff), fmt, args);
+    va_end(args);
+    if (len < 0) {
+        return;
+    }
+
+    auto msg_len = std::min(static_cast<size_t>(len), sizeof(buff) - 1);
+    backend->write(level, std::string_view(buff, msg_len));
+}
+
+}   // namespace JTCP::Log
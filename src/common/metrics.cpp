@@ -0,0 +1,144 @@
+#include "JTCP/common/metrics.h"
+#include <cmath>
+
+namespace JTCP::Metrics {
+
+uint64_t HistogramSnapshot::percentile(double percentile) const noexcept
+{
+    if (count == 0) {
+        return 0;
+    }
+    if (percentile < 0.0) {
+        percentile = 0.0;
+    }
+    else if (percentile > 100.0) {
+        percentile = 100.0;
+    }
+
+    // 至少要覆盖一个样本，否则p0会落在第一个空桶上
+    uint64_t target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * count));
+    if (target == 0) {
+        target = 1;
+    }
+
+    uint64_t cumulative = 0;
+    for (uint32_t i = 0; i < buckets.size(); ++i) {
+        cumulative += buckets[i];
+        if (cumulative >= target) {
+            return LatencyHistogram::bucketUpperBound(i);
+        }
+    }
+    return LatencyHistogram::bucketUpperBound(static_cast<uint32_t>(buckets.size() - 1));
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot& other)
+{
+    if (buckets.size() < other.buckets.size()) {
+        buckets.resize(other.buckets.size(), 0);
+    }
+    for (size_t i = 0; i < other.buckets.size(); ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum += other.sum;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(uint32_t index) noexcept
+{
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    uint32_t group = index / SUB_BUCKET_COUNT;
+    uint64_t sub   = index % SUB_BUCKET_COUNT;
+    // 最高的桶左移后会回绕为0，减1正好得到UINT64_MAX
+    return ((SUB_BUCKET_COUNT + sub + 1) << (group - 1)) - 1;
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const
+{
+    HistogramSnapshot result;
+    result.buckets.resize(BUCKET_COUNT, 0);
+    for (uint32_t i = 0; i < BUCKET_COUNT; ++i) {
+        result.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        result.count += result.buckets[i];
+    }
+    result.sum = m_sum.load(std::memory_order_relaxed);
+    return result;
+}
+
+void ReactorMetricsSnapshot::merge(const ReactorMetricsSnapshot& other)
+{
+    accepts += other.accepts;
+    accept_failures += other.accept_failures;
+    accept_rejects += other.accept_rejects;
+    disconnects += other.disconnects;
+    peer_closes += other.peer_closes;
+    socket_errors += other.socket_errors;
+    callback_failures += other.callback_failures;
+    epoll_wakeups += other.epoll_wakeups;
+    epoll_timeouts += other.epoll_timeouts;
+    epoll_spins += other.epoll_spins;
+    events += other.events;
+    event_list_full += other.event_list_full;
+    stale_events += other.stale_events;
+    epoll_ctl_calls += other.epoll_ctl_calls;
+    read_calls += other.read_calls;
+    bytes_in += other.bytes_in;
+    read_eagains += other.read_eagains;
+    read_budget_hits += other.read_budget_hits;
+    requeues += other.requeues;
+    throttles += other.throttles;
+    send_calls += other.send_calls;
+    bytes_out += other.bytes_out;
+    send_eagains += other.send_eagains;
+    send_partials += other.send_partials;
+
+    events_per_wakeup.merge(other.events_per_wakeup);
+    dispatch_delay_ns.merge(other.dispatch_delay_ns);
+    callback_duration_ns.merge(other.callback_duration_ns);
+}
+
+ReactorMetricsSnapshot ServerMetricsSnapshot::total() const
+{
+    ReactorMetricsSnapshot result;
+    for (auto& reactor : reactors) {
+        result.merge(reactor);
+    }
+    return result;
+}
+
+ReactorMetricsSnapshot ReactorMetrics::snapshot() const
+{
+    ReactorMetricsSnapshot result;
+    result.accepts           = accepts.load();
+    result.accept_failures   = accept_failures.load();
+    result.accept_rejects    = accept_rejects.load();
+    result.disconnects       = disconnects.load();
+    result.peer_closes       = peer_closes.load();
+    result.socket_errors     = socket_errors.load();
+    result.callback_failures = callback_failures.load();
+    result.epoll_wakeups     = epoll_wakeups.load();
+    result.epoll_timeouts    = epoll_timeouts.load();
+    result.epoll_spins       = epoll_spins.load();
+    result.events            = events.load();
+    result.event_list_full   = event_list_full.load();
+    result.stale_events      = stale_events.load();
+    result.epoll_ctl_calls   = epoll_ctl_calls.load();
+    result.read_calls        = read_calls.load();
+    result.bytes_in          = bytes_in.load();
+    result.read_eagains      = read_eagains.load();
+    result.read_budget_hits  = read_budget_hits.load();
+    result.requeues          = requeues.load();
+    result.throttles         = throttles.load();
+    result.send_calls        = send_calls.load();
+    result.bytes_out         = bytes_out.load();
+    result.send_eagains      = send_eagains.load();
+    result.send_partials     = send_partials.load();
+
+    result.events_per_wakeup    = events_per_wakeup.snapshot();
+    result.dispatch_delay_ns    = dispatch_delay_ns.snapshot();
+    result.callback_duration_ns = callback_duration_ns.snapshot();
+    return result;
+}
+
+}   // namespace JTCP::Metrics
@@ -0,0 +1,103 @@
+#include "JTCP/common/resolver.h"
+#include "JTCP/common/logger.h"
+#include <algorithm>
+#include <fstream>
+#include <netdb.h>
+#include <sstream>
+#include <strings.h>
+
+namespace JTCP {
+
+JResultWithSuccErrMsg<std::vector<SocketAddress>> Resolver::resolve(const std::string&     host,
+                                                                   const Types::PortType& port)
+{
+    using ResultType = JResultWithSuccErrMsg<std::vector<SocketAddress>>;
+
+    if (auto ip_ret = SocketAddress::parse(host, port); ip_ret.isSuccess()) {
+        return ResultType::success(std::vector<SocketAddress>{*ip_ret.getSuccessPtr()});
+    }
+
+    if (auto addrs = lookupHostsFile(host, port); false == addrs.empty()) {
+        return ResultType::success(interleave(addrs));
+    }
+
+    struct addrinfo hints{};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result{nullptr};
+    if (int ret = getaddrinfo(host.c_str(), nullptr, &hints, &result); ret != 0) {
+        JTCP_LOG_WARN("resolve %s failed: %s", host.c_str(), gai_strerror(ret));
+        return ResultType::failure("failed to resolve host: " + host);
+    }
+
+    std::vector<SocketAddress> addrs;
+    for (auto info = result; nullptr != info; info = info->ai_next) {
+        if (info->ai_family != AF_INET && info->ai_family != AF_INET6) {
+            continue;
+        }
+        SocketAddress addr(info->ai_addr, info->ai_addrlen);
+        addr.setPort(port);
+        addrs.push_back(addr);
+    }
+    freeaddrinfo(result);
+
+    if (addrs.empty()) {
+        return ResultType::failure("no address for host: " + host);
+    }
+    return ResultType::success(interleave(addrs));
+}
+
+std::vector<SocketAddress> Resolver::lookupHostsFile(const std::string&     host,
+                                                     const Types::PortType& port,
+                                                     const char*            hosts_file)
+{
+    std::vector<SocketAddress> addrs;
+    std::ifstream              file(hosts_file);
+    std::string                line;
+    while (std::getline(file, line)) {
+        if (auto comment_pos = line.find('#'); comment_pos != std::string::npos) {
+            line.resize(comment_pos);
+        }
+
+        // 每行为一个地址加若干主机名，主机名不区分大小写
+        std::istringstream fields(line);
+        std::string        ip;
+        std::string        name;
+        if (!(fields >> ip)) {
+            continue;
+        }
+        while (fields >> name) {
+            if (strcasecmp(name.c_str(), host.c_str()) != 0) {
+                continue;
+            }
+            if (auto ret = SocketAddress::fromIP(ip, port); ret.isSuccess()) {
+                addrs.push_back(*ret.getSuccessPtr());
+            }
+            break;
+        }
+    }
+    return addrs;
+}
+
+std::vector<SocketAddress> Resolver::interleave(const std::vector<SocketAddress>& addrs)
+{
+    std::vector<SocketAddress> addrs6;
+    std::vector<SocketAddress> addrs4;
+    for (auto& addr : addrs) {
+        (addr.isIPv6() ? addrs6 : addrs4).push_back(addr);
+    }
+
+    std::vector<SocketAddress> result;
+    result.reserve(addrs.size());
+    for (size_t i = 0; i < std::max(addrs6.size(), addrs4.size()); ++i) {
+        if (i < addrs6.size()) {
+            result.push_back(addrs6[i]);
+        }
+        if (i < addrs4.size()) {
+            result.push_back(addrs4[i]);
+        }
+    }
+    return result;
+}
+
+}   // namespace JTCP
@@ -0,0 +1,457 @@
+#include "JTCP/common/shm_channel.h"
+#include "JTCP/common/logger.h"
+#include "JTCP/common/socket_address.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <linux/futex.h>
+#include <new>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace JTCP {
+
+/**
+ * @brief 单个方向的环形缓冲区头部，位于共享内存中
+ *
+ */
+struct ShmRingHeader
+{
+    alignas(64) std::atomic<uint64_t> write_pos{0};        ///< 发送方写位置
+    alignas(64) std::atomic<uint64_t> read_pos{0};         ///< 接收方读位置
+    alignas(64) std::atomic<uint32_t> data_seq{0};         ///< futex字，每次唤醒接收方时加一
+    std::atomic<uint32_t>             reader_waiting{0};   ///< 接收方是否在futex上睡眠
+};
+
+/**
+ * @brief 共享内存的控制块，之后依次是两个方向的数据区
+ *
+ */
+struct ShmControlBlock
+{
+    uint32_t              magic{0};           ///< 魔数
+    uint32_t              version{0};         ///< 版本
+    uint64_t              ring_capacity{0};   ///< 每个方向的容量
+    std::atomic<uint32_t> closed{0};          ///< 是否已关闭
+    ShmRingHeader         rings[2];           ///< 0为客户端发往服务端，1为服务端发往客户端
+};
+
+namespace {
+
+constexpr uint32_t SHM_MAGIC           = 0x4A544D53;   // "JTMS"
+constexpr uint32_t SHM_VERSION         = 1;
+constexpr uint64_t MIN_CAPACITY        = 4096;
+constexpr size_t   MSG_HEADER_LEN      = sizeof(uint32_t);
+constexpr uint8_t  HANDSHAKE_ACK       = 1;
+constexpr int      HANDSHAKE_TIMEOUT_S = 5;
+
+/**
+ * @brief 握手消息，随SCM_RIGHTS一起发送
+ *
+ */
+struct ShmHello
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t map_size;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "futex requires lock free uint32");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared ring requires lock free uint64");
+
+size_t dataOffset() noexcept
+{
+    return (sizeof(ShmControlBlock) + 63) & ~size_t(63);
+}
+
+uint64_t roundUpCapacity(size_t capacity) noexcept
+{
+    uint64_t result = MIN_CAPACITY;
+    while (result < capacity) {
+        result <<= 1;
+    }
+    return result;
+}
+
+void futexWait(std::atomic<uint32_t>* addr, uint32_t expect, std::chrono::nanoseconds timeout)
+{
+    struct timespec ts;
+    ts.tv_sec  = timeout.count() / 1000000000;
+    ts.tv_nsec = timeout.count() % 1000000000;
+    // 共享内存跨进程使用，不能带FUTEX_PRIVATE_FLAG
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT, expect, &ts, nullptr, 0);
+}
+
+void futexWake(std::atomic<uint32_t>* addr)
+{
+    syscall(
+        SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+/**
+ * @brief 当前进程能否使用多个CPU，只有一个CPU时忙等只会占住对端需要的时间片
+ *
+ */
+bool canSpin() noexcept
+{
+    static const bool can_spin = []() {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        return sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0 && CPU_COUNT(&cpu_set) > 1;
+    }();
+    return can_spin;
+}
+
+inline void cpuRelax() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+}   // namespace
+
+ShmChannel::~ShmChannel()
+{
+    // 未调用close就释放时同样通知对端，否则对端只能等待超时
+    close();
+    if (nullptr != m_map) {
+        munmap(m_map, m_map_size);
+    }
+}
+
+JResultWithSuccErrMsg<ShmChannelPtr> ShmChannel::connect(const std::string&       addr,
+                                                         const ShmChannelOptions& options)
+{
+    using ResultType = JResultWithSuccErrMsg<ShmChannelPtr>;
+
+    auto addr_ret = SocketAddress::parse(addr, 0);
+    if (addr_ret.isFailure()) {
+        return ResultType::failure(addr_ret.getFailurePtr());
+    }
+    auto& sock_addr = *addr_ret.getSuccessPtr();
+    if (false == sock_addr.isUnix()) {
+        return ResultType::failure("shared memory channel requires a unix socket address");
+    }
+
+    auto channel  = std::make_shared<ShmChannel>();
+    channel->m_fd =
+        std::make_shared<FileDescribe>(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (channel->m_fd->isInvalid()) {
+        return ResultType::failure("failed to create socket");
+    }
+    if (::connect(channel->m_fd->getFD(), sock_addr.getSockAddr(), sock_addr.getLength()) < 0) {
+        JTCP_LOG_WARN("connect to %s failed: %s", addr.c_str(), strerror(errno));
+        return ResultType::failure("failed to connect to server");
+    }
+
+    // 创建共享内存并初始化控制块，之后才交给服务端
+    auto capacity = roundUpCapacity(options.ring_capacity);
+    auto map_size = dataOffset() + 2 * capacity;
+    int  memfd    = memfd_create("jtcp_shm", MFD_CLOEXEC);
+    if (memfd < 0) {
+        JTCP_LOG_WARN("memfd_create failed: %s", strerror(errno));
+        return ResultType::failure("failed to create shared memory");
+    }
+    FileDescribe memfd_guard(memfd);
+    if (ftruncate(memfd, map_size) < 0) {
+        JTCP_LOG_WARN("ftruncate shared memory failed: %s", strerror(errno));
+        return ResultType::failure("failed to create shared memory");
+    }
+    channel->m_spin_count = options.spin_count;
+    if (auto ret = channel->attach(memfd, map_size, true); ret.isFailure()) {
+        return ResultType::failure(ret.getFailurePtr());
+    }
+
+    ShmHello hello{SHM_MAGIC, SHM_VERSION, map_size};
+    struct iovec iov {
+        &hello, sizeof(hello)
+    };
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))]{0};
+    struct msghdr                msg {};
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control;
+    msg.msg_controllen = sizeof(control);
+    auto cmsg          = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level   = SOL_SOCKET;
+    cmsg->cmsg_type    = SCM_RIGHTS;
+    cmsg->cmsg_len     = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+    if (sendmsg(channel->m_fd->getFD(), &msg, MSG_NOSIGNAL) != sizeof(hello)) {
+        JTCP_LOG_WARN("send shared memory handshake failed: %s", strerror(errno));
+        return ResultType::failure("failed to send handshake");
+    }
+
+    // 等待服务端确认已映射共享内存
+    struct timeval timeout {
+        HANDSHAKE_TIMEOUT_S, 0
+    };
+    setsockopt(channel->m_fd->getFD(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    uint8_t ack{0};
+    if (recv(channel->m_fd->getFD(), &ack, sizeof(ack), 0) != sizeof(ack) ||
+        ack != HANDSHAKE_ACK) {
+        JTCP_LOG_WARN("shared memory handshake with %s failed", addr.c_str());
+        return ResultType::failure("handshake failed");
+    }
+    return ResultType::success(std::move(channel));
+}
+
+JResultWithSuccErrMsg<ShmChannelPtr> ShmChannel::accept(FileDescribePtr          fd,
+                                                        const ShmChannelOptions& options)
+{
+    using ResultType = JResultWithSuccErrMsg<ShmChannelPtr>;
+    if (nullptr == fd || fd->isInvalid()) {
+        return ResultType::failure("invalid file descriptor");
+    }
+
+    ShmHello hello{};
+    struct iovec iov {
+        &hello, sizeof(hello)
+    };
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))]{0};
+    struct msghdr                msg {};
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control;
+    msg.msg_controllen = sizeof(control);
+    auto ret           = recvmsg(fd->getFD(), &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return ResultType::failure("no data available now");
+    }
+
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    if (nullptr == cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        return ResultType::failure("invalid handshake");
+    }
+    int memfd{-1};
+    memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+    FileDescribe memfd_guard(memfd);
+    if (ret != sizeof(hello) || hello.magic != SHM_MAGIC || hello.version != SHM_VERSION) {
+        return ResultType::failure("invalid handshake");
+    }
+
+    // 映射前确认大小，避免访问超出memfd实际大小的内存
+    struct stat memfd_stat;
+    if (fstat(memfd, &memfd_stat) < 0 ||
+        static_cast<uint64_t>(memfd_stat.st_size) < hello.map_size ||
+        hello.map_size < dataOffset() + 2 * MIN_CAPACITY) {
+        return ResultType::failure("invalid shared memory size");
+    }
+
+    auto channel          = std::make_shared<ShmChannel>();
+    channel->m_fd         = fd;
+    channel->m_spin_count = options.spin_count;
+    if (auto attach_ret = channel->attach(memfd, hello.map_size, false); attach_ret.isFailure()) {
+        return ResultType::failure(attach_ret.getFailurePtr());
+    }
+
+    uint8_t ack = HANDSHAKE_ACK;
+    if (send(fd->getFD(), &ack, sizeof(ack), MSG_NOSIGNAL) != sizeof(ack)) {
+        return ResultType::failure("failed to send handshake ack");
+    }
+    return ResultType::success(std::move(channel));
+}
+
+JResultWithErrMsg ShmChannel::attach(int memfd, size_t map_size, bool is_client)
+{
+    m_map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (m_map == MAP_FAILED) {
+        m_map = nullptr;
+        JTCP_LOG_WARN("mmap shared memory failed: %s", strerror(errno));
+        return JResultWithErrMsg::failure("failed to map shared memory");
+    }
+    m_map_size = map_size;
+
+    if (is_client) {
+        m_control                = new (m_map) ShmControlBlock();
+        m_control->magic         = SHM_MAGIC;
+        m_control->version       = SHM_VERSION;
+        m_control->ring_capacity = (map_size - dataOffset()) / 2;
+    }
+    else {
+        m_control = static_cast<ShmControlBlock*>(m_map);
+        // 容量必须是2的幂且与映射大小一致，否则按掩码取模会越界
+        auto capacity = m_control->ring_capacity;
+        if (m_control->magic != SHM_MAGIC || capacity < MIN_CAPACITY ||
+            (capacity & (capacity - 1)) != 0 || dataOffset() + 2 * capacity > map_size) {
+            return JResultWithErrMsg::failure("invalid shared memory layout");
+        }
+    }
+
+    m_capacity      = m_control->ring_capacity;
+    auto data_begin = static_cast<char*>(m_map) + dataOffset();
+    int  send_index = is_client ? 0 : 1;
+    m_send_ring     = &m_control->rings[send_index];
+    m_send_data     = data_begin + send_index * m_capacity;
+    m_recv_ring     = &m_control->rings[1 - send_index];
+    m_recv_data     = data_begin + (1 - send_index) * m_capacity;
+
+    m_cached_read_pos  = m_send_ring->read_pos.load(std::memory_order_acquire);
+    m_cached_write_pos = m_recv_ring->write_pos.load(std::memory_order_acquire);
+    return JResultWithErrMsg::success();
+}
+
+JResultWithSuccErrMsg<std::size_t> ShmChannel::sendData(const char* data, size_t len)
+{
+    if (isClosed()) {
+        return JResultWithSuccErrMsg<std::size_t>::failure("channel is closed");
+    }
+    if (len > getMaxMessageLen()) {
+        return JResultWithSuccErrMsg<std::size_t>::failure("message is too large");
+    }
+
+    uint64_t need = MSG_HEADER_LEN + len;
+    uint64_t pos  = m_send_ring->write_pos.load(std::memory_order_relaxed);
+    if (m_capacity - (pos - m_cached_read_pos) < need) {
+        m_cached_read_pos = m_send_ring->read_pos.load(std::memory_order_acquire);
+        if (m_capacity - (pos - m_cached_read_pos) < need) {
+            return JResultWithSuccErrMsg<std::size_t>::failure("ring is full");
+        }
+    }
+
+    auto msg_len = static_cast<uint32_t>(len);
+    copyIn(pos, &msg_len, MSG_HEADER_LEN);
+    copyIn(pos + MSG_HEADER_LEN, data, len);
+
+    // 写位置与等待标志都用顺序一致的读写，与waitData配合保证不会丢失唤醒
+    m_send_ring->write_pos.store(pos + need, std::memory_order_seq_cst);
+    if (m_send_ring->reader_waiting.load(std::memory_order_seq_cst) != 0) {
+        m_send_ring->data_seq.fetch_add(1, std::memory_order_seq_cst);
+        futexWake(&m_send_ring->data_seq);
+    }
+    return JResultWithSuccErrMsg<std::size_t>::success(len);
+}
+
+JResultWithSuccErrMsg<std::size_t> ShmChannel::readData(char* data, const size_t& expect_len)
+{
+    uint64_t pos = m_recv_ring->read_pos.load(std::memory_order_relaxed);
+    if (pos == m_cached_write_pos) {
+        m_cached_write_pos = m_recv_ring->write_pos.load(std::memory_order_acquire);
+        if (pos == m_cached_write_pos) {
+            return JResultWithSuccErrMsg<std::size_t>::failure(
+                isClosed() ? "channel is closed" : "no data available now");
+        }
+    }
+
+    // 长度与写位置都由对端写入，不可信：越界的长度会使copyOut读出映射区之外
+    uint32_t msg_len{0};
+    copyOut(pos, &msg_len, MSG_HEADER_LEN);
+    if (m_cached_write_pos - pos > m_capacity || msg_len > m_capacity - MSG_HEADER_LEN ||
+        MSG_HEADER_LEN + msg_len > m_cached_write_pos - pos) {
+        return JResultWithSuccErrMsg<std::size_t>::failure("corrupted message");
+    }
+    if (msg_len > expect_len) {
+        return JResultWithSuccErrMsg<std::size_t>::failure("buffer is too small");
+    }
+    copyOut(pos + MSG_HEADER_LEN, data, msg_len);
+    m_recv_ring->read_pos.store(pos + MSG_HEADER_LEN + msg_len, std::memory_order_release);
+    return JResultWithSuccErrMsg<std::size_t>::success(msg_len);
+}
+
+bool ShmChannel::waitData(std::chrono::nanoseconds timeout)
+{
+    uint32_t spin_count = canSpin() ? m_spin_count : 0;
+    for (uint32_t i = 0; i < spin_count; ++i) {
+        if (hasData()) {
+            return true;
+        }
+        cpuRelax();
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        uint32_t seq = m_recv_ring->data_seq.load(std::memory_order_seq_cst);
+        m_recv_ring->reader_waiting.store(1, std::memory_order_seq_cst);
+        if (hasData() || isClosed() || isPeerGone()) {
+            m_recv_ring->reader_waiting.store(0, std::memory_order_relaxed);
+            return hasData();
+        }
+
+        auto remaining = deadline - std::chrono::steady_clock::now();
+        if (remaining <= std::chrono::nanoseconds(0)) {
+            m_recv_ring->reader_waiting.store(0, std::memory_order_relaxed);
+            return false;
+        }
+        futexWait(&m_recv_ring->data_seq,
+                  seq,
+                  std::chrono::duration_cast<std::chrono::nanoseconds>(remaining));
+        m_recv_ring->reader_waiting.store(0, std::memory_order_relaxed);
+        if (hasData()) {
+            return true;
+        }
+    }
+}
+
+void ShmChannel::close() noexcept
+{
+    if (nullptr == m_control) {
+        return;
+    }
+    m_control->closed.store(1, std::memory_order_seq_cst);
+    for (auto& ring : m_control->rings) {
+        ring.data_seq.fetch_add(1, std::memory_order_seq_cst);
+        futexWake(&ring.data_seq);
+    }
+}
+
+bool ShmChannel::isPeerGone() noexcept
+{
+    if (nullptr == m_fd || m_fd->isInvalid()) {
+        return false;
+    }
+    // 握手后连接上不再有数据，读到EOF或出错说明对端进程已退出，此时代替对端关闭通道
+    char probe;
+    auto ret = recv(m_fd->getFD(), &probe, sizeof(probe), MSG_PEEK | MSG_DONTWAIT);
+    if (ret > 0 || (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))) {
+        return false;
+    }
+    close();
+    return true;
+}
+
+bool ShmChannel::isClosed() const noexcept
+{
+    return nullptr == m_control || m_control->closed.load(std::memory_order_acquire) != 0;
+}
+
+size_t ShmChannel::getMaxMessageLen() const noexcept
+{
+    return m_capacity - MSG_HEADER_LEN;
+}
+
+bool ShmChannel::hasData() noexcept
+{
+    auto pos = m_recv_ring->read_pos.load(std::memory_order_relaxed);
+    if (pos != m_cached_write_pos) {
+        return true;
+    }
+    m_cached_write_pos = m_recv_ring->write_pos.load(std::memory_order_acquire);
+    return pos != m_cached_write_pos;
+}
+
+void ShmChannel::copyIn(uint64_t pos, const void* src, size_t len) noexcept
+{
+    // 跨越数据区末尾时分两段拷贝
+    auto offset = pos & (m_capacity - 1);
+    auto first  = std::min<uint64_t>(len, m_capacity - offset);
+    memcpy(m_send_data + offset, src, first);
+    memcpy(m_send_data, static_cast<const char*>(src) + first, len - first);
+}
+
+void ShmChannel::copyOut(uint64_t pos, void* dst, size_t len) noexcept
+{
+    auto offset = pos & (m_capacity - 1);
+    auto first  = std::min<uint64_t>(len, m_capacity - offset);
+    memcpy(dst, m_recv_data + offset, first);
+    memcpy(static_cast<char*>(dst) + first, m_recv_data, len - first);
+}
+
+}   // namespace JTCP
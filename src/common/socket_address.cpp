@@ -0,0 +1,179 @@
+#include "JTCP/common/socket_address.h"
+#include <arpa/inet.h>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <netinet/in.h>
+#include <sys/un.h>
+
+namespace JTCP {
+
+SocketAddress::SocketAddress(const struct sockaddr* addr, socklen_t len)
+{
+    m_len = std::min<socklen_t>(len, sizeof(m_addr));
+    memcpy(&m_addr, addr, m_len);
+}
+
+JResultWithSuccErrMsg<SocketAddress> SocketAddress::fromIP(const Types::IPStrType& ip,
+                                                           const Types::PortType&  port)
+{
+    SocketAddress address;
+
+    auto addr4 = reinterpret_cast<struct sockaddr_in*>(&address.m_addr);
+    if (inet_pton(AF_INET, ip.c_str(), &addr4->sin_addr) == 1) {
+        addr4->sin_family = AF_INET;
+        addr4->sin_port   = htons(port);
+        address.m_len     = sizeof(struct sockaddr_in);
+        return JResultWithSuccErrMsg<SocketAddress>::success(address);
+    }
+
+    // IPv6地址允许写成[::1]的形式
+    std::string ip6 = ip;
+    if (ip6.size() >= 2 && ip6.front() == '[' && ip6.back() == ']') {
+        ip6 = ip6.substr(1, ip6.size() - 2);
+    }
+    auto addr6 = reinterpret_cast<struct sockaddr_in6*>(&address.m_addr);
+    if (inet_pton(AF_INET6, ip6.c_str(), &addr6->sin6_addr) == 1) {
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port   = htons(port);
+        address.m_len      = sizeof(struct sockaddr_in6);
+        return JResultWithSuccErrMsg<SocketAddress>::success(address);
+    }
+
+    return JResultWithSuccErrMsg<SocketAddress>::failure("invalid ip address: " + ip);
+}
+
+JResultWithSuccErrMsg<SocketAddress> SocketAddress::fromUnix(const std::string& path)
+{
+    SocketAddress address;
+    auto          addr = reinterpret_cast<struct sockaddr_un*>(&address.m_addr);
+    if (path.empty() || path == "@" || path.size() >= sizeof(addr->sun_path)) {
+        return JResultWithSuccErrMsg<SocketAddress>::failure("invalid unix socket path: " + path);
+    }
+
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, path.data(), path.size());
+    if (path.front() == '@') {
+        // 抽象命名空间以'\0'开头，长度不含结尾的'\0'
+        addr->sun_path[0] = '\0';
+        address.m_len     = offsetof(struct sockaddr_un, sun_path) + path.size();
+    }
+    else {
+        address.m_len = offsetof(struct sockaddr_un, sun_path) + path.size() + 1;
+    }
+    return JResultWithSuccErrMsg<SocketAddress>::success(address);
+}
+
+JResultWithSuccErrMsg<SocketAddress> SocketAddress::parse(const std::string&     addr,
+                                                          const Types::PortType& port)
+{
+    constexpr size_t prefix_len = std::char_traits<char>::length(UNIX_PREFIX);
+    if (addr.compare(0, prefix_len, UNIX_PREFIX) == 0) {
+        return fromUnix(addr.substr(prefix_len));
+    }
+    return fromIP(addr, port);
+}
+
+std::string SocketAddress::getIP() const
+{
+    char buff[INET6_ADDRSTRLEN]{0};
+    return getIP(buff, sizeof(buff));
+}
+
+const char* SocketAddress::getIP(char* buff, socklen_t len) const noexcept
+{
+    const void* src{nullptr};
+    if (getFamily() == AF_INET) {
+        src = &reinterpret_cast<const struct sockaddr_in*>(&m_addr)->sin_addr;
+    }
+    else if (getFamily() == AF_INET6) {
+        src = &reinterpret_cast<const struct sockaddr_in6*>(&m_addr)->sin6_addr;
+    }
+    if (len > 0 && (nullptr == src || nullptr == inet_ntop(getFamily(), src, buff, len))) {
+        buff[0] = '\0';
+    }
+    return buff;
+}
+
+Types::PortType SocketAddress::getPort() const noexcept
+{
+    if (getFamily() == AF_INET) {
+        return ntohs(reinterpret_cast<const struct sockaddr_in*>(&m_addr)->sin_port);
+    }
+    if (getFamily() == AF_INET6) {
+        return ntohs(reinterpret_cast<const struct sockaddr_in6*>(&m_addr)->sin6_port);
+    }
+    return 0;
+}
+
+void SocketAddress::setPort(Types::PortType port) noexcept
+{
+    if (getFamily() == AF_INET) {
+        reinterpret_cast<struct sockaddr_in*>(&m_addr)->sin_port = htons(port);
+    }
+    else if (getFamily() == AF_INET6) {
+        reinterpret_cast<struct sockaddr_in6*>(&m_addr)->sin6_port = htons(port);
+    }
+}
+
+AddressKey SocketAddress::getKey(bool with_port) const noexcept
+{
+    AddressKey key;
+    if (getFamily() == AF_INET) {
+        key.ip[10] = 0xff;
+        key.ip[11] = 0xff;
+        memcpy(&key.ip[12], &reinterpret_cast<const struct sockaddr_in*>(&m_addr)->sin_addr, 4);
+    }
+    else if (getFamily() == AF_INET6) {
+        memcpy(key.ip, &reinterpret_cast<const struct sockaddr_in6*>(&m_addr)->sin6_addr, 16);
+    }
+    if (with_port) {
+        key.port = getPort();
+    }
+    return key;
+}
+
+std::string SocketAddress::getUnixPath() const
+{
+    constexpr socklen_t path_offset = offsetof(struct sockaddr_un, sun_path);
+    if (false == isUnix() || m_len <= path_offset) {
+        return "";
+    }
+    auto addr = reinterpret_cast<const struct sockaddr_un*>(&m_addr);
+    if (addr->sun_path[0] == '\0') {
+        return "@" + std::string(addr->sun_path + 1, m_len - path_offset - 1);
+    }
+    return std::string(addr->sun_path, strnlen(addr->sun_path, m_len - path_offset));
+}
+
+std::string SocketAddress::toString() const
+{
+    if (isUnix()) {
+        return UNIX_PREFIX + getUnixPath();
+    }
+    if (isIPv6()) {
+        return "[" + getIP() + "]:" + std::to_string(getPort());
+    }
+    return getIP() + ":" + std::to_string(getPort());
+}
+
+void SocketAddress::unmapIPv4() noexcept
+{
+    if (false == isIPv6()) {
+        return;
+    }
+    auto addr6 = *reinterpret_cast<const struct sockaddr_in6*>(&m_addr);
+    if (false == IN6_IS_ADDR_V4MAPPED(&addr6.sin6_addr)) {
+        return;
+    }
+
+    struct sockaddr_in addr4{};
+    addr4.sin_family = AF_INET;
+    addr4.sin_port   = addr6.sin6_port;
+    memcpy(&addr4.sin_addr, &addr6.sin6_addr.s6_addr[12], sizeof(addr4.sin_addr));
+    m_addr = {};
+    memcpy(&m_addr, &addr4, sizeof(addr4));
+    m_len = sizeof(addr4);
+}
+
+}   // namespace JTCP
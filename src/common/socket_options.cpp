@@ -0,0 +1,142 @@
+#include "JTCP/common/socket_options.h"
+#include "JTCP/common/logger.h"
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+namespace JTCP {
+
+namespace {
+
+JResultWithErrMsg setIntOption(FileDescribe::FDType fd, int level, int name, int value,
+                               const char* name_str)
+{
+    if (setsockopt(fd, level, name, &value, sizeof(value)) < 0) {
+        JTCP_LOG_WARN("set %s=%d on fd %d failed: %s", name_str, value, fd, strerror(errno));
+        return JResultWithErrMsg::failure(std::string("set ") + name_str + " failed");
+    }
+    return JResultWithErrMsg::success();
+}
+
+JResultWithErrMsg applyBufferSize(const SocketOptions& options, FileDescribe::FDType fd)
+{
+    if (options.recv_buffer_size > 0) {
+        if (auto ret =
+                setIntOption(fd, SOL_SOCKET, SO_RCVBUF, options.recv_buffer_size, "SO_RCVBUF");
+            ret.isFailure()) {
+            return ret;
+        }
+    }
+    if (options.send_buffer_size > 0) {
+        if (auto ret =
+                setIntOption(fd, SOL_SOCKET, SO_SNDBUF, options.send_buffer_size, "SO_SNDBUF");
+            ret.isFailure()) {
+            return ret;
+        }
+    }
+    return JResultWithErrMsg::success();
+}
+
+}   // namespace
+
+SocketOptions SocketOptions::lowLatency() noexcept
+{
+    SocketOptions options;
+    options.tcp_nodelay = true;
+    options.quick_ack   = true;
+    return options;
+}
+
+SocketOptions SocketOptions::bulkThroughput() noexcept
+{
+    SocketOptions options;
+    options.recv_buffer_size = 4 * 1024 * 1024;
+    options.send_buffer_size = 4 * 1024 * 1024;
+    return options;
+}
+
+JResultWithErrMsg SocketOptions::applyListen(FileDescribe::FDType fd, int family) const
+{
+    // Unix域套接字的地址复用由删除套接字文件处理
+    if (reuse_addr && family != AF_UNIX) {
+        if (auto ret = setIntOption(fd, SOL_SOCKET, SO_REUSEADDR, 1, "SO_REUSEADDR");
+            ret.isFailure()) {
+            return ret;
+        }
+    }
+    if (family != AF_UNIX && defer_accept > 0) {
+        if (auto ret =
+                setIntOption(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, defer_accept, "TCP_DEFER_ACCEPT");
+            ret.isFailure()) {
+            return ret;
+        }
+    }
+    if (family != AF_UNIX && fast_open_queue > 0) {
+        if (auto ret = setIntOption(fd, IPPROTO_TCP, TCP_FASTOPEN, fast_open_queue, "TCP_FASTOPEN");
+            ret.isFailure()) {
+            return ret;
+        }
+    }
+    return applyBufferSize(*this, fd);
+}
+
+JResultWithErrMsg SocketOptions::apply(FileDescribe::FDType fd, int family) const
+{
+    if (auto ret = applyBufferSize(*this, fd); ret.isFailure()) {
+        return ret;
+    }
+    if (family == AF_UNIX) {
+        return JResultWithErrMsg::success();
+    }
+
+    if (tcp_nodelay) {
+        if (auto ret = setIntOption(fd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+            ret.isFailure()) {
+            return ret;
+        }
+    }
+    if (quick_ack) {
+        if (auto ret = setIntOption(fd, IPPROTO_TCP, TCP_QUICKACK, 1, "TCP_QUICKACK");
+            ret.isFailure()) {
+            return ret;
+        }
+    }
+    // connect立即返回，握手推迟到首次发送，请求数据随SYN发出
+    if (fast_open_connect) {
+        if (auto ret =
+                setIntOption(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1, "TCP_FASTOPEN_CONNECT");
+            ret.isFailure()) {
+            return ret;
+        }
+    }
+    if (false == keep_alive) {
+        return JResultWithErrMsg::success();
+    }
+    if (auto ret = setIntOption(fd, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE"); ret.isFailure()) {
+        return ret;
+    }
+    if (keep_alive_idle > 0) {
+        if (auto ret = setIntOption(fd, IPPROTO_TCP, TCP_KEEPIDLE, keep_alive_idle, "TCP_KEEPIDLE");
+            ret.isFailure()) {
+            return ret;
+        }
+    }
+    if (keep_alive_interval > 0) {
+        if (auto ret =
+                setIntOption(fd, IPPROTO_TCP, TCP_KEEPINTVL, keep_alive_interval, "TCP_KEEPINTVL");
+            ret.isFailure()) {
+            return ret;
+        }
+    }
+    if (keep_alive_count > 0) {
+        if (auto ret = setIntOption(fd, IPPROTO_TCP, TCP_KEEPCNT, keep_alive_count, "TCP_KEEPCNT");
+            ret.isFailure()) {
+            return ret;
+        }
+    }
+    return JResultWithErrMsg::success();
+}
+
+}   // namespace JTCP
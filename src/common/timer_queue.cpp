@@ -0,0 +1,33 @@
+#include "JTCP/common/timer_queue.h"
+#include <algorithm>
+
+namespace JTCP {
+
+void TimerQueue::addTimer(const ClockType::time_point& deadline, CallbackType cb)
+{
+    m_timers.push(Timer{deadline, m_next_seq++, std::move(cb)});
+}
+
+int TimerQueue::getWaitTime(const ClockType::time_point& now, int max_wait_ms) const
+{
+    if (m_timers.empty()) {
+        return max_wait_ms;
+    }
+    auto wait = std::chrono::ceil<std::chrono::milliseconds>(m_timers.top().deadline - now).count();
+    return static_cast<int>(std::clamp<int64_t>(wait, 0, max_wait_ms));
+}
+
+size_t TimerQueue::runExpired(const ClockType::time_point& now)
+{
+    size_t run_num = 0;
+    while (false == m_timers.empty() && m_timers.top().deadline <= now) {
+        // 先出队再执行，回调中添加的定时器不会使当前迭代失效
+        auto cb = std::move(const_cast<Timer&>(m_timers.top()).cb);
+        m_timers.pop();
+        cb();
+        ++run_num;
+    }
+    return run_num;
+}
+
+}   // namespace JTCP
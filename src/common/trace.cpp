@@ -0,0 +1,227 @@
+#include "JTCP/common/trace.h"
+
+#ifdef JTCP_ENABLE_TRACE
+#    include <algorithm>
+#    include <array>
+#    include <atomic>
+#    include <chrono>
+#    include <cstdio>
+#    include <cstring>
+#    include <deque>
+#    include <memory>
+#    include <mutex>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#    include <vector>
+#endif
+
+namespace JTCP::Trace {
+
+#ifdef JTCP_ENABLE_TRACE
+
+namespace {
+
+/**
+ * @brief 单线程写入、任意线程读取的覆盖式环形缓冲区
+ *
+ */
+class TraceRing
+{
+public:
+    static constexpr uint64_t CAPACITY = JTCP_TRACE_RING_CAPACITY;
+    static constexpr uint64_t MASK     = CAPACITY - 1;
+
+    TraceRing()
+        : m_thread_id(static_cast<uint64_t>(syscall(SYS_gettid)))
+    {}
+
+    /**
+     * @brief 交给新线程使用，此前的记录不再被dump
+     *
+     */
+    void reuse() noexcept
+    {
+        m_thread_id.store(static_cast<uint64_t>(syscall(SYS_gettid)), std::memory_order_relaxed);
+        m_start.store(m_head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    void push(const TraceRecord& record) noexcept
+    {
+        uint64_t pos          = m_head.load(std::memory_order_relaxed);
+        m_records[pos & MASK] = record;
+        m_head.store(pos + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief 拷贝当前仍然有效的记录
+     *
+     * 拷贝完成后再读一次写位置，拷贝期间可能已被写线程覆盖的记录全部丢弃
+     *
+     * @param start 当前使用者的第一条记录的位置
+     */
+    std::vector<TraceRecord> copy(uint64_t start) const
+    {
+        uint64_t head  = m_head.load(std::memory_order_acquire);
+        uint64_t begin = std::max(start, head > CAPACITY ? head - CAPACITY : 0);
+
+        std::vector<TraceRecord> result;
+        result.reserve(head - begin);
+        for (uint64_t i = begin; i < head; ++i) {
+            result.push_back(m_records[i & MASK]);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t new_head = m_head.load(std::memory_order_relaxed);
+        // 写线程正在写new_head所在的槽位，它覆盖的是new_head - CAPACITY
+        uint64_t valid_begin = new_head >= CAPACITY ? new_head - CAPACITY + 1 : 0;
+        if (valid_begin > begin) {
+            uint64_t drop = std::min<uint64_t>(valid_begin - begin, result.size());
+            result.erase(result.begin(), result.begin() + drop);
+        }
+        return result;
+    }
+
+    uint64_t getThreadID() const noexcept { return m_thread_id.load(std::memory_order_relaxed); }
+    uint64_t getStart() const noexcept { return m_start.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t>                         m_thread_id{0};
+    std::atomic<uint64_t>                         m_start{0};
+    alignas(64) std::atomic<uint64_t>             m_head{0};
+    alignas(64) std::array<TraceRecord, CAPACITY> m_records;
+};
+
+/**
+ * @brief 所有线程环形缓冲区的登记表，只在线程首次记录、线程退出和dump时加锁
+ *
+ */
+struct Registry
+{
+    std::mutex                              mutex;
+    std::vector<std::shared_ptr<TraceRing>> rings;     ///< 所有缓冲区
+    std::deque<std::shared_ptr<TraceRing>>  retired;   ///< 线程已退出的缓冲区，先退出的在前
+};
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+/**
+ * @brief 线程持有的缓冲区，线程退出时交还登记表
+ *
+ * 最近退出的JTCP_TRACE_RETIRED_RINGS个线程的记录仍可被dump。缓冲区总数不超过同时记录的
+ * 线程数加上保留的数量，线程池或短命线程不会使内存持续增长。
+ */
+struct LocalRing
+{
+    LocalRing()
+    {
+        auto&                       reg = registry();
+        std::lock_guard<std::mutex> lock_guard(reg.mutex);
+        if (reg.retired.size() < JTCP_TRACE_RETIRED_RINGS) {
+            ring = std::make_shared<TraceRing>();
+            reg.rings.push_back(ring);
+            return;
+        }
+        // 接手最早退出的线程的缓冲区，最近退出的线程的记录仍然保留
+        ring = std::move(reg.retired.front());
+        reg.retired.pop_front();
+        ring->reuse();
+    }
+
+    ~LocalRing()
+    {
+        auto&                       reg = registry();
+        std::lock_guard<std::mutex> lock_guard(reg.mutex);
+        reg.retired.push_back(std::move(ring));
+    }
+
+    std::shared_ptr<TraceRing> ring;
+};
+
+TraceRing& localRing()
+{
+    thread_local LocalRing local_ring;
+    return *local_ring.ring;
+}
+
+}   // namespace
+
+void record(EventType type, int32_t fd, int64_t value, uint64_t aux) noexcept
+{
+    TraceRecord record;
+    record.timestamp_ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+    record.value    = value;
+    record.aux      = aux;
+    record.fd       = fd;
+    record.type     = static_cast<uint16_t>(type);
+    record.reserved = 0;
+    localRing().push(record);
+}
+
+JResultWithErrMsg dump(const std::string& path)
+{
+    // 线程ID与起始位置在登记表锁内读取，与缓冲区被新线程接手互斥
+    struct RingSnapshot
+    {
+        std::shared_ptr<TraceRing> ring;
+        uint64_t                   thread_id;
+        uint64_t                   start;
+    };
+    std::vector<RingSnapshot> rings;
+    {
+        auto&                       reg = registry();
+        std::lock_guard<std::mutex> lock_guard(reg.mutex);
+        for (auto& ring : reg.rings) {
+            rings.push_back(RingSnapshot{ring, ring->getThreadID(), ring->getStart()});
+        }
+    }
+
+    std::unique_ptr<FILE, decltype(&fclose)> file(fopen(path.c_str(), "wb"), &fclose);
+    if (nullptr == file) {
+        return JResultWithErrMsg::failure("open trace file failed: " + path);
+    }
+
+    FileHeader file_header;
+    memset(&file_header, 0, sizeof(file_header));
+    memcpy(file_header.magic, "JTCPTRC", 8);
+    file_header.version      = 1;
+    file_header.record_size  = sizeof(TraceRecord);
+    file_header.thread_count = static_cast<uint32_t>(rings.size());
+    if (fwrite(&file_header, sizeof(file_header), 1, file.get()) != 1) {
+        return JResultWithErrMsg::failure("write trace file failed");
+    }
+
+    for (auto& snapshot : rings) {
+        auto         records = snapshot.ring->copy(snapshot.start);
+        ThreadHeader thread_header{snapshot.thread_id, records.size()};
+        if (fwrite(&thread_header, sizeof(thread_header), 1, file.get()) != 1) {
+            return JResultWithErrMsg::failure("write trace file failed");
+        }
+        if (false == records.empty() &&
+            fwrite(records.data(), sizeof(TraceRecord), records.size(), file.get()) !=
+                records.size()) {
+            return JResultWithErrMsg::failure("write trace file failed");
+        }
+    }
+
+    return JResultWithErrMsg::success();
+}
+
+#else
+
+void record(EventType, int32_t, int64_t, uint64_t) noexcept {}
+
+JResultWithErrMsg dump(const std::string&)
+{
+    return JResultWithErrMsg::failure("trace is disabled, rebuild with JTCP_ENABLE_TRACE=ON");
+}
+
+#endif
+
+}   // namespace JTCP::Trace
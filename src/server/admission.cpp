@@ -0,0 +1,139 @@
+#include "JTCP/server/admission.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace JTCP::Server {
+
+namespace {
+
+/// 两行计数表各自的哈希种子
+constexpr uint64_t IP_ROW_SEED0 = 0x243F6A8885A308D3ULL;
+constexpr uint64_t IP_ROW_SEED1 = 0x13198A2E03707344ULL;
+
+/**
+ * @brief murmur3的64位终结函数，输入的每一位都会影响输出的所有位
+ *
+ */
+uint64_t mix64(uint64_t value) noexcept
+{
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDULL;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+/**
+ * @brief 以指定种子哈希16字节的IP
+ *
+ * AddressKeyHash只为unordered_map设计，IPv4映射地址的高8字节恒定，低位几乎只由前两个字节决定，
+ * 不能直接取位作为计数表的槽位。
+ */
+uint64_t hashIP(const AddressKey& key, uint64_t seed) noexcept
+{
+    uint64_t high{0};
+    uint64_t low{0};
+    memcpy(&high, key.ip, sizeof(high));
+    memcpy(&low, key.ip + sizeof(high), sizeof(low));
+    return mix64(mix64(high ^ seed) ^ low);
+}
+
+}   // namespace
+
+AdmissionControl::AdmissionControl()
+    : m_ip_counts(new std::atomic<uint32_t>[IP_TABLE_SIZE * 2])
+{
+    reset(AdmissionOptions{});
+}
+
+void AdmissionControl::reset(const AdmissionOptions& options) noexcept
+{
+    m_options = options;
+    m_enabled = options.max_connections > 0 || options.max_connections_per_ip > 0 ||
+                options.accept_rate > 0;
+
+    m_connection_num = 0;
+    m_next_accept_ns = 0;
+    if (options.accept_rate > 0) {
+        uint32_t burst = options.accept_burst > 0 ? options.accept_burst : options.accept_rate;
+        m_accept_interval_ns = 1000000000LL / options.accept_rate;
+        m_burst_ns           = m_accept_interval_ns * (burst - 1);
+    }
+    for (size_t i = 0; i < IP_TABLE_SIZE * 2; ++i) {
+        m_ip_counts[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+AdmitResult AdmissionControl::admit(const SocketAddress& addr) noexcept
+{
+    auto connection_num = m_connection_num.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (m_options.max_connections > 0 && connection_num > m_options.max_connections) {
+        m_connection_num.fetch_sub(1, std::memory_order_relaxed);
+        return AdmitResult::TOO_MANY_CONNECTIONS;
+    }
+
+    if (m_options.max_connections_per_ip > 0 && false == addr.isUnix()) {
+        size_t slot0 = 0;
+        size_t slot1 = 0;
+        getIPSlots(addr, slot0, slot1);
+        auto count0 = m_ip_counts[slot0].fetch_add(1, std::memory_order_relaxed) + 1;
+        auto count1 = m_ip_counts[slot1].fetch_add(1, std::memory_order_relaxed) + 1;
+        if (std::min(count0, count1) > m_options.max_connections_per_ip) {
+            m_ip_counts[slot0].fetch_sub(1, std::memory_order_relaxed);
+            m_ip_counts[slot1].fetch_sub(1, std::memory_order_relaxed);
+            m_connection_num.fetch_sub(1, std::memory_order_relaxed);
+            return AdmitResult::TOO_MANY_FROM_IP;
+        }
+    }
+
+    // 最后申请速率令牌，因连接数超限被拒绝的连接不消耗令牌
+    if (m_options.accept_rate > 0 && false == acquireRate()) {
+        release(addr);
+        return AdmitResult::RATE_LIMITED;
+    }
+    return AdmitResult::ADMITTED;
+}
+
+void AdmissionControl::release(const SocketAddress& addr) noexcept
+{
+    m_connection_num.fetch_sub(1, std::memory_order_relaxed);
+    if (m_options.max_connections_per_ip > 0 && false == addr.isUnix()) {
+        size_t slot0 = 0;
+        size_t slot1 = 0;
+        getIPSlots(addr, slot0, slot1);
+        m_ip_counts[slot0].fetch_sub(1, std::memory_order_relaxed);
+        m_ip_counts[slot1].fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+bool AdmissionControl::acquireRate() noexcept
+{
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count();
+    // 理论到达时间超前当前时间不超过突发额度时放行，并向后推进一个间隔
+    int64_t next_accept = m_next_accept_ns.load(std::memory_order_relaxed);
+    while (true) {
+        int64_t base = std::max(next_accept, now);
+        if (base - now > m_burst_ns) {
+            return false;
+        }
+        if (m_next_accept_ns.compare_exchange_weak(
+                next_accept, base + m_accept_interval_ns, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+void AdmissionControl::getIPSlots(const SocketAddress& addr, size_t& slot0,
+                                  size_t& slot1) const noexcept
+{
+    // 两行使用不同种子的哈希，两个IP在两行中同时冲突的概率约为1/IP_TABLE_SIZE^2
+    auto key = addr.getKey(false);
+    slot0    = hashIP(key, IP_ROW_SEED0) & (IP_TABLE_SIZE - 1);
+    slot1    = IP_TABLE_SIZE + (hashIP(key, IP_ROW_SEED1) & (IP_TABLE_SIZE - 1));
+}
+
+}   // namespace JTCP::Server
@@ -0,0 +1,359 @@
+#include "JTCP/server/coroutine.h"
+
+#ifdef JTCP_ENABLE_COROUTINE
+
+#include "JTCP/common/logger.h"
+#include <cerrno>
+#include <cstring>
+#include <endian.h>
+#include <new>
+
+namespace JTCP::Server {
+
+namespace {
+
+/**
+ * @brief 空闲块链表，块的头部存放下一块的地址
+ *
+ */
+struct FreeList
+{
+    void*  head{nullptr};   ///< 第一个空闲块
+    size_t num{0};          ///< 空闲块数量
+};
+
+struct FramePoolCache
+{
+    FreeList lists[CoroutineFramePool::CLASS_NUM];
+
+    ~FramePoolCache()
+    {
+        for (auto& list : lists) {
+            while (nullptr != list.head) {
+                void* next = *static_cast<void**>(list.head);
+                ::operator delete(list.head);
+                list.head = next;
+            }
+        }
+    }
+};
+
+thread_local FramePoolCache g_frame_pool_cache;
+
+size_t getClassIndex(size_t size) noexcept
+{
+    return (size + CoroutineFramePool::CLASS_SIZE - 1) / CoroutineFramePool::CLASS_SIZE - 1;
+}
+
+uint32_t decodeFrameLen(const char* header) noexcept
+{
+    uint32_t net_len{0};
+    memcpy(&net_len, header, sizeof(net_len));
+    return be32toh(net_len);
+}
+
+}   // namespace
+
+void* CoroutineFramePool::allocate(size_t size)
+{
+    auto index = getClassIndex(size);
+    if (index >= CLASS_NUM) {
+        return ::operator new(size);
+    }
+    auto& list = g_frame_pool_cache.lists[index];
+    if (nullptr == list.head) {
+        return ::operator new((index + 1) * CLASS_SIZE);
+    }
+    void* block = list.head;
+    list.head   = *static_cast<void**>(block);
+    --list.num;
+    return block;
+}
+
+void CoroutineFramePool::deallocate(void* ptr, size_t size) noexcept
+{
+    auto index = getClassIndex(size);
+    if (index >= CLASS_NUM || g_frame_pool_cache.lists[index].num >= MAX_FREE_BLOCK) {
+        ::operator delete(ptr);
+        return;
+    }
+    // 连接对象可能在其他线程上释放，块进入释放线程的链表，分级只取决于大小，仍可复用
+    auto& list                = g_frame_pool_cache.lists[index];
+    *static_cast<void**>(ptr) = list.head;
+    list.head                 = ptr;
+    ++list.num;
+}
+
+CoTask& CoTask::operator=(CoTask&& other) noexcept
+{
+    if (this != &other) {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+        m_handle       = other.m_handle;
+        other.m_handle = nullptr;
+    }
+    return *this;
+}
+
+CoTask::~CoTask()
+{
+    if (m_handle) {
+        m_handle.destroy();
+    }
+}
+
+std::exception_ptr CoTask::getException() const noexcept
+{
+    return m_handle ? m_handle.promise().m_exception : nullptr;
+}
+
+void CoConnection::spawn(const TCPPeerClientPtr& peer_client, HandlerType handler)
+{
+    // 连接对象持有回调，回调持有本对象；本对象只保存连接的裸指针，不形成循环引用
+    auto conn       = std::make_shared<CoConnection>(peer_client.get());
+    conn->m_handler = std::move(handler);
+    peer_client->setOnRecvDataCB([conn](TCPPeerClient*) { conn->onReadable(); });
+    peer_client->setOnWritableCB([conn](TCPPeerClient*) { conn->onWritable(); });
+    peer_client->setOnDisconnectCB([conn](TCPPeerClient*) { conn->onDisconnect(); });
+
+    conn->m_in_callback = true;
+    conn->m_task        = conn->m_handler(*conn);
+    conn->m_in_callback = false;
+    conn->resume();
+}
+
+CoConnection::ReadExactAwaiter CoConnection::readExact(char* data, size_t len) noexcept
+{
+    return ReadExactAwaiter(*this, data, len);
+}
+
+CoConnection::ReadFrameAwaiter CoConnection::readFrame(std::string& payload,
+                                                       size_t       max_len) noexcept
+{
+    return ReadFrameAwaiter(*this, payload, max_len);
+}
+
+CoConnection::WriteAwaiter CoConnection::write(const char* data, size_t len)
+{
+    m_send_buff.append(data, len);
+    return WriteAwaiter(*this);
+}
+
+CoConnection::WriteAwaiter CoConnection::writeFrame(const char* data, size_t len)
+{
+    uint32_t net_len = htobe32(static_cast<uint32_t>(len));
+    m_send_buff.append(reinterpret_cast<const char*>(&net_len), sizeof(net_len));
+    m_send_buff.append(data, len);
+    return WriteAwaiter(*this);
+}
+
+void CoConnection::onReadable()
+{
+    // 读到EAGAIN、读取配额用完、连接断开或达到高水位为止，配额用完时reactor会在下一轮再次调用
+    m_in_callback = true;
+    while (false == m_closed) {
+        if (shouldPauseRead()) {
+            m_read_paused = true;
+            break;
+        }
+        m_recv_buff.ensureWritable(4096);
+        auto ret = m_peer_client->readData(m_recv_buff.beginWrite(), m_recv_buff.writableBytes());
+        if (ret.isFailure()) {
+            break;
+        }
+        m_recv_buff.hasWritten(*(ret.getSuccessPtr()));
+    }
+    m_in_callback = false;
+    resume();
+}
+
+void CoConnection::onWritable()
+{
+    m_in_callback = true;
+    if (false == flush() || m_send_buff.empty()) {
+        m_peer_client->watchWritable(false);
+    }
+    m_in_callback = false;
+    resume();
+}
+
+void CoConnection::onDisconnect()
+{
+    m_closed = true;
+    // 在数据或可写回调中断开时，由回调结束时统一恢复
+    if (false == m_in_callback) {
+        resume();
+    }
+}
+
+bool CoConnection::flush()
+{
+    while (false == m_send_buff.empty() && false == m_write_failed) {
+        auto ret = m_peer_client->sendData(m_send_buff.peek(), m_send_buff.readableBytes());
+        if (ret.isFailure()) {
+            // 发送缓冲区已满，等待可写事件
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            m_write_failed = true;
+            return false;
+        }
+        m_send_buff.retrieve(*(ret.getSuccessPtr()));
+    }
+    return false == m_write_failed;
+}
+
+bool CoConnection::shouldPauseRead() const noexcept
+{
+    if (m_recv_buff.readableBytes() < RECV_HIGH_WATER) {
+        return false;
+    }
+    // 等待的数据尚未读全时继续读取，readExact与readFrame的长度都已受限
+    bool wait_read = WaitType::READ == m_wait_type || WaitType::FRAME == m_wait_type;
+    return false == wait_read || readReady(m_wait_type, m_wait_len);
+}
+
+bool CoConnection::readReady(WaitType wait_type, size_t wait_len) const noexcept
+{
+    auto readable = m_recv_buff.readableBytes();
+    if (WaitType::READ == wait_type) {
+        return readable >= wait_len;
+    }
+    if (readable < FRAME_HEADER_LEN) {
+        return false;
+    }
+    // 非法的帧长度也立即恢复，由协程得到失败结果
+    size_t payload_len = decodeFrameLen(m_recv_buff.peek());
+    return payload_len > wait_len || readable >= FRAME_HEADER_LEN + payload_len;
+}
+
+void CoConnection::resume()
+{
+    while (nullptr != m_waiting) {
+        bool ready = m_closed;
+        switch (m_wait_type) {
+        case WaitType::READ:
+        case WaitType::FRAME: ready = ready || readReady(m_wait_type, m_wait_len); break;
+        case WaitType::WRITE: ready = ready || m_write_failed || m_send_buff.empty(); break;
+        case WaitType::NONE: ready = true; break;
+        }
+        if (false == ready) {
+            break;
+        }
+        auto handle = m_waiting;
+        m_waiting   = nullptr;
+        m_wait_type = WaitType::NONE;
+        // 协程中可能再次co_await并挂起，循环检查新的等待条件
+        m_in_callback = true;
+        handle.resume();
+        m_in_callback = false;
+    }
+
+    // 协程取走数据后恢复读取，边缘触发不会再次报告暂停期间留在内核中的数据
+    if (m_read_paused && false == m_closed && false == shouldPauseRead()) {
+        m_read_paused = false;
+        m_peer_client->requestRead();
+    }
+
+    if (false == m_task.done()) {
+        return;
+    }
+    if (auto exception = m_task.getException()) {
+        try {
+            std::rethrow_exception(exception);
+        }
+        catch (const std::exception& e) {
+            JTCP_LOG_WARN("coroutine handler threw: %s", e.what());
+        }
+        catch (...) {
+            JTCP_LOG_WARN("coroutine handler threw an unknown exception");
+        }
+    }
+    // 协程已结束，连接不再有人处理。断开回调同步执行，标记为回调中，避免重入resume再次报告异常
+    if (false == m_closed) {
+        m_closed         = true;
+        bool in_callback = m_in_callback;
+        m_in_callback    = true;
+        m_peer_client->disconnect();
+        m_in_callback = in_callback;
+    }
+}
+
+bool CoConnection::ReadExactAwaiter::await_ready() const noexcept
+{
+    return m_conn.m_closed || m_conn.readReady(WaitType::READ, m_len);
+}
+
+void CoConnection::ReadExactAwaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+    m_conn.m_waiting   = handle;
+    m_conn.m_wait_type = WaitType::READ;
+    m_conn.m_wait_len  = m_len;
+}
+
+JResultWithErrMsg CoConnection::ReadExactAwaiter::await_resume() noexcept
+{
+    // 连接已断开但之前收到的数据足够时仍然成功
+    if (m_conn.m_recv_buff.readableBytes() < m_len) {
+        return JResultWithErrMsg::failure("connection closed");
+    }
+    memcpy(m_data, m_conn.m_recv_buff.peek(), m_len);
+    m_conn.m_recv_buff.retrieve(m_len);
+    return JResultWithErrMsg::success();
+}
+
+bool CoConnection::ReadFrameAwaiter::await_ready() const noexcept
+{
+    return m_conn.m_closed || m_conn.readReady(WaitType::FRAME, m_max_len);
+}
+
+void CoConnection::ReadFrameAwaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+    m_conn.m_waiting   = handle;
+    m_conn.m_wait_type = WaitType::FRAME;
+    m_conn.m_wait_len  = m_max_len;
+}
+
+JResultWithErrMsg CoConnection::ReadFrameAwaiter::await_resume()
+{
+    auto& buff = m_conn.m_recv_buff;
+    if (buff.readableBytes() < FRAME_HEADER_LEN) {
+        return JResultWithErrMsg::failure("connection closed");
+    }
+    size_t payload_len = decodeFrameLen(buff.peek());
+    if (payload_len > m_max_len) {
+        return JResultWithErrMsg::failure("invalid frame length");
+    }
+    if (buff.readableBytes() < FRAME_HEADER_LEN + payload_len) {
+        return JResultWithErrMsg::failure("connection closed");
+    }
+    m_payload.assign(buff.peek() + FRAME_HEADER_LEN, payload_len);
+    buff.retrieve(FRAME_HEADER_LEN + payload_len);
+    return JResultWithErrMsg::success();
+}
+
+bool CoConnection::WriteAwaiter::await_ready() noexcept
+{
+    // 大多数情况下一次send即可发完，不挂起
+    return m_conn.m_closed || false == m_conn.flush() || m_conn.m_send_buff.empty();
+}
+
+void CoConnection::WriteAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    m_conn.m_waiting   = handle;
+    m_conn.m_wait_type = WaitType::WRITE;
+    m_conn.m_peer_client->watchWritable(true);
+}
+
+JResultWithErrMsg CoConnection::WriteAwaiter::await_resume() noexcept
+{
+    if (m_conn.m_write_failed || false == m_conn.m_send_buff.empty()) {
+        return JResultWithErrMsg::failure("failed to send data");
+    }
+    return JResultWithErrMsg::success();
+}
+
+}   // namespace JTCP::Server
+
+#endif
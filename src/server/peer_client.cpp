@@ -1,19 +1,29 @@
 #include "JTCP/server/peer_client.h"
+#include "JTCP/common/logger.h"
+#include "JTCP/common/trace.h"
+#include "JTCP/server/reactor.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 
 namespace JTCP::Server {
 
-struct sockaddr_in* TCPPeerClient::getSockAddr()
+void TCPPeerClient::setPeerAddress(const SocketAddress& addr) noexcept
 {
-    return &m_sock_addr;
+    m_sock_addr   = addr;
+    m_peer_key    = addr.getKey();
+    m_peer_ip_len = static_cast<uint8_t>(strlen(addr.getIP(m_peer_ip, sizeof(m_peer_ip))));
 }
 
-Types::IPStrVType TCPPeerClient::getPeerIP() const
+PeerClientStats TCPPeerClient::getStats() const noexcept
 {
-    return inet_ntoa(m_sock_addr.sin_addr);
-}
-const Types::PortType TCPPeerClient::getPeerPort() const
-{
-    return ntohs(m_sock_addr.sin_port);
+    PeerClientStats stats;
+    stats.bytes_in              = m_bytes_in.load(std::memory_order_relaxed);
+    stats.messages              = m_messages.load(std::memory_order_relaxed);
+    stats.throttled             = m_throttled.load(std::memory_order_relaxed);
+    stats.throttle_count        = m_throttle_count.load(std::memory_order_relaxed);
+    stats.throttled_duration_ns = m_throttled_ns.load(std::memory_order_relaxed);
+    return stats;
 }
 
 void TCPPeerClient::setFileDescribe(FileDescribePtr fd) noexcept
@@ -43,29 +53,107 @@ void TCPPeerClient::onDisconnect()
     m_on_disconnect_cb(this);
 }
 
+void TCPPeerClient::setOnWritableCB(OnWritableCBType cb)
+{
+    m_on_writable_cb = cb;
+}
+void TCPPeerClient::onWritable()
+{
+    m_on_writable_cb(this);
+}
+
+void TCPPeerClient::watchWritable(bool enable)
+{
+    if (m_want_write == enable) {
+        return;
+    }
+    m_want_write = enable;
+    m_reactor->updateClientEvents(this);
+}
+
+void TCPPeerClient::requestRead()
+{
+    m_reactor->requeueClient(this);
+}
+
+JResultWithErrMsg TCPPeerClient::disconnect()
+{
+    // 用户可能仍持有连接对象，fd不会立即关闭，先关闭两个方向使对端及时得知
+    shutdown(m_fd->getFD(), SHUT_RDWR);
+    return m_reactor->delClient(this, -1);
+}
+
 JResultWithSuccErrMsg<std::size_t> TCPPeerClient::sendData(const char* data, size_t len)
 {
-    auto sended_length = send(m_fd->getFD(), data, len, 0);
+    auto& metrics = m_reactor->m_metrics;
+    metrics.send_calls.add();
+
+    // 对端已关闭时send返回EPIPE，不能产生SIGPIPE终止整个进程
+    auto sended_length = send(m_fd->getFD(), data, len, MSG_NOSIGNAL);
+    JTCP_TRACE(SEND, m_fd->getFD(), sended_length < 0 ? -errno : sended_length, len);
     if (sended_length < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            metrics.send_eagains.add();
+        }
+        else {
+            JTCP_LOG_WARN("send to client %d failed: %s", m_fd->getFD(), strerror(errno));
+        }
         return JResultWithSuccErrMsg<std::size_t>::failure("failed to send data");
     }
 
+    metrics.bytes_out.add(sended_length);
+    if (static_cast<size_t>(sended_length) < len) {
+        metrics.send_partials.add();
+        JTCP_TRACE(SEND_PARTIAL, m_fd->getFD(), sended_length, len);
+    }
     return JResultWithSuccErrMsg<std::size_t>::success(sended_length);
 }
 
 JResultWithSuccErrMsg<std::size_t> TCPPeerClient::readData(char* data, const size_t&  expect_len)
 {
-    ssize_t ret = read(m_fd->getFD(), data, expect_len);
+    auto& metrics = m_reactor->m_metrics;
+    if (m_peer_drained.load(std::memory_order_relaxed)) {
+        return JResultWithSuccErrMsg<std::size_t>::failure("peer closed the connection");
+    }
+    if (0 == m_read_budget) {
+        metrics.read_budget_hits.add();
+        m_budget_exhausted = true;
+        return JResultWithSuccErrMsg<std::size_t>::failure("read budget exhausted");
+    }
+    metrics.read_calls.add();
+
+    // 不超过剩余配额，使一个连接每轮读取的数据量不超过read_budget
+    size_t  read_len = std::min(expect_len, m_read_budget);
+    ssize_t ret      = read(m_fd->getFD(), data, read_len);
+    while (-1 == ret && errno == EINTR) {
+        ret = read(m_fd->getFD(), data, read_len);
+    }
+    // 日志和追踪可能覆盖errno，先保存read的错误码
+    int error = -1 == ret ? errno : 0;
+    JTCP_TRACE(READ, m_fd->getFD(), -1 == ret ? -error : ret, read_len);
+    // 非阻塞套接字上暂时没有数据，连接仍然有效，不能当作断开处理
+    if (-1 == ret && (error == EAGAIN || error == EWOULDBLOCK)) {
+        metrics.read_eagains.add();
+        return JResultWithSuccErrMsg<std::size_t>::failure("no data available now");
+    }
     // 当返回值异常或退出时，都通知删除该客户端
     if (-1 == ret) {
-        m_server->delClient(m_fd->getFD());
+        JTCP_LOG_WARN("read from client %d failed: %s", m_fd->getFD(), strerror(error));
+        m_reactor->delClient(this, error);
         return JResultWithSuccErrMsg<std::size_t>::failure("read failed");
     }
     else if (0 == ret) {
         return JResultWithSuccErrMsg<std::size_t>::failure(
-            m_server->delClient(m_fd->getFD()).getFailurePtr());
+            m_reactor->delClient(this).getFailurePtr());
     }
 
+    metrics.bytes_in.add(ret);
+    m_bytes_in.fetch_add(ret, std::memory_order_relaxed);
+    m_read_budget -= ret;
+    // 对端的FIN已经到达，之前发送的数据都已在缓冲区中，读不满说明已经读完
+    if (m_peer_closed.load(std::memory_order_relaxed) && static_cast<size_t>(ret) < read_len) {
+        m_peer_drained.store(true, std::memory_order_relaxed);
+    }
     return JResultWithSuccErrMsg<std::size_t>::success(ret);
 }
 }   // namespace JTCP::Server
\ No newline at end of file
@@ -0,0 +1,608 @@
+#include "JTCP/server/reactor.h"
+#include "JTCP/common/logger.h"
+#include "JTCP/common/trace.h"
+#include "JTCP/server/peer_client.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <vector>
+
+namespace JTCP::Server {
+
+TCPReactor::TCPReactor(TCPServer* server, size_t index, FileDescribePtr listen_fd)
+    : m_server(server)
+    , m_index(index)
+    , m_listen_fd(listen_fd)
+{}
+
+TCPReactor::~TCPReactor()
+{
+    if (m_epollfd >= 0) {
+        close(m_epollfd);
+    }
+}
+
+JResultWithErrMsg TCPReactor::run()
+{
+    // 先绑定CPU，之后本线程上的分配才会落在对应NUMA节点的内存上
+    m_server->applyCPUAffinity(m_index);
+
+    if (auto ret = initEpoll(); ret.isFailure()) {
+        return ret;
+    }
+
+    const auto& options = m_server->m_options;
+
+    // 事件数组从较小的长度开始，取满时翻倍，直到max_events_per_wakeup
+    size_t max_events = std::max<size_t>(options.max_events_per_wakeup, 1);
+
+    using ReadyNumType = int;
+    ReadyNumType             ready_event_num{0};                             ///< 触发的事件数量
+    std::vector<epoll_event> event_list(std::min<size_t>(64, max_events));   ///< 缓存的event列表
+
+    // 自旋窗口的截止时间，每处理完一批事件向后延长spin_duration
+    bool                  spin_enabled = options.spin_duration.count() > 0;
+    ClockType::time_point spin_until;
+
+    m_run_flag = true;
+    while (m_run_flag) {
+        // 有待重新调度的连接时不阻塞，取出已就绪的事件后立即继续处理；否则最多等到下一个定时器到期
+        auto now        = ClockType::now();
+        bool spinning   = spin_enabled && now < spin_until;
+        bool no_wait    = spinning || false == m_requeued.empty();
+        ready_event_num = epoll_wait(m_epollfd,
+                                     &*event_list.begin(),
+                                     static_cast<int>(event_list.size()),
+                                     no_wait ? 0 : m_timers.getWaitTime(now, 1000));   // 最长1秒
+        if (ready_event_num == -1) {
+            // 被信号打断不是错误，例如采样分析工具发出的信号
+            if (errno == EINTR) {
+                continue;
+            }
+            JTCP_LOG_ERROR("epoll_wait failed: %s", strerror(errno));
+            m_run_flag = false;
+            return JResultWithErrMsg::failure("epoll_wait failed");
+        }
+        if (false == m_timers.empty()) {
+            m_timers.runExpired(ClockType::now());
+        }
+        if (ready_event_num == 0 && m_requeued.empty()) {
+            if (spinning) {
+                m_metrics.epoll_spins.add();
+            }
+            else {   // 超时，继续等
+                m_metrics.epoll_timeouts.add();
+            }
+            continue;
+        }
+        auto wakeup_time = ClockType::now();
+        if (ready_event_num > 0) {
+            m_metrics.epoll_wakeups.add();
+            m_metrics.events.add(ready_event_num);
+            m_metrics.events_per_wakeup.record(ready_event_num);
+            JTCP_TRACE(EPOLL_WAKEUP, -1, ready_event_num, 0);
+        }
+
+        if ((size_t)ready_event_num == event_list.size())   // 对clients进行扩容
+        {
+            m_metrics.event_list_full.add();
+            if (event_list.size() < max_events) {
+                event_list.resize(std::min(event_list.size() * 2, max_events));
+            }
+        }
+
+        // 对每个事件进行处理
+        for (ReadyNumType i = 0; i < ready_event_num; i++) {
+            auto& event = event_list[i];
+            // 单个连接或一次accept的失败只影响它自己，不退出事件循环
+            if (event.data.u64 == makeHandle(m_listen_fd->getFD(), 0)) {
+                if (auto ret = handleNewClientConnect(wakeup_time); ret.isFailure()) {
+                    scheduleAcceptRetry();
+                }
+            }
+            else {
+                handleClientMsg(event, wakeup_time);
+            }
+        }
+        // 上一轮用完读取配额的连接排在本轮新事件之后
+        dispatchRequeued(wakeup_time);
+        // 本轮事件已全部处理，不会再有事件指向已断开的连接
+        reclaimRetired();
+
+        if (spin_enabled) {
+            spin_until = ClockType::now() + options.spin_duration;
+        }
+    }
+
+    // 服务停止，释放各个资源
+    {
+        std::lock_guard<std::mutex> lock_guard(m_client_mgr_mutex);
+        m_client_mgr.clear();
+        m_retired.clear();
+    }
+    return JResultWithErrMsg::success();
+}
+
+JResultWithErrMsg TCPReactor::initEpoll()
+{
+    // 创建一个 epoll 实例，并设置文件描述符为关闭执行时关闭
+    m_epollfd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollfd < 0) {
+        return JResultWithErrMsg::failure("epoll_create1 failed");
+    }
+#ifdef EPIOCSPARAMS
+    // 较新的内核与glibc支持按epoll实例开启忙轮询，不依赖全局的net.core.busy_poll
+    if (m_server->m_options.busy_poll_us > 0) {
+        struct epoll_params params {};
+        params.busy_poll_usecs  = m_server->m_options.busy_poll_us;
+        params.busy_poll_budget = 8;
+        params.prefer_busy_poll = 1;
+        if (ioctl(m_epollfd, EPIOCSPARAMS, &params) < 0) {
+            JTCP_LOG_WARN("set epoll busy poll params failed: %s", strerror(errno));
+        }
+    }
+#endif
+
+#ifdef EPOLLEXCLUSIVE
+    // Unix域套接字不支持SO_REUSEPORT，多个reactor共享同一个监听套接字，新连接只唤醒其中一个
+    if (m_server->m_options.reactor_num > 1) {
+        if (epollOprEvent(EPOLL_CTL_ADD, m_listen_fd->getFD(), EPOLLIN | EPOLLET | EPOLLEXCLUSIVE)
+                .isSuccess()) {
+            return JResultWithErrMsg::success();
+        }
+        JTCP_LOG_WARN("EPOLLEXCLUSIVE is not supported, fall back to shared wakeups");
+    }
+#endif
+    return epollOprEvent(EPOLL_CTL_ADD, m_listen_fd->getFD(), EPOLLIN | EPOLLET);
+}
+
+JResultWithErrMsg TCPReactor::epollOprEvent(EpollOprType opr, FileDescribe::FDType fd,
+                                            EpollEventType epoll_events, uint32_t generation)
+{
+    m_metrics.epoll_ctl_calls.add();
+    struct epoll_event event;
+    // 设置event为边缘触发模式，并关注读事件
+    event.events = epoll_events;
+    // 事件中保存连接句柄，fd被复用后仍能区分新旧连接
+    event.data.u64 = makeHandle(fd, generation);
+    // 将监听的fd添加到epoll中
+    if (epoll_ctl(m_epollfd, opr, fd, &event) < 0) {
+        // 如果添加失败，返回错误信息，构造错误信息后恢复errno供调用方使用
+        int  error = errno;
+        auto ret   = JResultWithErrMsg::failure(std::string("epoll_ctl when add event:") +
+                                              std::to_string(epoll_events) +
+                                              " for fd: " + std::to_string(fd) + " failed");
+        errno      = error;
+        return ret;
+    }
+
+    return JResultWithErrMsg::success();
+}
+
+JResultWithErrMsg TCPReactor::handleNewClientConnect(const ClockType::time_point& wakeup_time)
+{
+    // 开启TCP_DEFER_ACCEPT或TFO时，连接通常在首个请求到达后才被accept，直接读取，不必等下一次唤醒
+    const auto& socket_options = m_server->m_options.socket_options;
+    bool        read_on_accept =
+        socket_options.defer_accept > 0 || socket_options.fast_open_queue > 0;
+    auto& admission = m_server->m_admission;
+    auto& throttle  = m_server->m_options.throttle;
+
+    // 监听套接字是边缘触发的，一次唤醒必须accept到EAGAIN为止，否则同时到达的其余连接会滞留在队列中
+    while (true) {
+        // accept4直接得到非阻塞的fd，省去两次fcntl
+        SocketAddress        addr;
+        socklen_t            len = addr.getLength();
+        FileDescribe::FDType fd  = accept4(
+            m_listen_fd->getFD(), addr.getSockAddr(), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            // 多个reactor共享监听套接字时，连接可能已被其他reactor取走
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return JResultWithErrMsg::success();
+            }
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // 如fd耗尽（EMFILE），队列中的连接留待定时重试
+            m_metrics.accept_failures.add();
+            JTCP_TRACE(ACCEPT, -1, errno, 0);
+            JTCP_LOG_WARN("accept failed: %s", strerror(errno));
+            return JResultWithErrMsg::failure("accept failed");
+        }
+        addr.setLength(len);
+        addr.unmapIPv4();
+
+        // 超限的连接在分配任何对象之前关闭
+        if (admission.isEnabled()) {
+            if (auto result = admission.admit(addr); result != AdmitResult::ADMITTED) {
+                rejectConnection(fd, result);
+                continue;
+            }
+        }
+        m_metrics.accepts.add();
+        JTCP_TRACE(ACCEPT, fd, 0, 0);
+
+        // 新客户端连接，在本reactor线程上分配
+        auto conn        = std::make_shared<FileDescribe>(fd);
+        auto peer_client = std::make_shared<TCPPeerClient>(this);
+        peer_client->setPeerAddress(addr);
+        peer_client->setFileDescribe(conn);
+        // 代数0留给监听套接字
+        if (0 == ++m_generation) {
+            ++m_generation;
+        }
+        peer_client->m_generation = m_generation;
+        if (throttle.isEnabled()) {
+            auto now = ClockType::now();
+            peer_client->m_byte_bucket.reset(throttle.bytes_per_second, throttle.burst_bytes, now);
+            peer_client->m_message_bucket.reset(
+                throttle.messages_per_second, throttle.burst_messages, now);
+        }
+
+        m_server->applyBusyPoll(conn->getFD());
+        // 选项设置失败不影响连接的使用，只记录日志
+        m_server->m_options.socket_options.apply(conn->getFD(), addr.getFamily());
+
+        {
+            std::lock_guard<std::mutex> lock_guard(m_client_mgr_mutex);
+            m_client_mgr[conn->getFD()] = peer_client;
+        }
+        try {
+            m_server->m_on_new_client_cb(peer_client);
+        }
+        catch (const std::exception& e) {
+            JTCP_LOG_WARN("new client callback of client %d threw: %s", fd, e.what());
+            m_metrics.callback_failures.add();
+            delClient(peer_client.get(), ECONNABORTED);
+            continue;
+        }
+
+        // 首个请求通常已经到达，先读取再注册：回调中就断开的短连接不必调用epoll_ctl。
+        // EPOLL_CTL_ADD时若缓冲区中仍有数据，epoll会立即报告，不会丢失边缘触发的事件
+        if (read_on_accept) {
+            dispatchRecvData(peer_client, fd, wakeup_time);
+            std::lock_guard<std::mutex> lock_guard(m_client_mgr_mutex);
+            auto                        client_iter = m_client_mgr.find(fd);
+            if (client_iter == m_client_mgr.end() || client_iter->second != peer_client) {
+                continue;
+            }
+        }
+
+        // 读取回调中被限速的连接注册时不关注EPOLLIN，由定时器恢复
+        EpollEventType events = getClientEvents(*peer_client);
+        if (auto ret = epollOprEvent(EPOLL_CTL_ADD, fd, events, m_generation); ret.isFailure()) {
+            // 日志可能覆盖errno，先保存epoll_ctl的错误码
+            int error = errno;
+            JTCP_LOG_WARN("%s", ret.getFailurePtr()->c_str());
+            delClient(peer_client.get(), error);
+            continue;
+        }
+        peer_client->m_registered = true;
+    }
+}
+
+void TCPReactor::rejectConnection(FileDescribe::FDType fd, [[maybe_unused]] AdmitResult result)
+{
+    m_metrics.accept_rejects.add();
+    JTCP_TRACE(ACCEPT_REJECT, fd, static_cast<int64_t>(result), 0);
+
+    // l_linger为0时close直接发送RST
+    struct linger reset_linger;
+    reset_linger.l_onoff  = 1;
+    reset_linger.l_linger = 0;
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &reset_linger, sizeof(reset_linger));
+    close(fd);
+}
+
+JResultWithErrMsg TCPReactor::handleClientMsg(epoll_event&                  event,
+                                              const ClockType::time_point& wakeup_time)
+{
+    auto             fd = getHandleFD(event.data.u64);
+    TCPPeerClientPtr peer_client{nullptr};
+    {
+        std::lock_guard<std::mutex> lock_guard(m_client_mgr_mutex);
+        auto                        client_iter = m_client_mgr.find(fd);
+        if (client_iter != m_client_mgr.end()) {
+            peer_client = client_iter->second;
+        }
+    }
+    // 本轮前面的事件处理中连接已断开，或fd已被新连接复用，事件不属于当前连接
+    if (nullptr == peer_client ||
+        peer_client->m_generation != getHandleGeneration(event.data.u64)) {
+        m_metrics.stale_events.add();
+        return JResultWithErrMsg::success();
+    }
+
+    // 套接字出错（如收到RST）时未读的数据已被内核丢弃，不必再读，直接断开
+    if (event.events & EPOLLERR) {
+        int       error = 0;
+        socklen_t len   = sizeof(error);
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len);
+        return delClient(peer_client.get(), error != 0 ? error : EIO);
+    }
+
+    // 对端已关闭写方向，缓冲区中剩余的数据仍交给回调，读完后由reactor断开，不必再读到0
+    if (event.events & (EPOLLRDHUP | EPOLLHUP)) {
+        peer_client->m_peer_closed = true;
+    }
+    if ((event.events & EPOLLOUT) && peer_client->m_want_write) {
+        try {
+            peer_client->onWritable();
+        }
+        catch (const std::exception& e) {
+            JTCP_LOG_WARN("writable callback of client %d threw: %s", fd, e.what());
+            m_metrics.callback_failures.add();
+            return delClient(peer_client.get(), ECONNABORTED);
+        }
+    }
+    // 被限速的连接只关注对端关闭，数据在恢复读取后处理
+    if (peer_client->m_throttled || 0 == (event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) {
+        return JResultWithErrMsg::success();
+    }
+    dispatchRecvData(peer_client, fd, wakeup_time);
+    return JResultWithErrMsg::success();
+}
+
+void TCPReactor::dispatchRecvData(const TCPPeerClientPtr& peer_client, FileDescribe::FDType fd,
+                                  const ClockType::time_point& wakeup_time)
+{
+    auto read_budget = m_server->m_options.read_budget;
+    peer_client->m_read_budget      = read_budget > 0 ? read_budget : SIZE_MAX;
+    peer_client->m_budget_exhausted = false;
+    // 字节限速时本次最多读取可用的令牌数，其余数据留在内核中
+    if (peer_client->m_byte_bucket.isEnabled()) {
+        peer_client->m_read_budget = std::min<size_t>(
+            peer_client->m_read_budget, peer_client->m_byte_bucket.refill(ClockType::now()));
+    }
+
+    // 通知客户端，让用户自己决定如何处理
+    auto callback_begin  = ClockType::now();
+    bool callback_failed = false;
+    try {
+        peer_client->onRecvData();
+    }
+    catch (const std::exception& e) {
+        JTCP_LOG_WARN("recv data callback of client %d threw: %s", fd, e.what());
+        callback_failed = true;
+    }
+    auto callback_end = ClockType::now();
+
+    // 回调之外的readData不受配额限制
+    peer_client->m_read_budget = SIZE_MAX;
+    if (callback_failed) {
+        // 回调的异常只断开这一个连接
+        m_metrics.callback_failures.add();
+        delClient(peer_client.get(), ECONNABORTED);
+    }
+    else if (peer_client->m_peer_drained) {
+        // 对端已关闭且数据已读完，不必再读一次得到0
+        delClient(peer_client.get());
+    }
+    else {
+        if (m_server->m_options.throttle.isEnabled()) {
+            applyThrottle(peer_client, fd);
+        }
+        if (peer_client->m_budget_exhausted && false == peer_client->m_requeued) {
+            peer_client->m_requeued = true;
+            m_requeued.push_back(peer_client);
+        }
+    }
+
+    auto dispatch_delay =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(callback_begin - wakeup_time).count();
+    auto callback_duration =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(callback_end - callback_begin).count();
+    m_metrics.dispatch_delay_ns.record(dispatch_delay);
+    m_metrics.callback_duration_ns.record(callback_duration);
+    JTCP_TRACE(CALLBACK, fd, callback_duration, dispatch_delay);
+}
+
+JResultWithErrMsg TCPReactor::delClient(TCPPeerClient* peer_client, int error)
+{
+    auto             fd = peer_client->getFileDescribe()->getFD();
+    TCPPeerClientPtr client{nullptr};
+    {
+        // 只删除仍属于该连接的表项，重复断开时不会误删复用了同一fd的新连接
+        std::lock_guard<std::mutex> lock_guard(m_client_mgr_mutex);
+        auto                        client_iter = m_client_mgr.find(fd);
+        if (client_iter == m_client_mgr.end() || client_iter->second.get() != peer_client) {
+            return JResultWithErrMsg::failure("peer client is already disconnected");
+        }
+        client = client_iter->second;
+        m_client_mgr.erase(client_iter);
+        // 从epoll中移除推迟到reactor线程释放连接时，在此之前的事件查不到连接，按过期事件丢弃
+        m_retired.push_back(client);
+    }
+
+    m_metrics.disconnects.add();
+    if (0 == error) {
+        m_metrics.peer_closes.add();
+    }
+    else if (error > 0) {
+        m_metrics.socket_errors.add();
+    }
+    JTCP_TRACE(DISCONNECT, fd, error, 0);
+    if (m_server->m_admission.isEnabled()) {
+        m_server->m_admission.release(client->getPeerAddress());
+    }
+    client->onDisconnect();
+    JTCP_LOG_DEBUG("delete client: %d", fd);
+
+    return JResultWithErrMsg::success();
+}
+
+void TCPReactor::scheduleAcceptRetry()
+{
+    if (m_accept_retry_pending) {
+        return;
+    }
+    // 监听套接字是边缘触发的，没有新连接到达就不会再报告，由定时器重新accept队列中剩余的连接
+    m_accept_retry_pending = true;
+    m_timers.addTimer(ClockType::now() + ACCEPT_RETRY_INTERVAL, [this]() {
+        m_accept_retry_pending = false;
+        if (handleNewClientConnect(ClockType::now()).isFailure()) {
+            scheduleAcceptRetry();
+        }
+    });
+}
+
+void TCPReactor::reclaimRetired()
+{
+    std::vector<TCPPeerClientPtr> retired;
+    {
+        std::lock_guard<std::mutex> lock_guard(m_client_mgr_mutex);
+        if (m_retired.empty()) {
+            return;
+        }
+        retired.swap(m_retired);
+    }
+    for (auto& peer_client : retired) {
+        // 只有reactor持有连接和fd时，释放即关闭fd，内核随之将其移出epoll，不必再EPOLL_CTL_DEL。
+        // 若其他线程恰好在此之后取得引用，fd保持打开，其事件因查不到连接而被丢弃
+        auto& fd = peer_client->m_fd;
+        if (peer_client->m_registered && (peer_client.use_count() > 1 || fd.use_count() > 1)) {
+            if (auto ret = epollOprEvent(EPOLL_CTL_DEL, fd->getFD(), 0); ret.isFailure()) {
+                JTCP_LOG_WARN("%s", ret.getFailurePtr()->c_str());
+            }
+        }
+    }
+    // 在锁外释放，用户不再持有的连接在这里关闭fd
+    retired.clear();
+}
+
+void TCPReactor::dispatchRequeued(const ClockType::time_point& wakeup_time)
+{
+    if (m_requeued.empty()) {
+        return;
+    }
+    // 回调中可能再次用完配额并加入队列，先取出本轮的连接
+    std::vector<TCPPeerClientPtr> requeued;
+    requeued.swap(m_requeued);
+    for (auto& peer_client : requeued) {
+        peer_client->m_requeued = false;
+        // 被限速的连接由定时器恢复读取，恢复时epoll会再次报告剩余的数据
+        if (peer_client->m_throttled) {
+            continue;
+        }
+        auto fd = peer_client->getFileDescribe()->getFD();
+        {
+            // 连接可能已在本轮断开
+            std::lock_guard<std::mutex> lock_guard(m_client_mgr_mutex);
+            auto                        client_iter = m_client_mgr.find(fd);
+            if (client_iter == m_client_mgr.end() || client_iter->second != peer_client) {
+                continue;
+            }
+        }
+        m_metrics.requeues.add();
+        dispatchRecvData(peer_client, fd, wakeup_time);
+    }
+}
+
+void TCPReactor::requeueClient(TCPPeerClient* peer_client)
+{
+    if (peer_client->m_requeued) {
+        return;
+    }
+    // 已断开的连接不再调度
+    auto                        fd = peer_client->getFileDescribe()->getFD();
+    std::lock_guard<std::mutex> lock_guard(m_client_mgr_mutex);
+    auto                        client_iter = m_client_mgr.find(fd);
+    if (client_iter == m_client_mgr.end() || client_iter->second.get() != peer_client) {
+        return;
+    }
+    peer_client->m_requeued = true;
+    m_requeued.push_back(client_iter->second);
+}
+
+void TCPReactor::applyThrottle(const TCPPeerClientPtr& peer_client, FileDescribe::FDType fd)
+{
+    // 回调之外读取的数据也计入，在下一次回调后一并扣减
+    auto  bytes_in       = peer_client->m_bytes_in.load(std::memory_order_relaxed);
+    auto  messages       = peer_client->m_messages.load(std::memory_order_relaxed);
+    auto  now            = ClockType::now();
+    auto& byte_bucket    = peer_client->m_byte_bucket;
+    auto& message_bucket = peer_client->m_message_bucket;
+    if (byte_bucket.isEnabled()) {
+        byte_bucket.refill(now);
+        byte_bucket.consume(bytes_in - peer_client->m_charged_bytes);
+    }
+    // 消息边界由回调决定，只能先处理后扣减，令牌可能透支
+    if (message_bucket.isEnabled()) {
+        message_bucket.refill(now);
+        message_bucket.consume(messages - peer_client->m_charged_messages);
+    }
+    peer_client->m_charged_bytes    = bytes_in;
+    peer_client->m_charged_messages = messages;
+
+    auto wait = std::max(byte_bucket.getRefillWait(), message_bucket.getRefillWait());
+    if (wait.count() <= 0 || peer_client->m_throttled) {
+        return;
+    }
+
+    // 去掉EPOLLIN，数据留在内核中，接收窗口耗尽后对端自然停止发送；尚未注册的连接在注册时处理
+    peer_client->m_throttled = true;
+    if (auto ret = updateClientEvents(peer_client.get()); ret.isFailure()) {
+        JTCP_LOG_WARN("throttle client %d failed: %s", fd, ret.getFailurePtr()->c_str());
+        peer_client->m_throttled = false;
+        return;
+    }
+    peer_client->m_throttle_begin = now;
+    peer_client->m_throttle_count.fetch_add(1, std::memory_order_relaxed);
+    m_metrics.throttles.add();
+
+    std::weak_ptr<TCPPeerClient> weak_client = peer_client;
+    m_timers.addTimer(now + wait, [this, weak_client, fd]() {
+        if (auto client = weak_client.lock()) {
+            resumeThrottled(client, fd);
+        }
+    });
+}
+
+void TCPReactor::resumeThrottled(const TCPPeerClientPtr& peer_client, FileDescribe::FDType fd)
+{
+    {
+        // 暂停期间连接可能已断开，fd也可能已被新连接复用
+        std::lock_guard<std::mutex> lock_guard(m_client_mgr_mutex);
+        auto                        client_iter = m_client_mgr.find(fd);
+        if (client_iter == m_client_mgr.end() || client_iter->second != peer_client) {
+            return;
+        }
+    }
+    auto throttled_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            ClockType::now() - peer_client->m_throttle_begin)
+                            .count();
+    peer_client->m_throttled_ns.fetch_add(throttled_ns, std::memory_order_relaxed);
+    peer_client->m_throttled = false;
+
+    // 恢复EPOLLIN时若接收缓冲区中已有数据，epoll会立即报告一次可读
+    if (auto ret = updateClientEvents(peer_client.get()); ret.isFailure()) {
+        JTCP_LOG_WARN("resume client %d failed: %s", fd, ret.getFailurePtr()->c_str());
+    }
+}
+
+TCPReactor::EpollEventType TCPReactor::getClientEvents(const TCPPeerClient& peer_client) noexcept
+{
+    EpollEventType events = peer_client.m_throttled ? CLIENT_PAUSED_EVENTS : CLIENT_EVENTS;
+    if (peer_client.m_want_write) {
+        events |= EPOLLOUT;
+    }
+    return events;
+}
+
+JResultWithErrMsg TCPReactor::updateClientEvents(TCPPeerClient* peer_client)
+{
+    if (false == peer_client->m_registered) {
+        return JResultWithErrMsg::success();
+    }
+    // 边缘触发下加入EPOLLOUT时若已可写，epoll会立即报告一次
+    return epollOprEvent(EPOLL_CTL_MOD,
+                         peer_client->getFileDescribe()->getFD(),
+                         getClientEvents(*peer_client),
+                         peer_client->m_generation);
+}
+
+}   // namespace JTCP::Server
@@ -1,40 +1,110 @@
 #include "JTCP/server/server.h"
+#include "JTCP/common/cpu_topology.h"
+#include "JTCP/common/logger.h"
+#include "JTCP/server/reactor.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <linux/filter.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace JTCP::Server {
 
+TCPServer::~TCPServer()
+{
+    // 未调用stop就析构时通知reactor线程退出，否则等待线程结束的future会一直阻塞
+    for (auto& reactor : m_reactors) {
+        reactor->stop();
+    }
+}
+
 void TCPServer::setOnNewClient(OnNewClientCBType cb) noexcept
 {
     m_on_new_client_cb = cb;
 }
 
+void TCPServer::setOptions(const ServerOptions& options) noexcept
+{
+    m_options = options;
+}
+
 JResultWithErrMsg TCPServer::start(const Types::IPStrType& listen_addr,
                                    const Types::PortType&  listen_port,
                                    const ListenMaxNumType& listen_max_num)
 {
-    m_server_listen_fd = std::make_shared<FileDescribe>(socket(AF_INET, SOCK_STREAM, 0));
-    if (m_server_listen_fd->isInvalid()) {
-        return JResultWithErrMsg::failure("create socket failed");
+    // reactor线程仍在运行时不能释放reactor，需先调用stop
+    if (false == m_reactor_threads.empty()) {
+        return JResultWithErrMsg::failure("server is already running");
     }
 
-    struct sockaddr_in addr;
-    addr.sin_family      = AF_INET;
-    addr.sin_addr.s_addr = inet_addr(listen_addr.c_str());
-    addr.sin_port        = htons(listen_port);
+    // 双栈监听时通配地址统一为IPv6的通配地址，一个套接字同时接受两种地址族的连接
+    auto addr_ret = SocketAddress::parse(
+        m_options.dual_stack && listen_addr == "0.0.0.0" ? "::" : listen_addr, listen_port);
+    if (addr_ret.isFailure()) {
+        return JResultWithErrMsg::failure(addr_ret.getFailurePtr());
+    }
+    auto& addr = *addr_ret.getSuccessPtr();
 
-    if (bind(m_server_listen_fd->getFD(), (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-        return JResultWithErrMsg::failure("bind socket failed");
+    if (addr.isUnix()) {
+        if (auto ret = prepareUnixPath(addr.getUnixPath()); ret.isFailure()) {
+            return ret;
+        }
     }
-    if (listen(m_server_listen_fd->getFD(), listen_max_num) < 0) {
-        return JResultWithErrMsg::failure("listen socket failed");
+
+    // 每个reactor各自监听同一地址，由内核在SO_REUSEPORT组内分配新连接，reactor之间不共享accept队列
+    size_t reactor_num = std::max<size_t>(m_options.reactor_num, 1);
+    bool   reuse_port  = reactor_num > 1 && false == addr.isUnix();
+
+    // 上一次start的连接引用这些reactor，用户需在再次start前释放持有的连接
+    m_reactors.clear();
+    m_reactor_threads.clear();
+    m_admission.reset(m_options.admission);
+    FileDescribePtr listen_fd{nullptr};
+    for (size_t i = 0; i < reactor_num; ++i) {
+        if (nullptr == listen_fd || reuse_port) {
+            auto fd_ret = createListenSocket(addr, listen_max_num, reuse_port);
+            if (fd_ret.isFailure()) {
+                return JResultWithErrMsg::failure(fd_ret.getFailurePtr());
+            }
+            listen_fd = *fd_ret.getSuccessPtr();
+        }
+        m_reactors.emplace_back(std::make_unique<TCPReactor>(this, i, listen_fd));
+    }
+    if (addr.isUnix() && addr.getUnixPath().front() != '@') {
+        m_unix_path = addr.getUnixPath();
     }
 
-    m_accept_thread = std::async(std::launch::async,
-                                 std::bind(&TCPServer::acceptThreadFunc, this, listen_max_num));
+    if (m_options.steer_by_cpu) {
+        if (reuse_port) {
+            // 挂载失败时仍可正常服务，只是连接按内核默认的哈希分配
+            if (auto ret = attachSteeringProgram(listen_fd->getFD()); ret.isFailure()) {
+                JTCP_LOG_WARN("steer by cpu disabled: %s", ret.getFailurePtr()->c_str());
+            }
+        }
+        else {
+            JTCP_LOG_WARN("steer by cpu requires reactor_num > 1 and a TCP listen address");
+        }
+    }
+
+    for (auto& reactor : m_reactors) {
+        m_reactor_threads.emplace_back(
+            std::async(std::launch::async, &TCPReactor::run, reactor.get()));
+    }
 
-    while (m_run_flag == false) {
-        if (m_accept_thread.wait_for(std::chrono::milliseconds(100)) !=
-            std::future_status::timeout) {
-            return m_accept_thread.get();
+    for (size_t i = 0; i < m_reactors.size(); ++i) {
+        while (m_reactors[i]->isRunning() == false) {
+            if (m_reactor_threads[i].wait_for(std::chrono::milliseconds(100)) !=
+                std::future_status::timeout) {
+                auto ret = m_reactor_threads[i].get();
+                stop();
+                return ret;
+            }
         }
     }
 
@@ -43,166 +113,207 @@ JResultWithErrMsg TCPServer::start(const Types::IPStrType& listen_addr,
 
 JResultWithErrMsg TCPServer::stop()
 {
-    m_run_flag = false;
-    return m_accept_thread.get();
+    for (auto& reactor : m_reactors) {
+        reactor->stop();
+    }
+    // 返回第一个失败的reactor的结果；reactor对象保留到下次start或析构，
+    // 在此之前已交给用户的连接仍可安全调用，之后连接引用的reactor已被释放
+    auto ret = JResultWithErrMsg::success();
+    for (auto& reactor_thread : m_reactor_threads) {
+        if (false == reactor_thread.valid()) {
+            continue;
+        }
+        if (auto thread_ret = reactor_thread.get(); thread_ret.isFailure() && ret.isSuccess()) {
+            ret = thread_ret;
+        }
+    }
+    m_reactor_threads.clear();
+    if (false == m_unix_path.empty()) {
+        unlink(m_unix_path.c_str());
+        m_unix_path.clear();
+    }
+    return ret;
 }
 
-JResultWithErrMsg TCPServer::acceptThreadFunc(const ListenMaxNumType& listen_max_num)
+JResultWithSuccErrMsg<FileDescribePtr> TCPServer::createListenSocket(
+    const SocketAddress& addr, const ListenMaxNumType& listen_max_num, bool reuse_port)
 {
-    if (auto ret = initEpoll(); ret.isFailure()) {
-        return ret;
-    }
-
-    using ReadyNumType = int;
-    ReadyNumType             ready_event_num{0};           ///< 触发的事件数量
-    std::vector<epoll_event> event_list(listen_max_num);   ///< 缓存的event列表
-
-    m_run_flag = true;
-    while (m_run_flag) {
-        ready_event_num = epoll_wait(m_epollfd,
-                                     &*event_list.begin(),
-                                     static_cast<int>(event_list.size()),
-                                     1000);   // 超时1秒
-        if (ready_event_num == -1) {
-            return JResultWithErrMsg::failure("epoll_wait failed");
-        }
-        if (ready_event_num == 0)   // 超时，继续等
-        {
-            continue;
-        }
+    using ResultType = JResultWithSuccErrMsg<FileDescribePtr>;
 
-        if ((size_t)ready_event_num == event_list.size())   // 对clients进行扩容
-        {
-            event_list.resize(event_list.size() * 2);
+    auto listen_fd = std::make_shared<FileDescribe>(socket(addr.getFamily(), SOCK_STREAM, 0));
+    if (listen_fd->isInvalid()) {
+        return ResultType::failure("create socket failed");
+    }
+    if (addr.isIPv6()) {
+        int v6only = m_options.dual_stack ? 0 : 1;
+        if (setsockopt(listen_fd->getFD(), IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only)) <
+            0) {
+            JTCP_LOG_ERROR("set IPV6_V6ONLY failed: %s", strerror(errno));
+            return ResultType::failure("set IPV6_V6ONLY failed");
         }
-
-        // 对每个事件进行处理
-        for (ReadyNumType i = 0; i < ready_event_num; i++) {
-            auto& event = event_list[i];
-            if (event.data.fd == m_server_listen_fd->getFD()) {
-                if (auto ret = handleNewClientConnect(); ret.isFailure()) {
-                    return ret;
-                }
-            }
-            else if (event.events & EPOLLIN) {
-                if (event.data.fd < 0) {
-                    continue;
-                }
-                if (auto ret = handleClientMsg(event); ret.isFailure()) {
-                    return ret;
-                }
-            }
+    }
+    if (auto ret = m_options.socket_options.applyListen(listen_fd->getFD(), addr.getFamily());
+        ret.isFailure()) {
+        return ResultType::failure(ret.getFailurePtr());
+    }
+    if (reuse_port) {
+        int enable = 1;
+        if (setsockopt(listen_fd->getFD(), SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) {
+            JTCP_LOG_ERROR("set SO_REUSEPORT failed: %s", strerror(errno));
+            return ResultType::failure("set SO_REUSEPORT failed");
         }
     }
 
-    // 服务停止，释放各个资源
-    m_run_flag = false;
-    {
-        std::lock_guard<std::mutex> lock_guard(m_client_mgr_mutex);
-        m_client_mgr.clear();
+    applyBusyPoll(listen_fd->getFD());
+
+    if (bind(listen_fd->getFD(), addr.getSockAddr(), addr.getLength()) < 0) {
+        JTCP_LOG_ERROR("bind %s failed: %s", addr.toString().c_str(), strerror(errno));
+        return ResultType::failure("bind socket failed");
     }
-    return JResultWithErrMsg::success();
+    // 套接字在listen时按顺序加入SO_REUSEPORT组，组内序号与reactor序号一致，供CBPF程序返回
+    if (listen(listen_fd->getFD(), listen_max_num) < 0) {
+        JTCP_LOG_ERROR("listen %s failed: %s", addr.toString().c_str(), strerror(errno));
+        return ResultType::failure("listen socket failed");
+    }
+    // 监听套接字设为非阻塞，以便每次唤醒时把等待队列中的连接全部accept
+    if (auto ret = setFileDiscribeBlock(listen_fd->getFD(), false); ret.isFailure()) {
+        return ResultType::failure(ret.getFailurePtr());
+    }
+    return ResultType::success(listen_fd);
 }
 
-JResultWithErrMsg TCPServer::initEpoll()
+JResultWithErrMsg TCPServer::attachSteeringProgram(FileDescribe::FDType fd)
 {
-    // 创建一个 epoll 实例，并设置文件描述符为关闭执行时关闭
-    m_epollfd = epoll_create1(EPOLL_CLOEXEC);
-    return epollOprEvent(EPOLL_CTL_ADD, m_server_listen_fd->getFD(), EPOLLIN | EPOLLET);
-}
-JResultWithErrMsg TCPServer::epollOprEvent(EpollOprType opr, FileDescribe::FDType fd,
-                                           EpollEventType epoll_events)
-{
-    struct epoll_event event;
-    // 设置event为边缘触发模式，并关注读事件
-    event.events = epoll_events;
-    // 设置event的fd为监听的fd
-    event.data.fd = fd;
-    // 将监听的fd添加到epoll中
-    if (epoll_ctl(m_epollfd, opr, fd, &event) < 0) {
-        // 如果添加失败，返回错误信息
-        return JResultWithErrMsg::failure(std::string("epoll_ctl when add event:") +
-                                          std::to_string(epoll_events) +
-                                          " for fd: " + std::to_string(fd) + " failed");
+    auto reactor_num = static_cast<uint32_t>(m_reactors.size());
+
+    // 每个reactor所在的NUMA节点，未绑定CPU的reactor不参与按节点选择
+    std::vector<std::vector<int>> reactor_cpus(reactor_num);
+    std::vector<int>              reactor_nodes(reactor_num, -1);
+    for (uint32_t i = 0; i < reactor_num; ++i) {
+        reactor_cpus[i] = getReactorCPUs(i);
+        if (false == reactor_cpus[i].empty()) {
+            reactor_nodes[i] = CPUTopology::getNumaNode(reactor_cpus[i].front());
+        }
     }
 
+    // 程序：A = 收包CPU；逐个比较需要特殊映射的CPU；其余CPU返回A % reactor_num
+    std::vector<sock_filter> code;
+    code.push_back(
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)));
+    for (int cpu = 0; cpu < CPUTopology::getCPUNum(); ++cpu) {
+        std::vector<uint32_t> same_cpu;
+        std::vector<uint32_t> same_node;
+        int                   node = CPUTopology::getNumaNode(cpu);
+        for (uint32_t i = 0; i < reactor_num; ++i) {
+            auto& cpus = reactor_cpus[i];
+            if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()) {
+                same_cpu.push_back(i);
+            }
+            else if (reactor_nodes[i] == node) {
+                same_node.push_back(i);
+            }
+        }
+        auto&    candidates = same_cpu.empty() ? same_node : same_cpu;
+        uint32_t target     = candidates.empty() ? cpu % reactor_num
+                                                 : candidates[cpu % candidates.size()];
+        if (target == cpu % reactor_num) {
+            continue;
+        }
+        if (code.size() + 4 > BPF_MAXINSNS) {
+            JTCP_LOG_WARN("too many cpus for steering program, cpu %d and above use cpu %% %u",
+                          cpu,
+                          reactor_num);
+            break;
+        }
+        code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<uint32_t>(cpu), 0, 1));
+        code.push_back(BPF_STMT(BPF_RET | BPF_K, target));
+    }
+    code.push_back(BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, reactor_num));
+    code.push_back(BPF_STMT(BPF_RET | BPF_A, 0));
+
+    sock_fprog program{};
+    program.len    = static_cast<unsigned short>(code.size());
+    program.filter = code.data();
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) < 0) {
+        JTCP_LOG_ERROR("attach reuseport cbpf failed: %s", strerror(errno));
+        return JResultWithErrMsg::failure("attach reuseport cbpf failed");
+    }
     return JResultWithErrMsg::success();
 }
 
-JResultWithErrMsg TCPServer::handleNewClientConnect()
+std::vector<int> TCPServer::getReactorCPUs(size_t reactor_index) const
 {
-    // 新客户端连接
-    auto peer_client = std::make_shared<TCPPeerClient>(this);
-
-    socklen_t len  = sizeof(sockaddr_in);
-    auto      conn = std::make_shared<FileDescribe>(
-        accept(m_server_listen_fd->getFD(), (sockaddr*)peer_client->getSockAddr(), &len));
-    if (conn->isInvalid()) {
-        return JResultWithErrMsg::failure("accept failed");
+    if (false == m_options.cpu_affinity.empty()) {
+        return {m_options.cpu_affinity[reactor_index % m_options.cpu_affinity.size()]};
     }
-
-    peer_client->setFileDescribe(conn);
-
-    // 设为非阻塞
-    if (auto ret = setFileDiscribeBlock(conn->getFD(), false); ret.isFailure()) {
-        return ret;
+    if (false == m_options.numa_nodes.empty()) {
+        return CPUTopology::getNodeCPUs(
+            m_options.numa_nodes[reactor_index % m_options.numa_nodes.size()]);
     }
+    return {};
+}
 
-    // 将该event设置为监听目标
-    if (auto ret = epollOprEvent(EPOLL_CTL_ADD, conn->getFD(), EPOLLIN | EPOLLET);
-        ret.isFailure()) {
-        return ret;
+JResultWithErrMsg TCPServer::prepareUnixPath(const std::string& path)
+{
+    // 抽象命名空间的名字随套接字关闭自动释放
+    if (path.front() == '@') {
+        return JResultWithErrMsg::success();
     }
 
-    {
-        std::lock_guard<std::mutex> lock_guard(m_client_mgr_mutex);
-        m_client_mgr[conn->getFD()] = peer_client;
+    // 进程异常退出时会留下套接字文件，导致bind失败；只删除套接字文件，避免误删普通文件
+    struct stat path_stat;
+    if (lstat(path.c_str(), &path_stat) == 0) {
+        if (false == S_ISSOCK(path_stat.st_mode)) {
+            JTCP_LOG_ERROR("unix socket path %s exists and is not a socket", path.c_str());
+            return JResultWithErrMsg::failure("unix socket path exists");
+        }
+        unlink(path.c_str());
     }
-    m_on_new_client_cb(peer_client);
-
     return JResultWithErrMsg::success();
 }
 
-JResultWithErrMsg TCPServer::handleClientMsg(epoll_event& event)
+Metrics::ServerMetricsSnapshot TCPServer::getMetrics() const
 {
-    TCPPeerClientPtr peer_client{nullptr};
-    {
-        std::lock_guard<std::mutex> lock_guard(m_client_mgr_mutex);
-        peer_client = m_client_mgr.at(event.data.fd);
+    Metrics::ServerMetricsSnapshot snapshot;
+    for (auto& reactor : m_reactors) {
+        snapshot.reactors.emplace_back(reactor->getMetrics());
     }
-    if (nullptr == peer_client) {
-        return JResultWithErrMsg::failure("peer client is nullptr");
-    }
-
-    // 通知客户端，让用户自己决定如何处理
-    peer_client->onRecvData();
-
-    return JResultWithErrMsg::success();
+    return snapshot;
 }
 
-JResultWithErrMsg TCPServer::delClient(const FileDescribe::FDType& fd)
+void TCPServer::applyBusyPoll(FileDescribe::FDType fd)
 {
-    if (auto ret = epollOprEvent(EPOLL_CTL_DEL, fd, 0); ret.isFailure()) {
-        return ret;
+    if (m_options.busy_poll_us == 0) {
+        return;
     }
-    TCPPeerClientPtr client{nullptr};
-    {
-        std::lock_guard<std::mutex> lock_guard(m_client_mgr_mutex);
-        auto                        client_iter = m_client_mgr.find(fd);
-        if (client_iter != m_client_mgr.end()) {
-            client = client_iter->second;
+    int busy_poll = static_cast<int>(m_options.busy_poll_us);
+    if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll, sizeof(busy_poll)) < 0) {
+        // 每个连接都会设置一次，只记录第一次失败
+        static std::atomic<bool> warned{false};
+        if (false == warned.exchange(true)) {
+            JTCP_LOG_WARN("set SO_BUSY_POLL failed: %s", strerror(errno));
         }
-        m_client_mgr.erase(fd);
     }
+}
 
-    if (nullptr == client) {
-        return JResultWithErrMsg::failure("peer client is nullptr");
+void TCPServer::applyCPUAffinity(size_t reactor_index)
+{
+    auto cpus = getReactorCPUs(reactor_index);
+    if (cpus.empty()) {
+        return;
     }
 
-    client->onDisconnect();
-    printf("delete client: %d\n", fd);
-
-    return JResultWithErrMsg::success();
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (auto cpu : cpus) {
+        CPU_SET(cpu, &cpu_set);
+    }
+    if (int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set); ret != 0) {
+        JTCP_LOG_WARN("bind reactor %zu to cpu %d failed: %s",
+                      reactor_index,
+                      cpus.front(),
+                      strerror(ret));
+    }
 }
 
 /**
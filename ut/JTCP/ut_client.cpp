@@ -1,3 +1,427 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "JTCP/JTCP.h"
-#include "doctest.h"
\ No newline at end of file
+#include "doctest.h"
+#include <atomic>
+#include <cstring>
+#include <future>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+TEST_CASE("async client")
+{
+    using namespace JTCP;
+
+    Server::TCPServer server;
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        client->setOnRecvDataCB([](Server::TCPPeerClient* ptr) {
+            char buff[2048]{0};
+            while (true) {
+                auto ret = ptr->readData(buff, sizeof(buff));
+                if (ret.isFailure()) {
+                    return;
+                }
+                ptr->sendData(buff, *(ret.getSuccessPtr()));
+            }
+        });
+    });
+    REQUIRE(server.start("127.0.0.1", 9996, 128).isFailure() == false);
+
+    // 事件数组上限小于连接数，一次唤醒取不完的事件留到下一次
+    Client::ClientLoopOptions loop_options;
+    loop_options.max_events_per_wakeup = 4;
+    Client::TCPClientLoop loop(loop_options);
+    REQUIRE(loop.start().isFailure() == false);
+
+    // 一个事件循环线程驱动所有连接，连接建立前发送的数据在连接成功后发出
+    constexpr int                          CLIENT_NUM = 50;
+    std::atomic_int                        connected_num{0}, echo_num{0}, closed_num{0};
+    std::vector<Client::AsyncTCPClientPtr> clients;
+    std::vector<std::future<bool>>         futures;
+    for (int i = 0; i < CLIENT_NUM; ++i) {
+        auto ret = Client::AsyncTCPClient::createNew(loop);
+        REQUIRE(ret.isFailure() == false);
+        auto client = *ret.getSuccessPtr();
+        client->setOnConnectCB([&](Client::AsyncTCPClient*, bool success) {
+            if (success) {
+                connected_num++;
+            }
+        });
+        // 按4字节一帧处理，不完整的帧留在缓冲区中
+        client->setOnRecvDataCB([&](Client::AsyncTCPClient*, ByteBuffer& buff) {
+            while (buff.readableBytes() >= 4) {
+                if (buff.view().substr(0, 4) == "ping") {
+                    echo_num++;
+                }
+                buff.retrieve(4);
+            }
+        });
+        client->setOnCloseCB([&](Client::AsyncTCPClient*) { closed_num++; });
+        futures.emplace_back(client->connect("127.0.0.1", 9996));
+        REQUIRE(client->sendData("pi", 2).isFailure() == false);
+        REQUIRE(client->sendData("ng", 2).isFailure() == false);
+        clients.push_back(client);
+    }
+    for (auto& future : futures) {
+        CHECK(future.get());
+    }
+    for (int i = 0; i < 200 && echo_num < CLIENT_NUM; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(connected_num == CLIENT_NUM);
+    CHECK(echo_num == CLIENT_NUM);
+
+    // 连接失败通过future和回调通知
+    {
+        auto ret = Client::AsyncTCPClient::createNew(loop);
+        REQUIRE(ret.isFailure() == false);
+        auto client = *ret.getSuccessPtr();
+        CHECK(client->connect("127.0.0.1", 9).get() == false);
+        CHECK(client->isClosed());
+        CHECK(client->sendData("ping", 4).isFailure());
+    }
+
+    // 客户端先于服务端关闭，避免服务端端口进入TIME_WAIT
+    for (auto& client : clients) {
+        client->close();
+    }
+    for (int i = 0; i < 200 && closed_num < CLIENT_NUM; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(closed_num == CLIENT_NUM);
+    CHECK(loop.stop().isFailure() == false);
+
+    // 事件循环停止后发起的连接立即得到失败结果
+    {
+        auto ret = Client::AsyncTCPClient::createNew(loop);
+        REQUIRE(ret.isFailure() == false);
+        auto future = (*ret.getSuccessPtr())->connect("127.0.0.1", 9996);
+        REQUIRE(future.wait_for(std::chrono::seconds(1)) == std::future_status::ready);
+        CHECK(future.get() == false);
+    }
+
+    server.stop();
+}
+
+TEST_CASE("client pool")
+{
+    using namespace JTCP;
+
+    Server::TCPServer server;
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        client->setOnRecvDataCB([](Server::TCPPeerClient* ptr) {
+            char buff[2048]{0};
+            while (true) {
+                auto ret = ptr->readData(buff, sizeof(buff));
+                if (ret.isFailure()) {
+                    return;
+                }
+                ptr->sendData(buff, *(ret.getSuccessPtr()));
+            }
+        });
+    });
+    REQUIRE(server.start("127.0.0.1", 9995, 128).isFailure() == false);
+
+    Client::TCPClientLoop loop;
+    REQUIRE(loop.start().isFailure() == false);
+    {
+        Client::ClientPoolOptions options;
+        options.max_per_host  = 2;
+        options.pipeline_loop = &loop;
+        Client::TCPClientPool pool(options);
+
+        // 归还的连接被复用，超过上限时借出失败
+        Client::TCPClient* first_client{nullptr};
+        {
+            auto ret = pool.acquire("127.0.0.1", 9995);
+            REQUIRE(ret.isFailure() == false);
+            first_client = (*ret.getSuccessPtr())->get();
+        }
+        CHECK(pool.getIdleNum("127.0.0.1", 9995) == 1);
+        {
+            auto ret1 = pool.acquire("127.0.0.1", 9995);
+            auto ret2 = pool.acquire("127.0.0.1", 9995);
+            REQUIRE(ret1.isFailure() == false);
+            REQUIRE(ret2.isFailure() == false);
+            CHECK((*ret1.getSuccessPtr())->get() == first_client);
+            CHECK(pool.acquire("127.0.0.1", 9995).isFailure());
+
+            // 损坏的连接不会放回池中
+            (*ret2.getSuccessPtr())->markBroken();
+        }
+        CHECK(pool.getIdleNum("127.0.0.1", 9995) == 1);
+
+        // 残留未读数据的连接不会被再次借出
+        {
+            auto ret = pool.acquire("127.0.0.1", 9995);
+            REQUIRE(ret.isFailure() == false);
+            REQUIRE((*ret.getSuccessPtr())->get()->sendData("ping", 4).isFailure() == false);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        {
+            auto ret = pool.acquire("127.0.0.1", 9995);
+            REQUIRE(ret.isFailure() == false);
+            CHECK(Client::HostClientSlots::isHealthy(*(*ret.getSuccessPtr())->get()));
+        }
+
+        // 用户态缓冲区中残留预读数据或未发送数据的连接不会放回池中
+        {
+            auto ret = pool.acquire("127.0.0.1", 9995);
+            REQUIRE(ret.isFailure() == false);
+            auto client = (*ret.getSuccessPtr())->get();
+            REQUIRE(client->sendData("ping", 4).isFailure() == false);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            char byte{0};
+            REQUIRE(client->recvExact(&byte, 1).isFailure() == false);
+            CHECK(client->getRecvBufferedBytes() == 3);
+        }
+        CHECK(pool.getIdleNum("127.0.0.1", 9995) == 0);
+        {
+            auto ret = pool.acquire("127.0.0.1", 9995);
+            REQUIRE(ret.isFailure() == false);
+            REQUIRE((*ret.getSuccessPtr())->get()->bufferData("ping", 4).isFailure() == false);
+        }
+        CHECK(pool.getIdleNum("127.0.0.1", 9995) == 0);
+
+        // 多路复用通道上同时进行多个请求，回包按关联ID分发
+        auto channel_ret = pool.getChannel("127.0.0.1", 9995);
+        REQUIRE(channel_ret.isFailure() == false);
+        auto channel = *channel_ret.getSuccessPtr();
+        CHECK(pool.getChannel("127.0.0.1", 9995).getSuccessPtr()->get() == channel.get());
+
+        std::vector<std::future<std::optional<std::string>>> responses;
+        for (int i = 0; i < 100; ++i) {
+            auto request = std::to_string(i);
+            responses.emplace_back(channel->call(request.data(), request.size()));
+        }
+        bool all_matched = true;
+        for (int i = 0; i < 100; ++i) {
+            auto response = responses[i].get();
+            all_matched   = all_matched && response.has_value() && *response == std::to_string(i);
+        }
+        CHECK(all_matched);
+        CHECK(channel->getPendingNum() == 0);
+        channel->close();
+    }
+    CHECK(loop.stop().isFailure() == false);
+
+    server.stop();
+}
+
+TEST_CASE("client recv exact and until")
+{
+    using namespace JTCP;
+
+    // 服务端分多次发送，模拟消息被拆分到达
+    Server::TCPServer server;
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        client->setOnRecvDataCB([](Server::TCPPeerClient* ptr) {
+            char buff[64]{0};
+            while (ptr->readData(buff, sizeof(buff)).isFailure() == false) {}
+        });
+        std::thread([client]() {
+            for (auto piece : {"HTTP/1.1 200 OK\r", "\nContent-Length: 5\r\n\r\nhel", "lo!"}) {
+                client->sendData(piece, strlen(piece));
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+        }).detach();
+    });
+    REQUIRE(server.start("127.0.0.1", 9994).isFailure() == false);
+
+    {
+        auto ret = Client::TCPClient::createNew("127.0.0.1", 9994);
+        REQUIRE(ret.isFailure() == false);
+        auto client = ret.getSuccessPtr()->get();
+
+        // 一次预读取到全部数据，分隔符出现在max_len之后时仍返回失败，数据留在缓冲区中
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        CHECK(client->recvUntil("\r\n\r\n", 20).isFailure());
+
+        auto line = client->recvUntil("\r\n");
+        REQUIRE(line.isFailure() == false);
+        CHECK(*line.getSuccessPtr() == "HTTP/1.1 200 OK\r\n");
+
+        auto header = client->recvUntil("\r\n\r\n");
+        REQUIRE(header.isFailure() == false);
+        CHECK(*header.getSuccessPtr() == "Content-Length: 5\r\n\r\n");
+
+        char body[6]{0};
+        REQUIRE(client->recvExact(body, 5).isFailure() == false);
+        CHECK(std::string(body) == "hello");
+
+        // recvData优先返回预读的数据并报告实际长度
+        char        rest[16]{0};
+        std::size_t rest_len = sizeof(rest);
+        REQUIRE(client->recvData(rest, rest_len).isFailure() == false);
+        CHECK(rest_len == 1);
+        CHECK(rest[0] == '!');
+    }
+
+    server.stop();
+}
+
+TEST_CASE("client buffered and batch send")
+{
+    using namespace JTCP;
+
+    Server::TCPServer server;
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        client->setOnRecvDataCB([](Server::TCPPeerClient* ptr) {
+            char buff[4096]{0};
+            while (true) {
+                auto ret = ptr->readData(buff, sizeof(buff));
+                if (ret.isFailure()) {
+                    return;
+                }
+                ptr->sendData(buff, *(ret.getSuccessPtr()));
+            }
+        });
+    });
+    REQUIRE(server.start("127.0.0.1", 9993).isFailure() == false);
+
+    {
+        auto ret = Client::TCPClient::createNew("127.0.0.1", 9993);
+        REQUIRE(ret.isFailure() == false);
+        auto client = ret.getSuccessPtr()->get();
+
+        // 缓冲的数据在flush或达到阈值前不会发出，立即发送的数据排在缓冲数据之后
+        client->setFlushThreshold(8);
+        REQUIRE(client->bufferData("ab", 2).isFailure() == false);
+        REQUIRE(client->bufferData("cd", 2).isFailure() == false);
+        CHECK(client->getBufferedBytes() == 4);
+        REQUIRE(client->sendData("ef", 2).isFailure() == false);
+        CHECK(client->getBufferedBytes() == 0);
+        REQUIRE(client->bufferData("ghij", 4).isFailure() == false);
+        REQUIRE(client->bufferData("klmn", 4).isFailure() == false);
+        CHECK(client->getBufferedBytes() == 0);
+        REQUIRE(client->bufferData("o", 1).isFailure() == false);
+        REQUIRE(client->flush().isFailure() == false);
+
+        char echo[16]{0};
+        REQUIRE(client->recvExact(echo, 15).isFailure() == false);
+        CHECK(std::string(echo) == "abcdefghijklmno");
+
+        // 超过IOV_MAX的数据段分多次writev发出
+        std::string              expect;
+        std::vector<std::string> segments;
+        for (int i = 0; i < 2000; ++i) {
+            segments.push_back(std::to_string(i % 10));
+            expect += segments.back();
+        }
+        std::vector<std::string_view> views(segments.begin(), segments.end());
+        REQUIRE(client->sendBatch(views).isFailure() == false);
+
+        std::string batch_echo(expect.size(), '\0');
+        REQUIRE(client->recvExact(batch_echo.data(), batch_echo.size()).isFailure() == false);
+        CHECK(batch_echo == expect);
+    }
+
+    server.stop();
+}
+
+TEST_CASE("client connect to host")
+{
+    using namespace JTCP;
+
+    auto addr6 = SocketAddress::fromIP("[::1]", 9992);
+    REQUIRE(addr6.isFailure() == false);
+    CHECK(addr6.getSuccessPtr()->toString() == "[::1]:9992");
+    CHECK(SocketAddress::fromIP("not an ip", 9992).isFailure());
+
+    Server::TCPServer server;
+    server.setOnNewClient([](Server::TCPPeerClientPtr) {});
+    REQUIRE(server.start("127.0.0.1", 9992).isFailure() == false);
+
+    {
+        // 服务端只监听IPv4，排在前面的IPv6地址被拒绝后立即尝试下一个地址
+        std::vector<SocketAddress> addrs{*addr6.getSuccessPtr(),
+                                         *SocketAddress::fromIP("127.0.0.1", 9992).getSuccessPtr()};
+        CHECK(Resolver::interleave({addrs[1], addrs[0]})[0].isIPv6());
+
+        auto begin = std::chrono::steady_clock::now();
+        auto ret   = Client::TCPClient::connectTo(addrs);
+        REQUIRE(ret.isFailure() == false);
+        CHECK(std::chrono::steady_clock::now() - begin < std::chrono::milliseconds(200));
+        REQUIRE(ret.getSuccessPtr()->get()->sendData("ping", 4).isFailure() == false);
+
+        auto host_ret = Client::TCPClient::connectTo("localhost", 9992);
+        CHECK(host_ret.isFailure() == false);
+    }
+
+    {
+        // 不可达的地址在超时后返回失败
+        Client::ConnectOptions options;
+        options.timeout = std::chrono::milliseconds(200);
+        auto begin      = std::chrono::steady_clock::now();
+        auto ret        = Client::TCPClient::connectTo(
+            {*SocketAddress::fromIP("10.255.255.1", 9992).getSuccessPtr()}, options);
+        CHECK(ret.isFailure());
+        CHECK(std::chrono::steady_clock::now() - begin < std::chrono::seconds(1));
+    }
+
+    server.stop();
+}
+
+TEST_CASE("shm channel")
+{
+    using namespace JTCP;
+
+    std::promise<ShmChannelPtr> server_channel_promise;
+    Server::TCPServer           server;
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        client->setOnRecvDataCB([&](Server::TCPPeerClient* ptr) {
+            auto ret = ShmChannel::accept(ptr->getFileDescribe());
+            if (ret.isSuccess()) {
+                server_channel_promise.set_value(*ret.getSuccessPtr());
+            }
+        });
+    });
+    REQUIRE(server.start("unix:@jtcp_ut_shm", 0).isFailure() == false);
+
+    {
+        ShmChannelOptions options;
+        options.ring_capacity = 4096;
+        auto client_ret       = ShmChannel::connect("unix:@jtcp_ut_shm", options);
+        REQUIRE(client_ret.isFailure() == false);
+        auto client         = std::move(*client_ret.getSuccessPtr());
+        auto server_channel = server_channel_promise.get_future().get();
+        CHECK(client->getMaxMessageLen() == 4096 - 4);
+
+        // 服务端线程回显，消息总量超过缓冲区容量，覆盖回绕
+        std::thread echo_thread([server_channel]() {
+            char buff[256];
+            while (server_channel->waitData(std::chrono::seconds(5))) {
+                auto ret = server_channel->readData(buff, sizeof(buff));
+                if (ret.isFailure()) {
+                    break;
+                }
+                while (server_channel->sendData(buff, *ret.getSuccessPtr()).isFailure()) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        char buff[256];
+        for (int i = 0; i < 1000; ++i) {
+            auto msg = "message " + std::to_string(i);
+            REQUIRE(client->sendData(msg.data(), msg.size()).isFailure() == false);
+            REQUIRE(client->waitData(std::chrono::seconds(5)));
+            auto ret = client->readData(buff, sizeof(buff));
+            REQUIRE(ret.isFailure() == false);
+            CHECK(std::string(buff, *ret.getSuccessPtr()) == msg);
+        }
+
+        // 缓冲区不足时不取出消息
+        REQUIRE(client->sendData("hello", 5).isFailure() == false);
+        REQUIRE(client->waitData(std::chrono::seconds(5)));
+        CHECK(client->readData(buff, 2).isFailure());
+        CHECK(*client->readData(buff, sizeof(buff)).getSuccessPtr() == 5);
+
+        // 客户端未调用close直接释放，对端同样得到关闭
+        client = nullptr;
+        echo_thread.join();
+        CHECK(server_channel->isClosed());
+    }
+
+    server.stop();
+}
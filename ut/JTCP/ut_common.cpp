@@ -0,0 +1,226 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "JTCP/common/byte_buffer.h"
+#include "JTCP/common/cpu_topology.h"
+#include "JTCP/common/logger.h"
+#include "JTCP/common/metrics.h"
+#include "JTCP/common/timer_queue.h"
+#include "JTCP/common/trace.h"
+#include "doctest.h"
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+TEST_CASE("latency histogram")
+{
+    using namespace JTCP::Metrics;
+
+    // 小于子桶数量的值精确落桶，更大的值按2的幂分组
+    CHECK(LatencyHistogram::bucketIndex(0) == 0);
+    CHECK(LatencyHistogram::bucketIndex(15) == 15);
+    CHECK(LatencyHistogram::bucketIndex(16) == 16);
+    CHECK(LatencyHistogram::bucketIndex(32) == 32);
+    CHECK(LatencyHistogram::bucketIndex(UINT64_MAX) == LatencyHistogram::BUCKET_COUNT - 1);
+    CHECK(LatencyHistogram::bucketUpperBound(LatencyHistogram::BUCKET_COUNT - 1) == UINT64_MAX);
+
+    LatencyHistogram histogram;
+    for (uint64_t i = 1; i <= 1000; ++i) {
+        histogram.record(i * 1000);
+    }
+
+    auto snapshot = histogram.snapshot();
+    CHECK(snapshot.count == 1000);
+    CHECK(snapshot.mean() == doctest::Approx(500500.0));
+
+    // 相对误差不超过1/16
+    auto p50 = snapshot.percentile(50);
+    CHECK(p50 >= 500000);
+    CHECK(p50 <= 500000 + 500000 / 16);
+    auto p99 = snapshot.percentile(99);
+    CHECK(p99 >= 990000);
+    CHECK(p99 <= 990000 + 990000 / 16);
+    CHECK(snapshot.max() >= 1000000);
+
+    auto merged = snapshot;
+    merged.merge(snapshot);
+    CHECK(merged.count == 2000);
+    CHECK(merged.percentile(50) == p50);
+}
+
+TEST_CASE("trace")
+{
+    using namespace JTCP::Trace;
+
+    const char* path = "ut_common_trace.bin";
+    if (false == isEnabled()) {
+        CHECK(dump(path).isFailure());
+        return;
+    }
+
+    // 另起一个线程写满并覆盖缓冲区，验证只保留最新的记录
+    std::thread([] {
+        for (int i = 0; i < JTCP_TRACE_RING_CAPACITY + 10; ++i) {
+            JTCP_TRACE(READ, 3, i, 100);
+        }
+    }).join();
+    JTCP_TRACE(ACCEPT, 4, 0, 0);
+
+    REQUIRE(dump(path).isFailure() == false);
+
+    FILE* file = fopen(path, "rb");
+    REQUIRE(file != nullptr);
+    FileHeader file_header;
+    REQUIRE(fread(&file_header, sizeof(file_header), 1, file) == 1);
+    CHECK(file_header.record_size == sizeof(TraceRecord));
+    CHECK(file_header.thread_count >= 2);
+
+    bool found_last_read = false, found_accept = false, found_overwritten = false;
+    for (uint32_t i = 0; i < file_header.thread_count; ++i) {
+        ThreadHeader thread_header;
+        REQUIRE(fread(&thread_header, sizeof(thread_header), 1, file) == 1);
+        CHECK(thread_header.record_count <= JTCP_TRACE_RING_CAPACITY);
+        for (uint64_t j = 0; j < thread_header.record_count; ++j) {
+            TraceRecord record;
+            REQUIRE(fread(&record, sizeof(record), 1, file) == 1);
+            if (record.type == static_cast<uint16_t>(EventType::READ)) {
+                found_overwritten |= record.value < 10;
+                found_last_read |= record.value == JTCP_TRACE_RING_CAPACITY + 9;
+            }
+            found_accept |= record.type == static_cast<uint16_t>(EventType::ACCEPT);
+        }
+    }
+    fclose(file);
+    remove(path);
+
+    CHECK(found_last_read);
+    CHECK(found_accept);
+    CHECK_FALSE(found_overwritten);
+
+    // 退出线程的缓冲区交给新线程，短命线程不会使缓冲区数量持续增长
+    for (int i = 0; i < 100; ++i) {
+        std::thread([] { JTCP_TRACE(READ, 5, -1, 0); }).join();
+    }
+    REQUIRE(dump(path).isFailure() == false);
+    file = fopen(path, "rb");
+    REQUIRE(file != nullptr);
+    FileHeader reuse_header;
+    REQUIRE(fread(&reuse_header, sizeof(reuse_header), 1, file) == 1);
+    CHECK(reuse_header.thread_count <= file_header.thread_count + JTCP_TRACE_RETIRED_RINGS);
+    fclose(file);
+    remove(path);
+}
+
+TEST_CASE("async logger")
+{
+    using namespace JTCP::Log;
+
+    std::mutex               mutex;
+    std::vector<std::string> lines;
+    auto                     backend = std::make_shared<AsyncLogBackend>(
+        [&](LogLevel level, uint64_t, std::string_view msg) {
+            std::lock_guard<std::mutex> lock_guard(mutex);
+            lines.emplace_back(std::string(getLevelName(level)) + " " + std::string(msg));
+        });
+    auto old_backend = getBackend();
+    setBackend(backend);
+
+    // 多个线程并发写日志，每个线程使用自己的队列
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([i] {
+            for (int j = 0; j < 100; ++j) {
+                log(LogLevel::WARN, "thread %d line %d", i, j);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    JTCP_LOG_ERROR("error %s", "message");
+    backend->flush();
+
+    {
+        std::lock_guard<std::mutex> lock_guard(mutex);
+        CHECK(lines.size() == 401);
+        CHECK(std::count(lines.begin(), lines.end(), "ERROR error message") == 1);
+        CHECK(std::count(lines.begin(), lines.end(), "WARN thread 3 line 99") == 1);
+    }
+    CHECK(backend->getDroppedCount() == 0);
+
+    setBackend(old_backend);
+}
+
+TEST_CASE("byte buffer")
+{
+    JTCP::ByteBuffer buff(8);
+    buff.append("hello ", 6);
+    CHECK(buff.readableBytes() == 6);
+    buff.retrieve(2);
+
+    // 已读空间足够时搬移数据而不扩容，否则扩容
+    buff.append("wo", 2);
+    CHECK(buff.view() == "llo wo");
+    buff.append("rld\r\n", 5);
+    CHECK(buff.view() == "llo world\r\n");
+    CHECK(buff.find("\r\n") == 9);
+    CHECK(buff.find("\n\n") == std::string_view::npos);
+
+    buff.retrieve(100);
+    CHECK(buff.empty());
+
+    // readFD超出缓冲区剩余空间的部分经由栈上临时空间追加
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    std::string data(100000, 'x');
+    std::thread writer([&]() {
+        size_t written = 0;
+        while (written < data.size()) {
+            auto ret = write(fds[1], data.data() + written, data.size() - written);
+            if (ret <= 0) {
+                break;
+            }
+            written += ret;
+        }
+        close(fds[1]);
+    });
+    while (buff.readFD(fds[0]) > 0) {}
+    writer.join();
+    close(fds[0]);
+    CHECK(buff.readableBytes() == data.size());
+}
+
+TEST_CASE("cpu topology")
+{
+    using namespace JTCP;
+
+    CHECK(CPUTopology::parseCPUList("0-3,8,10-11\n") == std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+    CHECK(CPUTopology::parseCPUList("").empty());
+    // 没有NUMA信息的系统也至少有节点0
+    CHECK(CPUTopology::getNodeCPUs(CPUTopology::getNumaNode(0)).empty() == false);
+}
+
+TEST_CASE("timer queue")
+{
+    using namespace JTCP;
+
+    TimerQueue       queue;
+    std::vector<int> order;
+    auto             now = TimerQueue::ClockType::now();
+    queue.addTimer(now + std::chrono::milliseconds(20), [&]() { order.push_back(2); });
+    queue.addTimer(now + std::chrono::milliseconds(10), [&]() {
+        order.push_back(1);
+        // 回调中添加的已到期定时器在同一次runExpired中执行
+        queue.addTimer(now, [&]() { order.push_back(3); });
+    });
+
+    CHECK(queue.getWaitTime(now, 1000) == 10);
+    CHECK(queue.runExpired(now) == 0);
+    CHECK(queue.runExpired(now + std::chrono::milliseconds(10)) == 2);
+    CHECK(queue.getWaitTime(now + std::chrono::milliseconds(10), 1000) == 10);
+    CHECK(queue.runExpired(now + std::chrono::milliseconds(30)) == 1);
+    CHECK(order == std::vector<int>{1, 3, 2});
+    CHECK(queue.empty());
+}
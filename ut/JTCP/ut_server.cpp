@@ -3,7 +3,16 @@
 #include "doctest.h"
 #include <atomic>
 #include <chrono>
+#include <fcntl.h>
+#include <functional>
+#include <mutex>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <set>
+#include <stdexcept>
+#include <string>
 #include <thread>
+#include <unistd.h>
 
 TEST_CASE("server")
 {
@@ -59,3 +68,878 @@ TEST_CASE("server")
 
     server.stop();
 }
+
+TEST_CASE("server metrics")
+{
+    using namespace JTCP;
+
+    Server::TCPServer server;
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        client->setOnRecvDataCB([](Server::TCPPeerClient* ptr) {
+            char buff[2048]{0};
+            while (true) {
+                auto ret = ptr->readData(buff, sizeof(buff));
+                if (ret.isFailure()) {
+                    return;
+                }
+                ptr->sendData(buff, *(ret.getSuccessPtr()));
+            }
+        });
+    });
+    REQUIRE(server.start("127.0.0.1", 9997).isFailure() == false);
+
+    {
+        // 客户端先于服务端关闭，避免服务端端口进入TIME_WAIT
+        auto ret = Client::TCPClient::createNew("127.0.0.1", 9997);
+        REQUIRE(ret.isFailure() == false);
+        auto client = ret.getSuccessPtr()->get();
+        REQUIRE(client->sendData("hello", 5).isFailure() == false);
+
+        char        buff[16]{0};
+        std::size_t buff_size = sizeof(buff);
+        REQUIRE(client->recvData(buff, buff_size).isFailure() == false);
+
+        // 客户端收到回包时服务端回调可能还未返回，等待指标落定
+        auto total = server.getMetrics().total();
+        for (int i = 0; i < 100 && total.callback_duration_ns.count == 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            total = server.getMetrics().total();
+        }
+        CHECK(total.accepts == 1);
+        CHECK(total.bytes_in == 5);
+        CHECK(total.bytes_out == 5);
+        CHECK(total.read_eagains >= 1);
+        CHECK(total.epoll_wakeups >= 2);
+        CHECK(total.callback_duration_ns.count >= 1);
+        CHECK(total.events_per_wakeup.count == total.epoll_wakeups);
+    }
+
+    server.stop();
+}
+
+TEST_CASE("server dual stack")
+{
+    using namespace JTCP;
+
+    std::mutex            peer_mutex;
+    std::set<std::string> peer_ips;
+
+    Server::ServerOptions options;
+    options.dual_stack = true;
+    Server::TCPServer server;
+    server.setOptions(options);
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        std::lock_guard<std::mutex> lock_guard(peer_mutex);
+        peer_ips.emplace(client->getPeerIP());
+    });
+    REQUIRE(server.start("0.0.0.0", 9991).isFailure() == false);
+
+    {
+        // 同一个监听套接字同时接受IPv4与IPv6连接，IPv4对端地址不带映射前缀
+        auto client4 = Client::TCPClient::createNew("127.0.0.1", 9991);
+        REQUIRE(client4.isFailure() == false);
+        auto client6 = Client::TCPClient::createNew("::1", 9991);
+        REQUIRE(client6.isFailure() == false);
+
+        for (int i = 0; i < 100; ++i) {
+            {
+                std::lock_guard<std::mutex> lock_guard(peer_mutex);
+                if (peer_ips.size() == 2) {
+                    break;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        std::lock_guard<std::mutex> lock_guard(peer_mutex);
+        CHECK(peer_ips.count("127.0.0.1") == 1);
+        CHECK(peer_ips.count("::1") == 1);
+    }
+
+    // IPv4地址的键与其映射地址的键相同，按IP取键时忽略端口
+    auto addr4 = *SocketAddress::fromIP("127.0.0.1", 1).getSuccessPtr();
+    auto addr6 = *SocketAddress::fromIP("::ffff:127.0.0.1", 2).getSuccessPtr();
+    CHECK(addr4.getKey() != addr6.getKey());
+    CHECK(addr4.getKey(false) == addr6.getKey(false));
+    CHECK(AddressKeyHash()(addr4.getKey(false)) == AddressKeyHash()(addr6.getKey(false)));
+
+    server.stop();
+}
+
+TEST_CASE("server unix socket")
+{
+    using namespace JTCP;
+
+    for (std::string addr : {"unix:/tmp/jtcp_ut_server.sock", "unix:@jtcp_ut_server"}) {
+        Server::TCPServer server;
+        server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+            client->setOnRecvDataCB([](Server::TCPPeerClient* ptr) {
+                char buff[2048]{0};
+                while (true) {
+                    auto ret = ptr->readData(buff, sizeof(buff));
+                    if (ret.isFailure()) {
+                        return;
+                    }
+                    ptr->sendData(buff, *(ret.getSuccessPtr()));
+                }
+            });
+        });
+        REQUIRE(server.start(addr, 0).isFailure() == false);
+
+        {
+            auto ret = Client::TCPClient::createNew(addr, 0);
+            REQUIRE(ret.isFailure() == false);
+            auto client = ret.getSuccessPtr()->get();
+            REQUIRE(client->sendData("hello", 5).isFailure() == false);
+
+            char buff[8]{0};
+            REQUIRE(client->recvExact(buff, 5).isFailure() == false);
+            CHECK(std::string(buff) == "hello");
+        }
+
+        server.stop();
+    }
+
+    // stop后套接字文件已删除
+    CHECK(access("/tmp/jtcp_ut_server.sock", F_OK) != 0);
+}
+
+TEST_CASE("server spin mode")
+{
+    using namespace JTCP;
+
+    Server::ServerOptions options;
+    options.spin_duration = std::chrono::milliseconds(20);
+    options.cpu_affinity  = {0};
+    Server::TCPServer server;
+    server.setOptions(options);
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        client->setOnRecvDataCB([](Server::TCPPeerClient* ptr) {
+            char buff[2048]{0};
+            while (true) {
+                auto ret = ptr->readData(buff, sizeof(buff));
+                if (ret.isFailure()) {
+                    return;
+                }
+                ptr->sendData(buff, *(ret.getSuccessPtr()));
+            }
+        });
+    });
+    REQUIRE(server.start("127.0.0.1", 9990).isFailure() == false);
+
+    {
+        auto ret = Client::TCPClient::createNew("127.0.0.1", 9990);
+        REQUIRE(ret.isFailure() == false);
+        auto client = ret.getSuccessPtr()->get();
+        for (int i = 0; i < 10; ++i) {
+            REQUIRE(client->sendData("hello", 5).isFailure() == false);
+            char buff[8]{0};
+            REQUIRE(client->recvExact(buff, 5).isFailure() == false);
+            CHECK(std::string(buff) == "hello");
+        }
+
+        // 处理完事件后以零超时轮询，自旋窗口结束后回到阻塞等待
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK(server.getMetrics().total().epoll_spins > 0);
+    }
+
+    server.stop();
+}
+
+TEST_CASE("server multiple reactors")
+{
+    using namespace JTCP;
+
+    Server::ServerOptions options;
+    options.reactor_num  = 2;
+    options.numa_nodes   = {0};
+    options.steer_by_cpu = true;
+    Server::TCPServer server;
+    server.setOptions(options);
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        client->setOnRecvDataCB([](Server::TCPPeerClient* ptr) {
+            char buff[2048]{0};
+            while (true) {
+                auto ret = ptr->readData(buff, sizeof(buff));
+                if (ret.isFailure()) {
+                    return;
+                }
+                ptr->sendData(buff, *(ret.getSuccessPtr()));
+            }
+        });
+    });
+    REQUIRE(server.start("127.0.0.1", 9989).isFailure() == false);
+    // 运行中再次start被拒绝，已有的reactor不受影响
+    CHECK(server.start("127.0.0.1", 9989).isFailure());
+
+    {
+        // 每个reactor各自监听同一端口，连接由内核分配到其中之一
+        std::vector<std::shared_ptr<Client::TCPClient>> clients;
+        for (int i = 0; i < 8; ++i) {
+            auto ret = Client::TCPClient::createNew("127.0.0.1", 9989);
+            REQUIRE(ret.isFailure() == false);
+            clients.push_back(*ret.getSuccessPtr());
+        }
+        for (auto& client : clients) {
+            REQUIRE(client->sendData("hello", 5).isFailure() == false);
+            char buff[8]{0};
+            REQUIRE(client->recvExact(buff, 5).isFailure() == false);
+            CHECK(std::string(buff) == "hello");
+        }
+
+        auto metrics = server.getMetrics();
+        CHECK(metrics.reactors.size() == 2);
+        CHECK(metrics.total().accepts == 8);
+    }
+
+    // stop之后可以再次启动
+    server.stop();
+    REQUIRE(server.start("127.0.0.1", 9989).isFailure() == false);
+    {
+        auto ret = Client::TCPClient::createNew("127.0.0.1", 9989);
+        REQUIRE(ret.isFailure() == false);
+        auto client = *ret.getSuccessPtr();
+        REQUIRE(client->sendData("hello", 5).isFailure() == false);
+        char buff[8]{0};
+        REQUIRE(client->recvExact(buff, 5).isFailure() == false);
+        CHECK(std::string(buff) == "hello");
+    }
+    server.stop();
+}
+
+TEST_CASE("server socket options")
+{
+    using namespace JTCP;
+
+    Server::ServerOptions options;
+    options.socket_options = SocketOptions::lowLatency();
+    std::atomic<int> peer_nodelay{-1};
+    Server::TCPServer server;
+    server.setOptions(options);
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        int       value = 0;
+        socklen_t len   = sizeof(value);
+        getsockopt(client->getFileDescribe()->getFD(), IPPROTO_TCP, TCP_NODELAY, &value, &len);
+        peer_nodelay = value;
+    });
+    REQUIRE(server.start("127.0.0.1", 9988).isFailure() == false);
+
+    auto ret = Client::TCPClient::createNew("127.0.0.1", 9988, SocketOptions::lowLatency());
+    REQUIRE(ret.isFailure() == false);
+    auto client = *ret.getSuccessPtr();
+
+    int       value = 0;
+    socklen_t len   = sizeof(value);
+    getsockopt(client->getFileDescribe()->getFD(), IPPROTO_TCP, TCP_NODELAY, &value, &len);
+    CHECK(value == 1);
+    for (int i = 0; i < 100 && peer_nodelay == -1; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(peer_nodelay == 1);
+
+    // 服务端先关闭连接，端口上留下TIME_WAIT，默认开启的SO_REUSEADDR使重启可以立即绑定
+    server.stop();
+    client.reset();
+    REQUIRE(server.start("127.0.0.1", 9988).isFailure() == false);
+    server.stop();
+}
+
+TEST_CASE("server defer accept")
+{
+    using namespace JTCP;
+
+    Server::ServerOptions options;
+    options.socket_options.defer_accept    = 1;
+    options.socket_options.fast_open_queue = 16;
+    Server::TCPServer server;
+    server.setOptions(options);
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        client->setOnRecvDataCB([](Server::TCPPeerClient* ptr) {
+            char buff[2048]{0};
+            while (true) {
+                auto ret = ptr->readData(buff, sizeof(buff));
+                if (ret.isFailure()) {
+                    return;
+                }
+                ptr->sendData(buff, *(ret.getSuccessPtr()));
+            }
+        });
+    });
+    REQUIRE(server.start("127.0.0.1", 9987).isFailure() == false);
+
+    {
+        SocketOptions socket_options;
+        socket_options.fast_open_connect = true;
+        auto ret = Client::TCPClient::createNew("127.0.0.1", 9987, socket_options);
+        REQUIRE(ret.isFailure() == false);
+        auto client = ret.getSuccessPtr()->get();
+        REQUIRE(client->sendData("hello", 5).isFailure() == false);
+        char buff[8]{0};
+        REQUIRE(client->recvExact(buff, 5).isFailure() == false);
+        CHECK(std::string(buff) == "hello");
+
+        // 连接在请求到达后才被accept，accept与读取请求在同一次唤醒中完成
+        CHECK(server.getMetrics().total().epoll_wakeups == 1);
+    }
+
+    server.stop();
+}
+
+TEST_CASE("server epoll registration")
+{
+    using namespace JTCP;
+
+    constexpr uint64_t CONNECTION_NUM = 20;
+
+    Server::ServerOptions options;
+    options.socket_options.defer_accept = 1;
+    Server::TCPServer server;
+    server.setOptions(options);
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        client->setOnRecvDataCB([](Server::TCPPeerClient* ptr) {
+            char buff[2048]{0};
+            while (true) {
+                auto ret = ptr->readData(buff, sizeof(buff));
+                if (ret.isFailure()) {
+                    return;
+                }
+                ptr->sendData(buff, *(ret.getSuccessPtr()));
+            }
+        });
+    });
+    REQUIRE(server.start("127.0.0.1", 9983).isFailure() == false);
+
+    auto wait_disconnects = [&](uint64_t num) {
+        for (int i = 0; i < 300 && server.getMetrics().total().disconnects < num; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    };
+
+    // 保持打开的连接各注册一次，断开时随close移出epoll，不再EPOLL_CTL_DEL
+    {
+        std::vector<std::shared_ptr<Client::TCPClient>> clients;
+        for (uint64_t i = 0; i < CONNECTION_NUM; ++i) {
+            auto ret = Client::TCPClient::createNew("127.0.0.1", 9983);
+            REQUIRE(ret.isFailure() == false);
+            auto client = *ret.getSuccessPtr();
+            REQUIRE(client->sendData("x", 1).isFailure() == false);
+            char buff[1]{0};
+            REQUIRE(client->recvExact(buff, 1).isFailure() == false);
+            clients.push_back(client);
+        }
+        CHECK(server.getMetrics().total().epoll_ctl_calls == 1 + CONNECTION_NUM);
+    }
+    wait_disconnects(CONNECTION_NUM);
+    auto metrics = server.getMetrics().total();
+    CHECK(metrics.disconnects == CONNECTION_NUM);
+    CHECK(metrics.epoll_ctl_calls == 1 + CONNECTION_NUM);
+
+    // 发送后立即关闭的连接，accept时请求与FIN通常都已到达，在首次回调中断开，不注册到epoll
+    for (uint64_t i = 0; i < CONNECTION_NUM; ++i) {
+        auto ret = Client::TCPClient::createNew("127.0.0.1", 9983);
+        REQUIRE(ret.isFailure() == false);
+        REQUIRE(ret.getSuccessPtr()->get()->sendData("x", 1).isFailure() == false);
+    }
+    wait_disconnects(CONNECTION_NUM * 2);
+    metrics = server.getMetrics().total();
+    CHECK(metrics.disconnects == CONNECTION_NUM * 2);
+    CHECK(metrics.epoll_ctl_calls < 1 + CONNECTION_NUM * 2);
+
+    server.stop();
+}
+
+TEST_CASE("server peer close and errors")
+{
+    using namespace JTCP;
+
+    Server::TCPServer server;
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        client->setOnRecvDataCB([](Server::TCPPeerClient* ptr) {
+            char buff[2048]{0};
+            while (true) {
+                auto ret = ptr->readData(buff, sizeof(buff));
+                if (ret.isFailure()) {
+                    return;
+                }
+                if (std::string(buff, *(ret.getSuccessPtr())) == "boom") {
+                    throw std::runtime_error("bad request");
+                }
+                ptr->sendData(buff, *(ret.getSuccessPtr()));
+            }
+        });
+    });
+    REQUIRE(server.start("127.0.0.1", 9982).isFailure() == false);
+
+    auto connect_raw = []() {
+        int         fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = htons(9982);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        REQUIRE(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+        return fd;
+    };
+    auto wait_disconnects = [&](uint64_t num) {
+        for (int i = 0; i < 300 && server.getMetrics().total().disconnects < num; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    };
+
+    // 发送请求后半关闭，服务端读完剩余数据后断开，半关闭的一端仍能收到回应
+    {
+        int fd = connect_raw();
+        REQUIRE(send(fd, "hello", 5, 0) == 5);
+        REQUIRE(shutdown(fd, SHUT_WR) == 0);
+        char buff[8]{0};
+        CHECK(recv(fd, buff, sizeof(buff), MSG_WAITALL) == 5);
+        close(fd);
+        wait_disconnects(1);
+        CHECK(server.getMetrics().total().peer_closes == 1);
+    }
+
+    // RST直接从EPOLLERR得知，不再读取
+    {
+        int fd = connect_raw();
+        for (int i = 0; i < 300 && server.getMetrics().total().accepts < 2; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        linger reset_linger{1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &reset_linger, sizeof(reset_linger));
+        auto read_calls = server.getMetrics().total().read_calls;
+        close(fd);
+        wait_disconnects(2);
+        auto metrics = server.getMetrics().total();
+        CHECK(metrics.socket_errors == 1);
+        CHECK(metrics.read_calls == read_calls);
+    }
+
+    // 回调抛出异常只断开这一个连接，服务继续运行
+    {
+        int fd = connect_raw();
+        REQUIRE(send(fd, "boom", 4, 0) == 4);
+        wait_disconnects(3);
+        CHECK(server.getMetrics().total().callback_failures == 1);
+        close(fd);
+
+        auto ret = Client::TCPClient::createNew("127.0.0.1", 9982);
+        REQUIRE(ret.isFailure() == false);
+        auto client = ret.getSuccessPtr()->get();
+        REQUIRE(client->sendData("hello", 5).isFailure() == false);
+        char buff[8]{0};
+        REQUIRE(client->recvExact(buff, 5).isFailure() == false);
+        CHECK(std::string(buff) == "hello");
+    }
+
+    server.stop();
+}
+
+TEST_CASE("server read budget")
+{
+    using namespace JTCP;
+
+    Server::ServerOptions options;
+    options.read_budget           = 1024;
+    options.max_events_per_wakeup = 4;
+    std::atomic<size_t> total_read{0};
+    std::atomic<size_t> max_read_per_callback{0};
+    Server::TCPServer   server;
+    server.setOptions(options);
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        client->setOnRecvDataCB([&](Server::TCPPeerClient* ptr) {
+            char   buff[2048]{0};
+            size_t callback_read = 0;
+            while (true) {
+                auto ret = ptr->readData(buff, sizeof(buff));
+                if (ret.isFailure()) {
+                    break;
+                }
+                callback_read += *(ret.getSuccessPtr());
+            }
+            total_read += callback_read;
+            if (callback_read > max_read_per_callback) {
+                max_read_per_callback = callback_read;
+            }
+        });
+    });
+    REQUIRE(server.start("127.0.0.1", 9986).isFailure() == false);
+
+    {
+        auto ret = Client::TCPClient::createNew("127.0.0.1", 9986);
+        REQUIRE(ret.isFailure() == false);
+        auto client = ret.getSuccessPtr()->get();
+
+        std::string data(64 * 1024, 'x');
+        REQUIRE(client->sendData(data.data(), data.size()).isFailure() == false);
+        for (int i = 0; i < 200 && total_read < data.size(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        CHECK(total_read == data.size());
+
+        // 每次回调最多读取read_budget字节，剩余数据通过重新调度读取
+        CHECK(max_read_per_callback <= 1024);
+        auto metrics = server.getMetrics().total();
+        CHECK(metrics.read_budget_hits > 0);
+        CHECK(metrics.requeues > 0);
+    }
+
+    server.stop();
+}
+
+TEST_CASE("server admission control")
+{
+    using namespace JTCP;
+
+    auto wait_until = [](const std::function<bool()>& cond) {
+        for (int i = 0; i < 200 && false == cond(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return cond();
+    };
+
+    Server::ServerOptions options;
+    options.admission.max_connections_per_ip = 2;
+    std::atomic<int>  new_client_num{0};
+    Server::TCPServer server;
+    server.setOptions(options);
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        ++new_client_num;
+        client->setOnRecvDataCB([](Server::TCPPeerClient* ptr) {
+            char buff[64]{0};
+            while (ptr->readData(buff, sizeof(buff)).isFailure() == false) {}
+        });
+    });
+    REQUIRE(server.start("127.0.0.1", 9985).isFailure() == false);
+
+    {
+        std::vector<std::shared_ptr<Client::TCPClient>> clients;
+        for (int i = 0; i < 3; ++i) {
+            auto ret = Client::TCPClient::createNew("127.0.0.1", 9985);
+            REQUIRE(ret.isFailure() == false);
+            clients.push_back(*ret.getSuccessPtr());
+        }
+        // 第三个连接超过单IP上限，被直接关闭且不触发新连接回调
+        CHECK(wait_until([&]() { return server.getMetrics().total().accept_rejects == 1; }));
+        CHECK(server.getMetrics().total().accepts == 2);
+        CHECK(new_client_num == 2);
+
+        // 断开一个连接后名额被释放
+        clients.erase(clients.begin());
+        CHECK(wait_until([&]() { return server.getMetrics().total().disconnects == 1; }));
+        auto ret = Client::TCPClient::createNew("127.0.0.1", 9985);
+        REQUIRE(ret.isFailure() == false);
+        CHECK(wait_until([&]() { return new_client_num == 3; }));
+    }
+
+    server.stop();
+
+    // 速率限制：突发额度用完后拒绝
+    Server::AdmissionOptions admission_options;
+    admission_options.accept_rate  = 10;
+    admission_options.accept_burst = 2;
+    Server::AdmissionControl admission;
+    admission.reset(admission_options);
+    auto addr = *SocketAddress::parse("127.0.0.1", 0).getSuccessPtr();
+    CHECK(admission.admit(addr) == Server::AdmitResult::ADMITTED);
+    CHECK(admission.admit(addr) == Server::AdmitResult::ADMITTED);
+    CHECK(admission.admit(addr) == Server::AdmitResult::RATE_LIMITED);
+    CHECK(admission.getConnectionNum() == 2);
+
+    // 同一/16网段的不同IP互不占用名额，被拒绝的连接不消耗速率令牌
+    admission_options.max_connections        = 515;
+    admission_options.max_connections_per_ip = 2;
+    admission_options.accept_rate            = 1;
+    admission_options.accept_burst           = 1024;
+    admission.reset(admission_options);
+    auto make_addr = [](int i) {
+        auto ip = "192.168." + std::to_string(i / 256) + "." + std::to_string(i % 256);
+        return *SocketAddress::parse(ip, 0).getSuccessPtr();
+    };
+    for (int i = 0; i < 512; ++i) {
+        CHECK(admission.admit(make_addr(i)) == Server::AdmitResult::ADMITTED);
+    }
+    CHECK(admission.admit(addr) == Server::AdmitResult::ADMITTED);
+    CHECK(admission.admit(addr) == Server::AdmitResult::ADMITTED);
+    CHECK(admission.admit(addr) == Server::AdmitResult::TOO_MANY_FROM_IP);
+    CHECK(admission.admit(make_addr(512)) == Server::AdmitResult::ADMITTED);
+    for (int i = 0; i < 1024; ++i) {
+        CHECK(admission.admit(make_addr(513)) == Server::AdmitResult::TOO_MANY_CONNECTIONS);
+    }
+    admission.release(make_addr(0));
+    CHECK(admission.admit(make_addr(513)) == Server::AdmitResult::ADMITTED);
+    CHECK(admission.getConnectionNum() == 515);
+}
+
+TEST_CASE("server throttle")
+{
+    using namespace JTCP;
+
+    Server::ServerOptions options;
+    options.throttle.bytes_per_second = 100 * 1024;
+    options.throttle.burst_bytes      = 10 * 1024;
+    std::atomic<size_t>      total_read{0};
+    std::mutex               peer_mutex;
+    Server::TCPPeerClientPtr peer{nullptr};
+    Server::TCPServer        server;
+    server.setOptions(options);
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        {
+            std::lock_guard<std::mutex> lock_guard(peer_mutex);
+            peer = client;
+        }
+        client->setOnRecvDataCB([&](Server::TCPPeerClient* ptr) {
+            char buff[4096]{0};
+            while (true) {
+                auto ret = ptr->readData(buff, sizeof(buff));
+                if (ret.isFailure()) {
+                    return;
+                }
+                total_read += *(ret.getSuccessPtr());
+            }
+        });
+    });
+    REQUIRE(server.start("127.0.0.1", 9984).isFailure() == false);
+
+    {
+        auto ret = Client::TCPClient::createNew("127.0.0.1", 9984);
+        REQUIRE(ret.isFailure() == false);
+        auto client = ret.getSuccessPtr()->get();
+
+        // 60KB在100KB/s、突发10KB的限速下约需0.5秒才能读完
+        std::string data(60 * 1024, 'x');
+        auto        begin = std::chrono::steady_clock::now();
+        REQUIRE(client->sendData(data.data(), data.size()).isFailure() == false);
+        for (int i = 0; i < 300 && total_read < data.size(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        auto elapsed = std::chrono::steady_clock::now() - begin;
+        CHECK(total_read == data.size());
+        CHECK(elapsed >= std::chrono::milliseconds(300));
+
+        std::lock_guard<std::mutex> lock_guard(peer_mutex);
+        REQUIRE(peer != nullptr);
+        auto stats = peer->getStats();
+        CHECK(stats.bytes_in == data.size());
+        CHECK(stats.throttle_count > 0);
+        CHECK(stats.throttled_duration_ns > 0);
+        CHECK(server.getMetrics().total().throttles == stats.throttle_count);
+        peer.reset();
+    }
+
+    server.stop();
+}
+
+TEST_CASE("server connection churn")
+{
+    using namespace JTCP;
+
+    constexpr int THREAD_NUM             = 4;
+    constexpr int CONNECTIONS_PER_THREAD = 25000;
+
+    Server::ServerOptions options;
+    options.reactor_num = 2;
+    std::mutex                            held_mutex;
+    std::vector<Server::TCPPeerClientPtr> held;
+    Server::TCPServer                     server;
+    server.setOptions(options);
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        std::weak_ptr<Server::TCPPeerClient> weak_client = client;
+        client->setOnRecvDataCB([&, weak_client](Server::TCPPeerClient* ptr) {
+            char buff[64]{0};
+            while (true) {
+                auto ret = ptr->readData(buff, sizeof(buff));
+                if (ret.isFailure()) {
+                    return;
+                }
+                ptr->sendData(buff, *(ret.getSuccessPtr()));
+                // 回应后交给其他线程持有，与reactor并发读取到EOF并断开
+                if (auto peer = weak_client.lock()) {
+                    std::lock_guard<std::mutex> lock_guard(held_mutex);
+                    held.push_back(peer);
+                }
+            }
+        });
+    });
+    REQUIRE(server.start("unix:@jtcp_ut_churn", 0).isFailure() == false);
+
+    std::atomic<bool> holder_run{true};
+    std::thread       holder([&]() {
+        while (holder_run) {
+            std::vector<Server::TCPPeerClientPtr> peers;
+            {
+                std::lock_guard<std::mutex> lock_guard(held_mutex);
+                peers.swap(held);
+            }
+            // 在reactor之外读取，可能与reactor同时发现断开，连接只能被删除一次
+            char buff[64]{0};
+            for (auto& peer : peers) {
+                peer->readData(buff, sizeof(buff));
+            }
+            // 最后的引用在本线程释放，fd在这里关闭
+            peers.clear();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    std::atomic<int>         failures{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < THREAD_NUM; ++i) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < CONNECTIONS_PER_THREAD; ++j) {
+                auto ret = Client::TCPClient::createNew("unix:@jtcp_ut_churn", 0);
+                if (ret.isFailure()) {
+                    ++failures;
+                    continue;
+                }
+                auto client = ret.getSuccessPtr()->get();
+                char buff[1]{0};
+                if (client->sendData("x", 1).isFailure() ||
+                    client->recvExact(buff, 1).isFailure()) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    constexpr uint64_t TOTAL = THREAD_NUM * CONNECTIONS_PER_THREAD;
+    for (int i = 0; i < 1000 && server.getMetrics().total().disconnects < TOTAL; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    holder_run = false;
+    holder.join();
+
+    auto metrics = server.getMetrics().total();
+    CHECK(failures == 0);
+    CHECK(metrics.accepts == TOTAL);
+    CHECK(metrics.disconnects == TOTAL);
+
+    server.stop();
+}
+
+#ifdef JTCP_ENABLE_COROUTINE
+TEST_CASE("server coroutine handler")
+{
+    using namespace JTCP;
+
+    // 释放的帧按大小分级复用
+    void* frame = Server::CoroutineFramePool::allocate(100);
+    Server::CoroutineFramePool::deallocate(frame, 100);
+    CHECK(Server::CoroutineFramePool::allocate(90) == frame);
+    Server::CoroutineFramePool::deallocate(frame, 90);
+
+    constexpr size_t  BULK_SIZE = 8 * 1024 * 1024;
+    Server::TCPServer server;
+    server.setOnNewClient([&](Server::TCPPeerClientPtr client) {
+        Server::CoConnection::spawn(client, [&](Server::CoConnection& conn) -> Server::CoTask {
+            char command[4]{0};
+            if ((co_await conn.readExact(command, sizeof(command))).isFailure()) {
+                co_return;
+            }
+            // 大块数据超过内核发送缓冲区，write挂起直到对端读走
+            if (std::string(command, sizeof(command)) == "bulk") {
+                std::string data(BULK_SIZE, 'x');
+                co_await conn.write(data.data(), data.size());
+                co_return;
+            }
+            std::string payload;
+            while ((co_await conn.readFrame(payload)).isSuccess()) {
+                co_await conn.writeFrame(payload.data(), payload.size());
+            }
+        });
+    });
+    REQUIRE(server.start("127.0.0.1", 9981).isFailure() == false);
+
+    {
+        auto ret = Client::TCPClient::createNew("127.0.0.1", 9981);
+        REQUIRE(ret.isFailure() == false);
+        auto client = ret.getSuccessPtr()->get();
+        REQUIRE(client->sendData("echo", 4).isFailure() == false);
+
+        // 帧头被拆成两次发送，协程在收到完整的帧后才恢复
+        for (std::string payload : {"hello", "coroutine"}) {
+            uint32_t net_len = htonl(static_cast<uint32_t>(payload.size()));
+            REQUIRE(client->sendData(reinterpret_cast<char*>(&net_len), 2).isFailure() == false);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            REQUIRE(client->sendData(reinterpret_cast<char*>(&net_len) + 2, 2).isFailure() ==
+                    false);
+            REQUIRE(client->sendData(payload.data(), payload.size()).isFailure() == false);
+
+            char buff[16]{0};
+            REQUIRE(client->recvExact(buff, 4 + payload.size()).isFailure() == false);
+            CHECK(memcmp(buff, &net_len, 4) == 0);
+            CHECK(std::string(buff + 4, payload.size()) == payload);
+        }
+    }
+
+    {
+        auto ret = Client::TCPClient::createNew("127.0.0.1", 9981);
+        REQUIRE(ret.isFailure() == false);
+        auto client = ret.getSuccessPtr()->get();
+        REQUIRE(client->sendData("bulk", 4).isFailure() == false);
+
+        // 慢速读取，服务端多次等待可写
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::string data(BULK_SIZE, 0);
+        REQUIRE(client->recvExact(data.data(), data.size()).isFailure() == false);
+        CHECK(data == std::string(BULK_SIZE, 'x'));
+
+        // 协程结束后服务端断开连接
+        char buff[1]{0};
+        CHECK(client->recvExact(buff, 1).isFailure());
+        CHECK(server.getMetrics().total().send_eagains > 0);
+    }
+
+    {
+        // 对端只发不读：协程阻塞在write上时服务端暂停读取，由TCP流控约束发送方
+        auto ret = Client::TCPClient::createNew("127.0.0.1", 9981);
+        REQUIRE(ret.isFailure() == false);
+        auto client = ret.getSuccessPtr()->get();
+        REQUIRE(client->sendData("echo", 4).isFailure() == false);
+        int fd = client->getFileDescribe()->getFD();
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+        constexpr size_t PAYLOAD_SIZE = 16 * 1024;
+        constexpr size_t SEND_LIMIT   = 256 * 1024 * 1024;
+        std::string      frame(4 + PAYLOAD_SIZE, 'y');
+        uint32_t         net_len = htonl(static_cast<uint32_t>(PAYLOAD_SIZE));
+        memcpy(frame.data(), &net_len, sizeof(net_len));
+        size_t sent   = 0;
+        int    stalls = 0;
+        while (sent < SEND_LIMIT && stalls < 20) {
+            auto offset = sent % frame.size();
+            auto len    = send(fd, frame.data() + offset, frame.size() - offset, MSG_NOSIGNAL);
+            if (len > 0) {
+                sent += len;
+                stalls = 0;
+                continue;
+            }
+            ++stalls;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        CHECK(sent < SEND_LIMIT);
+
+        // 开始读取后协程继续回显，服务端恢复读取暂停期间留在内核中的数据
+        size_t            total    = (sent + frame.size() - 1) / frame.size() * frame.size();
+        size_t            received = 0;
+        std::vector<char> buff(64 * 1024);
+        while (received < total) {
+            pollfd poll_fd{fd, static_cast<short>(POLLIN | (sent < total ? POLLOUT : 0)), 0};
+            REQUIRE(poll(&poll_fd, 1, 2000) > 0);
+            if (poll_fd.revents & POLLOUT) {
+                auto offset = sent % frame.size();
+                auto len    = send(fd, frame.data() + offset, frame.size() - offset, MSG_NOSIGNAL);
+                sent += len > 0 ? len : 0;
+            }
+            if (poll_fd.revents & POLLIN) {
+                auto len = recv(fd, buff.data(), buff.size(), 0);
+                REQUIRE(len > 0);
+                received += len;
+            }
+        }
+        CHECK(received == total);
+    }
+
+    server.stop();
+}
+#endif